@@ -1,9 +1,24 @@
-set(headers ${headers}
-	include/Utils.h
-	include/PCH.h
-	include/Logger.h
-	include/Settings.h
-	include/Manager.h
-	include/Hooks.h
-	include/MCP.h
-)
+set(headers ${headers}
+	include/Utils.h
+	include/PCH.h
+	include/Logger.h
+	include/Settings.h
+	include/Manager.h
+	include/Hooks.h
+	include/MCP.h
+	include/WeatherIndex.h
+	include/BlurController.h
+	include/Metrics.h
+	include/SettingsSnapshot.h
+	include/ContextRules.h
+	include/TimeCurve.h
+	include/ImodChannels.h
+	include/Published.h
+	include/FrameTrace.h
+	include/Easing.h
+	include/AutoBlur.h
+	include/Memory.h
+	include/BlurZones.h
+	include/Telemetry.h
+	include/Persistence.h
+)
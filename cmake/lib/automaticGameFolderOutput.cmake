@@ -1,11 +1,11 @@
-
-function(automaticGameFolderOutput steam_owrt_output steam_mods_output)
-
-    if(DEFINED ENV{SKYRIM_OWRT_FOLDER} AND IS_DIRECTORY "$ENV{SKYRIM_OWRT_FOLDER}" AND steam_owrt_output)
-        copyOutputs("$ENV{SKYRIM_OWRT_FOLDER}/${PRODUCT_NAME}${PROJECT_SUFFIX}")
-    endif()
-    if(DEFINED ENV{SKYRIM_MODS_FOLDER} AND IS_DIRECTORY "$ENV{SKYRIM_MODS_FOLDER}" AND steam_mods_output)
-        copyOutputs("$ENV{SKYRIM_MODS_FOLDER}/${PRODUCT_NAME}${PROJECT_SUFFIX}")
-    endif()
-
-endfunction()
+
+function(automaticGameFolderOutput steam_owrt_output steam_mods_output)
+
+    if(DEFINED ENV{SKYRIM_OWRT_FOLDER} AND IS_DIRECTORY "$ENV{SKYRIM_OWRT_FOLDER}" AND steam_owrt_output)
+        copyOutputs("$ENV{SKYRIM_OWRT_FOLDER}/${PRODUCT_NAME}${PROJECT_SUFFIX}")
+    endif()
+    if(DEFINED ENV{SKYRIM_MODS_FOLDER} AND IS_DIRECTORY "$ENV{SKYRIM_MODS_FOLDER}" AND steam_mods_output)
+        copyOutputs("$ENV{SKYRIM_MODS_FOLDER}/${PRODUCT_NAME}${PROJECT_SUFFIX}")
+    endif()
+
+endfunction()
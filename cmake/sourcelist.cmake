@@ -1,8 +1,15 @@
-set(sources ${sources}
-	src/Plugin.cpp
-	src/Utils.cpp
-	src/Settings.cpp
-	src/Manager.cpp
-	src/Hooks.cpp
-	src/MCP.cpp
-)
+set(sources ${sources}
+	src/Plugin.cpp
+	src/Utils.cpp
+	src/Settings.cpp
+	src/Manager.cpp
+	src/Hooks.cpp
+	src/MCP.cpp
+	src/BlurController.cpp
+	src/Metrics.cpp
+	src/ContextRules.cpp
+	src/ImodChannels.cpp
+	src/Memory.cpp
+	src/BlurZones.cpp
+	src/Telemetry.cpp
+)
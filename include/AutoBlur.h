@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "Easing.h"
+
+// Automatic mode: blur values derived from what a weather record says about itself, so weathers without
+// a row in the table still get blur. The traits are read once when the game data is loaded, deriving the
+// table from them is cheap enough to redo whenever the tuning changes.
+namespace AutoBlur {
+
+	// Same bits as RE::TESWeather::WeatherDataFlag
+	enum Classification : std::uint8_t {
+		kPleasant = 1 << 0,
+		kCloudy   = 1 << 1,
+		kRainy    = 1 << 2,
+		kSnow     = 1 << 3
+	};
+
+	/**
+	 * @brief What a weather record contributes, copied out of the TESWeather at data load.
+	 */
+	struct WeatherTraits {
+		std::uint32_t formID         = 0;
+		float         fogDayNear     = 0.0f;
+		float         fogDayFar      = 0.0f;
+		float         fogNightNear   = 0.0f;
+		float         fogNightFar    = 0.0f;
+		std::uint8_t  classification = 0;      // Classification bits
+		bool          precipitation  = false;  // Has a precipitation particle shader
+	};
+
+	/**
+	 * @brief The global curves, from [Automatic] in the INI. Fog density runs from 0 at clearFogFar to 1 at
+	 *        denseFogFar, is shaped by fogCurve, and picks strength and range between the clear and dense ends.
+	 */
+	struct Tuning {
+		float clearFogFar           = 120000.0f;  // Fog far distance at or beyond which a weather counts as clear
+		float denseFogFar           = 15000.0f;   // And at or below which it counts as fully dense
+		float fogCurve              = 1.0f;       // Exponent on the density, above 1 keeps light haze sharper
+		float clearStrength         = 0.15f;
+		float denseStrength         = 1.0f;
+		float clearRange            = 400.0f;     // Row units, like blurRange
+		float denseRange            = 100.0f;
+		float pleasantScale         = 0.8f;       // Strength multiplier per classification
+		float cloudyScale           = 1.0f;
+		float rainyScale            = 1.2f;
+		float snowScale             = 1.3f;
+		float precipitationStrength = 0.1f;       // Added when the weather has precipitation
+		float minStrength           = 0.02f;      // Weathers below this get no entry, and no blur
+		float transitionDuration    = Easing::defaultDuration;
+
+		bool operator==(const Tuning&) const = default;
+	};
+
+	/**
+	 * @brief A derived table entry, in the same units as a weather row.
+	 */
+	struct Derived {
+		std::uint32_t formID   = 0;
+		float         strength = 0.0f;
+		float         range    = 0.0f;
+		float         duration = Easing::defaultDuration;
+	};
+
+	static_assert(sizeof(Derived) == 16);
+
+	/**
+	 * @return How foggy the weather is in [0, 1], from its day and night fog far distances.
+	 */
+	inline float FogDensity(const WeatherTraits& a_traits, const Tuning& a_tuning) {
+		// Unset distances are 0, which would otherwise read as a wall of fog
+		float farSum   = 0.0f;
+		int   farCount = 0;
+		for (const float distance : { a_traits.fogDayFar, a_traits.fogNightFar }) {
+			if (distance > 0.0f) {
+				farSum += distance;
+				farCount++;
+			}
+		}
+		if (!farCount) return 0.0f;
+
+		const float fogFar = farSum / static_cast<float>(farCount);
+		const float span   = a_tuning.clearFogFar - a_tuning.denseFogFar;
+		if (span <= 0.0f) return fogFar <= a_tuning.denseFogFar ? 1.0f : 0.0f;
+
+		const float density = std::clamp((a_tuning.clearFogFar - fogFar) / span, 0.0f, 1.0f);
+		return a_tuning.fogCurve == 1.0f ? density : std::pow(density, std::max(a_tuning.fogCurve, 0.01f));
+	}
+
+	inline float ClassificationScale(std::uint8_t a_classification, const Tuning& a_tuning) {
+		// Heaviest first, a weather can carry more than one bit
+		if (a_classification & kSnow) return a_tuning.snowScale;
+		if (a_classification & kRainy) return a_tuning.rainyScale;
+		if (a_classification & kCloudy) return a_tuning.cloudyScale;
+		if (a_classification & kPleasant) return a_tuning.pleasantScale;
+		return 1.0f;
+	}
+
+	/**
+	 * @return The weather's entry, or nothing when it comes out below minStrength.
+	 */
+	inline std::optional<Derived> Derive(const WeatherTraits& a_traits, const Tuning& a_tuning) {
+		if (!a_traits.formID) return std::nullopt;
+
+		const float density  = FogDensity(a_traits, a_tuning);
+		float       strength = std::lerp(a_tuning.clearStrength, a_tuning.denseStrength, density) * ClassificationScale(a_traits.classification, a_tuning);
+		if (a_traits.precipitation) strength += a_tuning.precipitationStrength;
+
+		if (!(strength >= a_tuning.minStrength)) return std::nullopt;
+		return Derived{ a_traits.formID, strength, std::max(std::lerp(a_tuning.clearRange, a_tuning.denseRange, density), 0.0f),
+			std::max(a_tuning.transitionDuration, 0.0f) };
+	}
+
+	inline std::vector<Derived> Build(std::span<const WeatherTraits> a_weathers, const Tuning& a_tuning) {
+		std::vector<Derived> table;
+		table.reserve(a_weathers.size());
+		for (const auto& traits : a_weathers) {
+			if (const auto derived = Derive(traits, a_tuning)) table.push_back(*derived);
+		}
+		return table;
+	}
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "AutoBlur.h"
+#include "BlurZones.h"
+#include "ImodChannels.h"
+#include "WeatherIndex.h"
+
+// The blur state machine only talks to the game through the two interfaces below,
+// so it builds without CommonLibSSE and can be driven headless (see tools/).
+namespace Blur {
+
+	enum class Mode : std::int32_t {
+		kNone      = 0,
+		kAdvanced  = 1,
+		kAutomatic = 2   // The weather table, with derived values for weathers it has no row for
+	};
+
+	/**
+	 * @brief Read-only view of the sky the controller selects blur values from.
+	 */
+	class ISky {
+		public:
+			virtual ~ISky() = default;
+
+			virtual std::uint32_t GetCurrentWeather() const  = 0;  // FormID, 0 when there is none
+			virtual std::uint32_t GetPreviousWeather() const = 0;  // FormID, 0 when there is none
+			virtual float         GetGameHour() const        = 0;  // [0, 24)
+	};
+
+	/**
+	 * @brief Sink for the values the controller wants on the runtime IMOD.
+	 */
+	class IImodSink {
+		public:
+			virtual ~IImodSink() = default;
+
+			/**
+			 * @brief Writes the channels set in a_mask, every other channel is unchanged since the last call.
+			 */
+			virtual void SetChannels(std::uint32_t a_mask, const Imod::Values& a_values) = 0;
+			virtual void Trigger()                                                       = 0;
+			virtual void Stop()                                                          = 0;
+
+			/**
+			 * @return false once the engine has dropped the instance the last Trigger() created.
+			 */
+			virtual bool IsInstanceAlive() const = 0;
+	};
+
+	/**
+	 * @brief A settings row reduced to what the controller needs, with the weather already resolved to a FormID.
+	 */
+	struct RowInput {
+		std::uint32_t formID       = 0;  // 0 is the "None" row, selected while the sky has no weather
+		bool          enabled      = true;
+		float         strength     = 1.0f;
+		float         range        = 100.0f;
+		bool          staticToggle = false;
+		float         duration     = Easing::defaultDuration;  // Seconds to reach this row's values
+		Easing::Curve easing       = Easing::defaultCurve;
+
+		std::span<const TimeCurve::Keyframe> curve;     // Empty for a flat row
+		std::span<const Imod::ChannelTarget> channels;  // Non-DOF channels the row sets, empty for DOF only
+	};
+
+	/**
+	 * @brief Bit flags describing what happened during a single Update() call.
+	 */
+	enum UpdateEvent : std::uint32_t {
+		kNoEvent         = 0,
+		kWeatherChanged  = 1 << 0,
+		kDOFWritten      = 1 << 1,
+		kTriggered       = 1 << 2,
+		kStopped         = 1 << 3,
+		kChannelsWritten = 1 << 4,
+		kParked          = 1 << 5,
+		kUnparked        = 1 << 6,
+		kRetriggered     = 1 << 7   // Also carries kTriggered
+	};
+
+	class Controller {
+		public:
+			/**
+			 * @brief How long an instance is kept alive at zero strength before it is stopped. A weather flip or a
+			 *        curve hovering around zero inside this window reuses the instance instead of re-triggering it.
+			 */
+			static constexpr float parkGracePeriod = 5.0f;
+
+			enum class Lifecycle : std::uint8_t {
+				kStopped,
+				kActive,
+				kParked   // Triggered, held at zero strength until the grace period runs out
+			};
+
+			/**
+			 * @brief The DOF side of the state after an Update(), enough for a replay to resume mid-transition.
+			 *        Channel lanes are not part of it, a restored controller has them resting at their targets.
+			 */
+			struct Checkpoint {
+				std::uint32_t weather         = 0;
+				Mode          mode            = Mode::kNone;
+				float         targetStrength  = 0.0f;
+				float         targetRange     = 0.0f;
+				float         appliedStrength = 0.0f;
+				float         appliedRange    = 0.0f;
+				float         startStrength   = 0.0f;  // Where the running transition began
+				float         startRange      = 0.0f;
+				double        elapsed         = 0.0;
+				double        duration        = 0.0;
+				Easing::Curve easing          = Easing::defaultCurve;
+				Lifecycle     lifecycle       = Lifecycle::kStopped;
+				float         parkedTime      = 0.0f;
+				float         baseStrength    = 0.0f;  // The target before the blur zones were applied
+				float         baseRange       = 0.0f;
+			};
+
+			/**
+			 * @brief Compiles the rows into the FormID index. The first enabled row for a weather wins,
+			 *        and its time-of-day curve, if any, is baked here rather than evaluated per frame.
+			 * @param a_reselect false when the caller knows the active weather's row is unchanged,
+			 *        so the running transition carries on untouched.
+			 */
+			void Compile(std::span<const RowInput> a_rows, bool a_reselect = true);
+
+			/**
+			 * @brief Compiles the derived values Mode::kAutomatic falls back to. Rows always take precedence.
+			 */
+			void SetAutomatic(std::span<const AutoBlur::Derived> a_table);
+
+			/**
+			 * @brief Forces the next Update() to re-select the target values, even if the weather did not change.
+			 */
+			void Invalidate() { _dirty = true; }
+
+			/**
+			 * @brief Values from a context rule that take precedence over the weather index, nullptr to clear.
+			 *        Only a different override forces a re-selection, so re-sending the same one is free.
+			 */
+			void SetOverride(const WeatherIndex::Entry* a_entry);
+
+			/**
+			 * @brief The blur zones around the player, blended over whatever the weather or an override picked.
+			 *        Entering or leaving a zone starts a transition, a move inside a falloff band is followed directly.
+			 *        Ignored in Mode::kNone.
+			 */
+			void SetZone(const Zones::Sample& a_sample);
+
+			/**
+			 * @brief Values of the source IMAD, which channels a row does not set rest at. The DOF lanes are ignored.
+			 */
+			void SetBaseline(const Imod::Values& a_values);
+
+			/**
+			 * @brief Advances the state machine by one frame.
+			 * @return A combination of UpdateEvent flags.
+			 */
+			std::uint32_t Update(float a_delta, Mode a_mode, const ISky& a_sky, IImodSink& a_sink);
+
+			Checkpoint GetCheckpoint() const;
+
+			/**
+			 * @brief Picks up from a checkpoint, with the index, override and zone already set to what they were when it was taken.
+			 */
+			void Restore(const Checkpoint& a_checkpoint);
+
+			std::uint32_t GetCurrentWeather() const { return _currentWeather; }
+			float         GetTargetStrength() const { return _channels.target[Imod::kDOFStrength]; }
+			float         GetTargetRange() const { return _channels.target[Imod::kDOFRange]; }
+			float         GetAppliedStrength() const { return _channels.applied[Imod::kDOFStrength]; }
+			float         GetAppliedRange() const { return _channels.applied[Imod::kDOFRange]; }
+			const auto&   GetAppliedChannels() const { return _channels.applied; }
+			const auto&   GetOverride() const { return _override; }
+			const auto&   GetZone() const { return _zone; }
+			bool          IsEffectActive() const { return _lifecycle != Lifecycle::kStopped; }
+			bool          IsParked() const { return _lifecycle == Lifecycle::kParked; }
+			bool          IsSettled() const { return _channels.IsSettled() && _lifecycle != Lifecycle::kParked; }
+			std::size_t   GetIndexSize() const { return _index.Size(); }
+			std::size_t   GetCurveCount() const { return _curves.size(); }
+			std::size_t   GetAutomaticSize() const { return _automatic.Size(); }
+			bool          HasActiveCurve() const { return _activeCurve != TimeCurve::noCurve; }
+
+		private:
+			struct ChannelSet {
+				std::uint32_t mask = 0;
+				Imod::Values  values{};
+			};
+
+			const WeatherIndex::Entry* Find(std::uint32_t a_weather, Mode a_mode) const;
+			void          SelectTarget(const ISky& a_sky, std::uint32_t a_weather, Mode a_mode);
+			void          SetBaseTarget(float a_strength, float a_range);
+			void          ApplyZone();
+			void          BeginTransition(const WeatherIndex::Entry* a_entry);
+			std::uint32_t UpdateLifecycle(float a_delta, IImodSink& a_sink);
+			void          ResetExtraTargets(const WeatherIndex::Entry* a_entry);
+			bool          ExtrasAtBaseline(const Imod::Values& a_values) const;
+
+			WeatherIndex::WeatherMap           _index;
+			std::optional<WeatherIndex::Entry> _noWeather;  // A "None" row, selected while the sky has no weather
+			WeatherIndex::WeatherMap           _automatic;
+			std::optional<WeatherIndex::Entry> _override;
+			std::vector<TimeCurve::LUT>        _curves;
+			std::uint32_t                      _activeCurve = TimeCurve::noCurve;
+			std::vector<ChannelSet>            _channelSets;
+			Imod::Values                       _baseline{};
+			bool                               _extrasTargeted = false;  // A channel set is in the targets
+
+			Zones::Sample _zone;
+			float         _baseStrength = 0.0f;  // DOF target before the zones
+			float         _baseRange    = 0.0f;
+			bool          _zoneMoved    = false;  // Since the last Update()
+			bool          _zoneCrossed  = false;  // The set of contributing zones changed
+
+			std::uint32_t _currentWeather = 0;
+			Mode          _lastMode       = Mode::kNone;
+			bool          _dirty          = true;
+
+			Imod::ChannelState _channels;
+			Lifecycle          _lifecycle  = Lifecycle::kStopped;
+			bool               _wantActive = false;
+			float              _parkedTime = 0.0f;
+	};
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "WeatherIndex.h"
+
+// Blur zones are places in a worldspace that pull the blur towards their own values, on top of whatever the
+// weather table or a context rule picked. They are bucketed into a uniform grid per worldspace, so finding the
+// zones around the player is one hash probe, and that probe only runs when the player crosses into another
+// grid cell. Game-agnostic like the controller, worldspaces are already resolved to FormIDs by the caller.
+namespace Zones {
+
+	enum class Shape : std::uint8_t {
+		kSphere = 0,
+		kBox    = 1
+	};
+
+	struct Point {
+		float x = 0.0f;
+		float y = 0.0f;
+		float z = 0.0f;
+	};
+
+	/**
+	 * @brief A zone from the settings with its worldspace resolved.
+	 */
+	struct ZoneInput {
+		bool          enabled    = true;
+		std::uint32_t worldspace = 0;
+		Shape         shape      = Shape::kSphere;
+		Point         center;                 // kSphere
+		float         radius     = 0.0f;
+		Point         min;                    // kBox, inclusive
+		Point         max;
+		float         strength   = 1.0f;
+		float         range      = 100.0f;    // Row units, like blurRange
+		float         falloff    = 0.0f;      // Distance inside the edge over which the zone fades in, 0 is a hard edge
+	};
+
+	/**
+	 * @brief The zones at a position folded into one map over the weather result, applied as
+	 *        keep * value + add. Each zone is a lerp towards its own values by its weight, taken from the
+	 *        last zone in the settings to the first, so the topmost zone wins where zones overlap.
+	 */
+	struct Sample {
+		float         keep      = 1.0f;
+		float         strength  = 0.0f;
+		float         range     = 0.0f;  // Controller units
+		std::uint32_t signature = 0;     // Which zones contribute, 0 for none
+
+		float Strength(float a_base) const { return keep * a_base + strength; }
+		float Range(float a_base) const { return keep * a_base + range; }
+
+		bool operator==(const Sample&) const = default;
+	};
+
+	/**
+	 * @brief Every zone of every worldspace, bucketed into cellSize squares over X and Y. Height is only
+	 *        checked when a candidate is evaluated, so a zone can cover a valley but not the peak above it.
+	 */
+	class Grid {
+		public:
+			static constexpr float        cellSize        = 4096.0f;  // One exterior cell
+			static constexpr std::int32_t maxCellIndex    = 32767;    // Grid coordinates are clamped to +-this
+			static constexpr std::size_t  maxCellsPerZone = 1 << 16;  // A zone covering more is dropped as a typo
+
+			struct CellCoord {
+				std::int32_t x = 0;
+				std::int32_t y = 0;
+
+				bool operator==(const CellCoord&) const = default;
+			};
+
+			void Compile(std::span<const ZoneInput> a_zones);
+
+			/**
+			 * @return Indices of the zones touching a cell, in settings order. Empty for unknown worldspaces.
+			 */
+			std::span<const std::uint32_t> Candidates(std::uint32_t a_worldspace, CellCoord a_cell) const;
+
+			/**
+			 * @brief Folds the candidates' weights at a position into a sample.
+			 * @param a_inFalloff Set when the position is in some zone's falloff band, where the sample moves with it.
+			 */
+			Sample Evaluate(std::span<const std::uint32_t> a_candidates, const Point& a_position, bool* a_inFalloff = nullptr) const;
+
+			static CellCoord CellOf(const Point& a_position);
+
+			bool        Empty() const { return _zones.empty(); }
+			std::size_t Size() const { return _zones.size(); }
+			std::size_t CellCount() const { return _cellCount; }
+			std::size_t DroppedZones() const { return _droppedZones; }
+
+		private:
+			struct Compiled {
+				Shape         shape;
+				Point         center;
+				float         radius;
+				Point         min;
+				Point         max;
+				float         strength;
+				float         range;
+				float         falloff;
+				std::uint32_t id;  // Settings index, hashed into the signature
+			};
+
+			struct Bucket {
+				std::uint32_t offset = 0;
+				std::uint32_t count  = 0;
+			};
+
+			static std::uint32_t CellKey(CellCoord a_cell);  // Never 0, which FormMap reserves
+			float                Weight(const Compiled& a_zone, const Point& a_position) const;
+
+			std::vector<Compiled>                      _zones;
+			std::vector<std::uint32_t>                 _cellZones;   // Every bucket's zone indices, back to back
+			WeatherIndex::FormMap<std::uint32_t>       _worldIndex;  // Worldspace FormID -> index + 1 into _worlds
+			std::vector<WeatherIndex::FormMap<Bucket>> _worlds;      // Cell key -> bucket, per worldspace
+			std::size_t                                _cellCount    = 0;
+			std::size_t                                _droppedZones = 0;
+	};
+
+	/**
+	 * @brief Follows the player through a grid. The grid is only asked for candidates when the worldspace or
+	 *        cell changes; in between, only the candidates already found are re-evaluated, and only while
+	 *        there are any.
+	 */
+	class Tracker {
+		public:
+			/**
+			 * @return true if the sample changed.
+			 */
+			bool Update(const Grid& a_grid, std::uint32_t a_worldspace, const Point& a_position);
+
+			/**
+			 * @brief Forgets the cached cell, call after the grid was recompiled.
+			 */
+			void Reset();
+
+			const Sample& Get() const { return _sample; }
+			bool          InFalloff() const { return _inFalloff; }
+			std::uint64_t Lookups() const { return _lookups; }
+
+		private:
+			std::span<const std::uint32_t> _candidates;
+			Sample                         _sample;
+			std::uint32_t                  _worldspace = 0;
+			Grid::CellCoord                _cell;
+			bool                           _valid      = false;
+			bool                           _inFalloff  = false;
+			std::uint64_t                  _lookups    = 0;
+	};
+}
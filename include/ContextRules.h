@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "WeatherIndex.h"
+
+// Context rules pick blur values from more than the weather: interior/exterior, worldspace,
+// location keywords and the in-game hour. Like the controller this is game-agnostic, every
+// form is already resolved to a FormID by the caller.
+namespace Rules {
+
+	enum class Cell : std::uint8_t {
+		kAny      = 0,
+		kInterior = 1,
+		kExterior = 2
+	};
+
+	/**
+	 * @brief A rule from the settings with its forms resolved. A zero FormID means "any".
+	 */
+	struct RuleInput {
+		bool                       enabled      = true;
+		std::uint32_t              weather      = 0;
+		Cell                       cell         = Cell::kAny;
+		std::uint32_t              worldspace   = 0;
+		std::vector<std::uint32_t> keywords;           // Matches if the location has any of them
+		std::uint8_t               hourStart    = 0;   // [start, end), wraps past midnight, start == end is all day
+		std::uint8_t               hourEnd      = 0;
+		float                      strength     = 1.0f;
+		float                      range        = 100.0f;
+		bool                       staticToggle = false;
+		std::uint32_t              source       = 0;   // Index in the settings, for reporting which rule matched
+	};
+
+	/**
+	 * @brief Everything a rule can match against, sampled by the caller when one of the inputs changes.
+	 */
+	struct Context {
+		std::uint32_t                  weather    = 0;
+		bool                           interior   = false;
+		std::uint32_t                  worldspace = 0;
+		std::span<const std::uint32_t> keywords;
+		std::uint32_t                  hour       = 0;  // 0 - 23
+	};
+
+	/**
+	 * @brief Rules flattened into bitmask rows, evaluated top to bottom with first-match semantics.
+	 *
+	 * Every condition becomes a mask or a FormID compare, so a lookup is a handful of ANDs per rule.
+	 * Up to 64 distinct location keywords get a bit each; a rule whose keywords all fall past that
+	 * limit can never match rather than silently matching everywhere.
+	 */
+	class DecisionTable {
+		public:
+			static constexpr std::size_t   maxKeywords = 64;
+			static constexpr std::uint32_t allHours    = (1u << 24) - 1;
+
+			void Compile(std::span<const RuleInput> a_rules);
+
+			/**
+			 * @return The values of the first matching rule, or nullptr when no rule applies.
+			 */
+			const WeatherIndex::Entry* Evaluate(const Context& a_context) const;
+
+			/**
+			 * @return The settings index of the rule Evaluate() returned a_value from, -1 for nullptr.
+			 */
+			std::int32_t SourceOf(const WeatherIndex::Entry* a_value) const;
+
+			bool        Empty() const { return _rules.empty(); }
+			std::size_t Size() const { return _rules.size(); }
+			bool        DependsOnHour() const { return _dependsOnHour; }
+			bool        DependsOnLocation() const { return _keywordCount > 0; }
+			std::size_t DroppedKeywords() const { return _droppedKeywords; }
+
+			static std::uint32_t HourMask(std::uint8_t a_start, std::uint8_t a_end);
+
+		private:
+			struct CompiledRule {
+				std::uint32_t       weather;
+				std::uint32_t       worldspace;
+				std::uint64_t       keywordMask;
+				std::uint32_t       hourMask;
+				std::uint8_t        cellMask;      // bit 0 exterior, bit 1 interior
+				bool                needsKeyword;  // Had keywords, even if none of them got a bit
+				std::uint32_t       source;
+				WeatherIndex::Entry value;
+			};
+
+			std::uint64_t KeywordMask(std::span<const std::uint32_t> a_keywords) const;
+
+			std::vector<CompiledRule>               _rules;
+			WeatherIndex::FormMap<std::uint8_t>     _keywordBits;
+			std::size_t                             _keywordCount    = 0;
+			std::size_t                             _droppedKeywords = 0;
+			bool                                    _dependsOnHour   = false;
+	};
+}
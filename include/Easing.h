@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+// Easing curves for blur transitions. Every curve is tabulated once at startup, so a transition evaluated
+// from its elapsed time costs an indexed lerp instead of a pow or exp per frame.
+namespace Easing {
+
+	enum Curve : std::uint8_t {
+		kLinear,
+		kSmoothStep,
+		kEaseIn,
+		kEaseOut,
+		kEaseInOut,
+		kExponential,  // Fast start and a long tail, the closest to the original fade
+		kCurveCount
+	};
+
+	inline constexpr float defaultDuration = 5.0f;  // Seconds
+	inline constexpr Curve defaultCurve    = kExponential;
+
+	// JSON values, in Curve order
+	inline constexpr std::string_view curveNames[kCurveCount] = {
+		"linear",
+		"smoothStep",
+		"easeIn",
+		"easeOut",
+		"easeInOut",
+		"exponential"
+	};
+
+	inline std::optional<Curve> CurveFromName(std::string_view a_name) {
+		for (std::uint32_t i = 0; i < kCurveCount; i++) {
+			if (curveNames[i] == a_name) return static_cast<Curve>(i);
+		}
+		return std::nullopt;
+	}
+
+	class Table {
+		public:
+			static constexpr std::size_t resolution = 256;
+
+			Table() {
+				for (std::uint32_t curve = 0; curve < kCurveCount; curve++) {
+					for (std::size_t i = 0; i < resolution; i++) {
+						_weights[curve][i] = Evaluate(static_cast<Curve>(curve), static_cast<float>(i) / (resolution - 1));
+					}
+					// Exact ends, so a finished transition lands on its target bit for bit
+					_weights[curve].front() = 0.0f;
+					_weights[curve].back()  = 1.0f;
+				}
+			}
+
+			/**
+			 * @param a_progress Elapsed over duration, clamped to [0, 1].
+			 * @return Weight of the target, 0 at the start and exactly 1 at the end.
+			 */
+			float Sample(Curve a_curve, float a_progress) const {
+				if (!(a_progress > 0.0f)) return 0.0f;
+				if (a_progress >= 1.0f || a_curve >= kCurveCount) return 1.0f;
+
+				const float       position = a_progress * (resolution - 1);
+				const std::size_t index    = static_cast<std::size_t>(position);
+				const auto&       weights  = _weights[a_curve];
+				return std::lerp(weights[index], weights[index + 1], position - static_cast<float>(index));
+			}
+
+		private:
+			static float Evaluate(Curve a_curve, float a_t) {
+				switch (a_curve) {
+				case kSmoothStep:
+					return a_t * a_t * (3.0f - 2.0f * a_t);
+				case kEaseIn:
+					return a_t * a_t;
+				case kEaseOut:
+					return 1.0f - (1.0f - a_t) * (1.0f - a_t);
+				case kEaseInOut:
+					return a_t < 0.5f ? 4.0f * a_t * a_t * a_t : 1.0f - std::pow(-2.0f * a_t + 2.0f, 3.0f) / 2.0f;
+				case kExponential:
+					return (1.0f - std::exp2(-10.0f * a_t)) / (1.0f - std::exp2(-10.0f));
+				default:
+					return a_t;
+				}
+			}
+
+			std::array<std::array<float, resolution>, kCurveCount> _weights{};
+	};
+
+	inline const Table table;
+}
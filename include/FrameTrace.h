@@ -0,0 +1,418 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "BlurController.h"
+#include "Published.h"
+
+// Per-frame record of what went into and came out of Blur::Controller::Update(), kept in a fixed-size
+// ring while the recorder is enabled and written out on demand or on a crash. A trace carries the
+// weather table it was recorded against, so tools/blur-replay can feed it through the same controller.
+namespace Trace {
+
+	inline constexpr std::array<char, 4> fileMagic   = { 'D', 'B', 'F', 'T' };
+	inline constexpr std::uint32_t       fileVersion = 4;  // 2: closed-form transitions, 3: automatic entries, 4: blur zones
+
+	enum FrameFlags : std::uint8_t {
+		kInstanceAlive    = 1 << 0,  // IsInstanceAlive() before the update
+		kOverride         = 1 << 1,  // A context rule override was set
+		kOverrideStatic   = 1 << 2,
+		kLifecycleShift   = 4        // Two bits of Blur::Controller::Lifecycle after the update
+	};
+
+	struct Frame {
+		double        elapsed;  // Transition clock after the update
+
+		// Inputs
+		float         delta;
+		std::uint32_t currentWeather;
+		std::uint32_t previousWeather;
+		float         gameHour;
+		float         overrideStrength;  // Valid with kOverride, already in controller units
+		float         overrideRange;
+		float         overrideDuration;
+		float         zoneKeep;          // Blur::Controller::SetZone() input, see Zones::Sample
+		float         zoneStrength;
+		float         zoneRange;
+		std::uint32_t zoneSignature;
+
+		// Outputs
+		float         targetStrength;
+		float         targetRange;
+		float         appliedStrength;
+		float         appliedRange;
+		float         startStrength;
+		float         startRange;
+		float         duration;
+		float         parkedTime;
+		float         baseStrength;      // Target before the zones
+		float         baseRange;
+
+		std::uint32_t settingsEpoch;  // Published settings the controller had compiled
+		std::uint32_t nanoseconds;    // Cost of the Update() call
+		std::uint16_t events;         // Blur::UpdateEvent
+		std::uint8_t  mode;
+		std::uint8_t  flags;          // FrameFlags
+		std::uint8_t  easing;
+		std::uint8_t  overrideEasing;
+		std::uint8_t  reserved[6];
+	};
+
+	static_assert(sizeof(Frame) == 112);
+
+	/**
+	 * @brief Captures a frame right after a_controller.Update() ran with these inputs.
+	 * @param a_instanceAlive What IImodSink::IsInstanceAlive() returned before the update.
+	 */
+	inline Frame Capture(const Blur::Controller& a_controller, float a_delta, const Blur::ISky& a_sky, bool a_instanceAlive, std::uint32_t a_events,
+		std::uint32_t a_settingsEpoch, std::uint64_t a_nanoseconds) {
+		const auto  checkpoint = a_controller.GetCheckpoint();
+		const auto& override   = a_controller.GetOverride();
+		const auto& zone       = a_controller.GetZone();
+
+		auto flags = static_cast<std::uint8_t>(static_cast<std::uint8_t>(checkpoint.lifecycle) << kLifecycleShift);
+		if (a_instanceAlive) flags |= kInstanceAlive;
+		if (override) flags |= kOverride;
+		if (override && override->staticToggle) flags |= kOverrideStatic;
+
+		return { checkpoint.elapsed,
+			a_delta,
+			a_sky.GetCurrentWeather(),
+			a_sky.GetPreviousWeather(),
+			a_sky.GetGameHour(),
+			override ? override->strength : 0.0f,
+			override ? override->range : 0.0f,
+			override ? override->duration : 0.0f,
+			zone.keep,
+			zone.strength,
+			zone.range,
+			zone.signature,
+			checkpoint.targetStrength,
+			checkpoint.targetRange,
+			checkpoint.appliedStrength,
+			checkpoint.appliedRange,
+			checkpoint.startStrength,
+			checkpoint.startRange,
+			static_cast<float>(checkpoint.duration),
+			checkpoint.parkedTime,
+			checkpoint.baseStrength,
+			checkpoint.baseRange,
+			a_settingsEpoch,
+			static_cast<std::uint32_t>(std::min<std::uint64_t>(a_nanoseconds, UINT32_MAX)),
+			static_cast<std::uint16_t>(a_events),
+			static_cast<std::uint8_t>(checkpoint.mode),
+			flags,
+			static_cast<std::uint8_t>(checkpoint.easing),
+			static_cast<std::uint8_t>(override ? override->easing : Easing::defaultCurve),
+			{} };
+	}
+
+	/**
+	 * @brief The context rule override a frame was updated with, valid with kOverride.
+	 */
+	inline WeatherIndex::Entry OverrideOf(const Frame& a_frame) {
+		return { a_frame.overrideStrength, a_frame.overrideRange, (a_frame.flags & kOverrideStatic) != 0,
+			static_cast<Easing::Curve>(a_frame.overrideEasing), a_frame.overrideDuration };
+	}
+
+	/**
+	 * @brief The blur zone sample a frame was updated with.
+	 */
+	inline Zones::Sample ZoneOf(const Frame& a_frame) {
+		return { a_frame.zoneKeep, a_frame.zoneStrength, a_frame.zoneRange, a_frame.zoneSignature };
+	}
+
+	/**
+	 * @brief Rebuilds the checkpoint a frame ends in.
+	 */
+	inline Blur::Controller::Checkpoint CheckpointOf(const Frame& a_frame) {
+		return { a_frame.currentWeather,
+			static_cast<Blur::Mode>(a_frame.mode),
+			a_frame.targetStrength,
+			a_frame.targetRange,
+			a_frame.appliedStrength,
+			a_frame.appliedRange,
+			a_frame.startStrength,
+			a_frame.startRange,
+			a_frame.elapsed,
+			a_frame.duration,
+			static_cast<Easing::Curve>(a_frame.easing),
+			static_cast<Blur::Controller::Lifecycle>((a_frame.flags >> kLifecycleShift) & 0x3),
+			a_frame.parkedTime,
+			a_frame.baseStrength,
+			a_frame.baseRange };
+	}
+
+	/**
+	 * @brief Fixed-size ring of the latest frames. Written by the game thread only, the buffer is
+	 *        allocated on the first Push() so a disabled recorder costs nothing.
+	 */
+	class Ring {
+		public:
+			static constexpr std::size_t capacity = 8192;  // ~2 minutes at 60 FPS, 896 KiB
+
+			void Push(const Frame& a_frame) {
+				if (_frames.empty()) _frames.resize(capacity);
+				const auto written          = _written.load(std::memory_order_relaxed);
+				_frames[written % capacity] = a_frame;
+				_written.store(written + 1, std::memory_order_release);
+			}
+
+			void Clear() { _written.store(0, std::memory_order_release); }
+
+			std::size_t Size() const { return static_cast<std::size_t>(std::min<std::uint64_t>(_written.load(std::memory_order_acquire), capacity)); }
+
+			/**
+			 * @brief Copies the recorded frames out oldest first, without allocating. Safe from a crash handler on
+			 *        another thread, which at worst gets the frame being overwritten in a torn state.
+			 * @param a_out Room for capacity frames, any alignment.
+			 * @return The number of frames copied.
+			 */
+			std::size_t CopyTo(void* a_out) const {
+				const auto written = _written.load(std::memory_order_acquire);
+				const auto count   = static_cast<std::size_t>(std::min<std::uint64_t>(written, capacity));
+				if (!count) return 0;
+
+				const auto first = static_cast<std::size_t>((written - count) % capacity);
+				const auto head  = std::min(count, capacity - first);
+				std::memcpy(a_out, _frames.data() + first, head * sizeof(Frame));
+				std::memcpy(static_cast<std::byte*>(a_out) + head * sizeof(Frame), _frames.data(), (count - head) * sizeof(Frame));
+				return count;
+			}
+
+			/**
+			 * @return The recorded frames, oldest first.
+			 */
+			std::vector<Frame> Frames() const {
+				std::vector<Frame> frames(Size());
+				CopyTo(frames.data());
+				return frames;
+			}
+
+		private:
+			std::vector<Frame>         _frames;
+			std::atomic<std::uint64_t> _written{ 0 };
+	};
+
+	struct FileHeader {
+		std::array<char, 4> magic;
+		std::uint32_t       version;
+		std::uint32_t       frameCount;
+		std::uint32_t       rowCount;
+		std::uint32_t       keyframeCount;
+		std::uint32_t       channelCount;
+		std::uint32_t       settingsEpoch;  // Epoch of the rows below, frames recorded against another one cannot be replayed
+		std::uint32_t       automaticCount;  // Derived Mode::kAutomatic entries, after the channels
+	};
+
+	enum RowFlags : std::uint32_t {
+		kEnabled = 1 << 0,
+		kStatic  = 1 << 1
+	};
+
+	struct Row {
+		std::uint32_t formID;
+		std::uint32_t flags;
+		float         strength;
+		float         range;
+		float         duration;
+		std::uint32_t easing;
+		std::uint32_t curveOffset;
+		std::uint32_t curveCount;
+		std::uint32_t channelOffset;
+		std::uint32_t channelCount;
+	};
+
+	// Layout: header, rows, keyframes, channels, automatic entries, frames.
+	static_assert(sizeof(FileHeader) == 32);
+	static_assert(sizeof(Row) == 40);
+
+	/**
+	 * @brief A decoded trace. The rows' spans point into tables, so it is not copyable.
+	 */
+	struct File {
+		File()                       = default;
+		File(const File&)            = delete;
+		File& operator=(const File&) = delete;
+
+		std::uint32_t      settingsEpoch = 0;
+		Published::Tables             tables;
+		std::vector<AutoBlur::Derived> automatic;
+		std::vector<Frame>            frames;
+	};
+
+	/**
+	 * @brief Serializes the frames together with the weather rows and automatic entries they were recorded against.
+	 */
+	inline std::string Encode(std::span<const Frame> a_frames, const Published::Tables& a_tables, std::span<const AutoBlur::Derived> a_automatic,
+		std::uint32_t a_settingsEpoch) {
+		std::vector<Row> rows;
+		rows.reserve(a_tables.rows.size());
+
+		std::uint32_t keyframes = 0;
+		std::uint32_t channels  = 0;
+		for (const auto& input : a_tables.rows) {
+			rows.push_back({ input.formID,
+				(input.enabled ? kEnabled : 0u) | (input.staticToggle ? kStatic : 0u),
+				input.strength,
+				input.range,
+				input.duration,
+				input.easing,
+				keyframes,
+				static_cast<std::uint32_t>(input.curve.size()),
+				channels,
+				static_cast<std::uint32_t>(input.channels.size()) });
+			keyframes += static_cast<std::uint32_t>(input.curve.size());
+			channels  += static_cast<std::uint32_t>(input.channels.size());
+		}
+
+		const FileHeader header{ fileMagic, fileVersion, static_cast<std::uint32_t>(a_frames.size()), static_cast<std::uint32_t>(rows.size()), keyframes, channels,
+			a_settingsEpoch, static_cast<std::uint32_t>(a_automatic.size()) };
+
+		std::string buffer;
+		buffer.reserve(sizeof(header) + rows.size() * sizeof(Row) + keyframes * sizeof(TimeCurve::Keyframe) + channels * sizeof(Imod::ChannelTarget) +
+		               a_automatic.size_bytes() + a_frames.size() * sizeof(Frame));
+		buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+		buffer.append(reinterpret_cast<const char*>(rows.data()), rows.size() * sizeof(Row));
+		for (const auto& input : a_tables.rows) {
+			buffer.append(reinterpret_cast<const char*>(input.curve.data()), input.curve.size_bytes());
+		}
+		for (const auto& input : a_tables.rows) {
+			buffer.append(reinterpret_cast<const char*>(input.channels.data()), input.channels.size_bytes());
+		}
+		buffer.append(reinterpret_cast<const char*>(a_automatic.data()), a_automatic.size_bytes());
+		buffer.append(reinterpret_cast<const char*>(a_frames.data()), a_frames.size_bytes());
+		return buffer;
+	}
+
+	/**
+	 * @brief A trace encoded ahead of time with room for a full ring, so a crash handler only has to copy the
+	 *        frames in: no allocation, no locks, nothing but the ring read.
+	 *
+	 * The game thread prepares it again whenever the rows it carries change. A crash that lands while it does
+	 * gets no file rather than a torn one, and once Fill() has run the file stays as it is.
+	 */
+	class CrashFile {
+		public:
+			/**
+			 * @brief Game thread. Encodes everything but the frames.
+			 */
+			void Prepare(const Published::Tables& a_tables, std::span<const AutoBlur::Derived> a_automatic, std::uint32_t a_settingsEpoch) {
+				const auto prefix = Encode({}, a_tables, a_automatic, a_settingsEpoch);
+				if (!Claim(kPreparing)) return;
+
+				_buffer.resize(prefix.size() + Ring::capacity * sizeof(Frame));
+				std::memcpy(_buffer.data(), prefix.data(), prefix.size());
+				_prefixSize = prefix.size();
+				_state.store(kReady, std::memory_order_release);
+			}
+
+			/**
+			 * @brief Game thread. Keeps Fill() from writing anything until the next Prepare(), the buffer stays allocated.
+			 */
+			void Disarm() {
+				auto expected = kReady;
+				_state.compare_exchange_strong(expected, kEmpty);
+			}
+
+			bool IsArmed() const { return _state.load(std::memory_order_relaxed) == kReady; }
+
+			/**
+			 * @brief Any thread, once. Copies the ring in after the prepared tables.
+			 * @return The complete trace, empty if nothing was prepared or a Prepare() was interrupted.
+			 */
+			std::span<const char> Fill(const Ring& a_ring) {
+				auto expected = kReady;
+				if (!_state.compare_exchange_strong(expected, kFilled, std::memory_order_acquire)) return {};
+
+				const auto count = a_ring.CopyTo(_buffer.data() + _prefixSize);
+
+				FileHeader header;
+				std::memcpy(&header, _buffer.data(), sizeof(header));
+				header.frameCount = static_cast<std::uint32_t>(count);
+				std::memcpy(_buffer.data(), &header, sizeof(header));
+
+				return { _buffer.data(), _prefixSize + count * sizeof(Frame) };
+			}
+
+		private:
+			enum State : std::uint32_t {
+				kEmpty,
+				kPreparing,
+				kReady,
+				kFilled  // Final, the crash handler owns the buffer
+			};
+
+			bool Claim(State a_state) {
+				auto state = _state.load(std::memory_order_relaxed);
+				while (state != kFilled) {
+					if (_state.compare_exchange_weak(state, a_state, std::memory_order_acquire)) return true;
+				}
+				return false;
+			}
+
+			std::vector<char>  _buffer;
+			std::size_t        _prefixSize = 0;
+			std::atomic<State> _state{ kEmpty };
+	};
+
+	/**
+	 * @brief Fails on any inconsistency, a_out is only meaningful on success.
+	 */
+	inline bool Decode(std::span<const std::byte> a_data, File& a_out) {
+		FileHeader header{};
+		if (a_data.size() < sizeof(header)) return false;
+		std::memcpy(&header, a_data.data(), sizeof(header));
+		if (header.magic != fileMagic || header.version != fileVersion) return false;
+
+		const std::size_t expectedSize = sizeof(header) + static_cast<std::size_t>(header.rowCount) * sizeof(Row) +
+		                                 static_cast<std::size_t>(header.keyframeCount) * sizeof(TimeCurve::Keyframe) +
+		                                 static_cast<std::size_t>(header.channelCount) * sizeof(Imod::ChannelTarget) +
+		                                 static_cast<std::size_t>(header.automaticCount) * sizeof(AutoBlur::Derived) +
+		                                 static_cast<std::size_t>(header.frameCount) * sizeof(Frame);
+		if (a_data.size() != expectedSize) return false;
+
+		const auto rowBase       = a_data.data() + sizeof(header);
+		const auto keyframeBase  = rowBase + static_cast<std::size_t>(header.rowCount) * sizeof(Row);
+		const auto channelBase   = keyframeBase + static_cast<std::size_t>(header.keyframeCount) * sizeof(TimeCurve::Keyframe);
+		const auto automaticBase = channelBase + static_cast<std::size_t>(header.channelCount) * sizeof(Imod::ChannelTarget);
+		const auto frameBase     = automaticBase + static_cast<std::size_t>(header.automaticCount) * sizeof(AutoBlur::Derived);
+
+		auto& tables = a_out.tables;
+		tables.keyframes.resize(header.keyframeCount);
+		tables.channels.resize(header.channelCount);
+		std::memcpy(tables.keyframes.data(), keyframeBase, tables.keyframes.size() * sizeof(TimeCurve::Keyframe));
+		std::memcpy(tables.channels.data(), channelBase, tables.channels.size() * sizeof(Imod::ChannelTarget));
+
+		tables.rows.clear();
+		tables.rows.reserve(header.rowCount);
+		for (std::uint32_t i = 0; i < header.rowCount; i++) {
+			Row row{};
+			std::memcpy(&row, rowBase + static_cast<std::size_t>(i) * sizeof(Row), sizeof(row));
+
+			if (row.curveOffset > header.keyframeCount || row.curveCount > header.keyframeCount - row.curveOffset ||
+				row.channelOffset > header.channelCount || row.channelCount > header.channelCount - row.channelOffset) {
+				return false;
+			}
+			tables.rows.push_back({ row.formID, (row.flags & kEnabled) != 0, row.strength, row.range, (row.flags & kStatic) != 0, row.duration,
+				static_cast<Easing::Curve>(row.easing), std::span(tables.keyframes).subspan(row.curveOffset, row.curveCount), std::span(tables.channels).subspan(row.channelOffset, row.channelCount) });
+		}
+		tables.authoredRows = tables.rows.size();
+
+		a_out.automatic.resize(header.automaticCount);
+		std::memcpy(a_out.automatic.data(), automaticBase, a_out.automatic.size() * sizeof(AutoBlur::Derived));
+
+		a_out.frames.resize(header.frameCount);
+		std::memcpy(a_out.frames.data(), frameBase, a_out.frames.size() * sizeof(Frame));
+		a_out.settingsEpoch = header.settingsEpoch;
+		return true;
+	}
+}
@@ -1,61 +1,183 @@
-#pragma once
-
-#include "Settings.h"
-
-namespace Hooks {
-
-    class BlurManager {
-        public:
-            static BlurManager& GetSingleton() {
-                static BlurManager instance;
-                return instance;
-            }
-        
-            bool Initialize();
-        
-            void OnPlayerUpdate(float a_delta);
-        
-            void NotifySettingsChanged() {
-                _settingsDirty = true;
-                Settings::SaveAll();
-            }
-        
-            void SetSourceIMOD(RE::TESImageSpaceModifier* a_outIMOD) { _sourceIMod = a_outIMOD; }
-        
-        private:
-            BlurManager()                              = default;
-            ~BlurManager()                             = default;
-            BlurManager(const BlurManager&)            = delete;
-            BlurManager(BlurManager&&)                 = delete;
-            BlurManager& operator=(const BlurManager&) = delete;
-            BlurManager& operator=(BlurManager&&)      = delete;
-        
-            void CopyIMODData(RE::TESImageSpaceModifier* a_source, RE::TESImageSpaceModifier* a_dest);
-        
-            RE::TESImageSpaceModifier*          _imod           = nullptr;
-            RE::TESImageSpaceModifier*          _sourceIMod     = nullptr;
-            RE::ImageSpaceModifierInstanceForm* _imodInstance   = nullptr;
-            RE::TESWeather*                     _currentWeather = nullptr;
-        
-            // Settings Data
-            bool  _settingsDirty          = true;
-            bool  _lastCellWasInterior    = false;
-        
-            // Row Data
-            float _currentTargetStrength  = 0.0f;
-            float _currentTargetRange     = 0.0f;
-            float _currentAppliedStrength = 0.0f;
-            float _currentAppliedRange    = 0.0f;
-            bool  _useStaticTransition    = false;
-            bool  _effectIsActive         = false;
-    };
-
-
-    void InstallHooks();
-
-    struct UpdateHook {
-        static void Install();
-        static void Update(RE::Actor* a_this, float a_delta);
-        static inline REL::Relocation<decltype(Update)> Update_;
-    };
+#pragma once
+
+#include "AutoBlur.h"
+#include "BlurController.h"
+#include "BlurZones.h"
+#include "ContextRules.h"
+#include "FrameTrace.h"
+#include "Published.h"
+#include "Settings.h"
+
+namespace Hooks {
+
+    // Owns the runtime IMOD and feeds the game state into the Blur::Controller state machine.
+    // Once the applied values reach their targets the manager goes idle and only wakes for the
+    // reasons below, or a short poll that catches weather and hour changes, which have no event.
+    class BlurManager :
+        private Blur::ISky,
+        private Blur::IImodSink,
+        private RE::BSTEventSink<RE::MenuOpenCloseEvent>,
+        private RE::BSTEventSink<RE::BGSActorCellEvent> {
+        public:
+            enum WakeReason : std::uint32_t {
+                kWakeSettings   = 1 << 0,
+                kWakeCell       = 1 << 1,
+                kWakeMenu       = 1 << 2,
+                kWakeTransition = 1 << 3,
+                kWakeTrace      = 1 << 4,   // Dump the frame recorder
+                kWakeZone       = 1 << 5,   // Inside a blur zone's falloff band, where the blur follows the player
+                kWakeMask       = 0xFFFF,
+                kSuspended      = 1 << 16   // A pausing menu or the loading screen is up
+            };
+
+            static constexpr float idlePollInterval = 0.25f;  // Seconds between idle weather/hour checks
+
+            static BlurManager& GetSingleton() {
+                static BlurManager instance;
+                return instance;
+            }
+        
+            bool Initialize();
+            void RegisterEvents();
+        
+            void OnPlayerUpdate(float a_delta);
+
+            /**
+             * @brief Gate for the update hook. While awake or suspended this is a single relaxed load,
+             *        while idle it also advances the poll timer.
+             */
+            bool ShouldUpdate(float a_delta) {
+                const auto state = _state.load(std::memory_order_relaxed);
+                if (state & kSuspended) return false;
+                if (state & kWakeMask) return true;
+
+                _idleTime += a_delta;
+                return _idleTime >= idlePollInterval;
+            }
+
+            void Wake(WakeReason a_reason) { _state.fetch_or(a_reason, std::memory_order_relaxed); }
+        
+            // UI thread: the working copy was edited, PublishPendingEdits() hands it over once the frame's edits are done
+            void NotifySettingsChanged() { _editsPending = true; }
+
+            /**
+             * @brief UI thread, with g_advancedWeatherData.lock held.
+             * @return true if the working copy was edited since the last call and has been published.
+             */
+            bool PublishPendingEdits() {
+                if (!std::exchange(_editsPending, false)) return false;
+                PublishSettings(nullptr);
+                return true;
+            }
+
+            /**
+             * @brief Resolves the working copy in g_advancedWeatherData and publishes it to the game thread.
+             *        Any thread, with g_advancedWeatherData.lock held.
+             * @param a_diff What changed since the last publish, nullptr to have everything recompiled.
+             */
+            void PublishSettings(const Settings::RowDiff* a_diff);
+        
+            void SetSourceIMOD(RE::TESImageSpaceModifier* a_outIMOD) { _sourceIMod = a_outIMOD; }
+
+            // Any thread: the recorded frames are written on the next update, the ring belongs to the game thread
+            void RequestTraceDump() { Wake(kWakeTrace); }
+
+            /**
+             * @brief Game thread. Writes the frame recorder's ring and the weather rows it was recorded against.
+             */
+            bool DumpTrace(const std::string& a_path);
+
+            /**
+             * @brief Unhandled exception filter only, on whichever thread crashed. Copies the ring into the trace the
+             *        game thread prepared and writes it with plain Win32 calls, nothing else.
+             */
+            void DumpCrashTrace(const wchar_t* a_path);
+
+            static constexpr std::size_t kGameThreadReader = 0;
+        
+        private:
+            BlurManager()                              = default;
+            ~BlurManager() override                    = default;
+            BlurManager(const BlurManager&)            = delete;
+            BlurManager(BlurManager&&)                 = delete;
+            BlurManager& operator=(const BlurManager&) = delete;
+            BlurManager& operator=(BlurManager&&)      = delete;
+        
+            void CopyIMODData(RE::TESImageSpaceModifier* a_source, RE::TESImageSpaceModifier* a_dest);
+            void CompilePublished();
+            void UpdateRuleContext();
+            void UpdateZone();
+            void CountEvents(std::uint32_t a_events);
+            void LoadWeatherTraits();
+            void RebuildAutomatic();
+
+            // Event sinks
+            RE::BSEventNotifyControl ProcessEvent(const RE::MenuOpenCloseEvent* a_event, RE::BSTEventSource<RE::MenuOpenCloseEvent>*) override;
+            RE::BSEventNotifyControl ProcessEvent(const RE::BGSActorCellEvent* a_event, RE::BSTEventSource<RE::BGSActorCellEvent>*) override;
+
+            // Blur::ISky
+            std::uint32_t GetCurrentWeather() const override;
+            std::uint32_t GetPreviousWeather() const override;
+            float         GetGameHour() const override;
+
+            // Blur::IImodSink
+            void SetChannels(std::uint32_t a_mask, const Imod::Values& a_values) override;
+            void Trigger() override;
+            void Stop() override;
+            bool IsInstanceAlive() const override;
+        
+            RE::TESImageSpaceModifier*          _imod           = nullptr;
+            RE::TESImageSpaceModifier*          _sourceIMod     = nullptr;
+            RE::NiPointer<RE::ImageSpaceModifierInstanceForm> _imodInstance;
+
+            // Weather Table
+            Blur::Controller                    _controller;
+
+            // Automatic Mode, the traits are read once at data load and derived again whenever the tuning changes
+            std::vector<AutoBlur::WeatherTraits> _weatherTraits;
+            std::vector<AutoBlur::Derived>      _automatic;
+            AutoBlur::Tuning                    _automaticTuning;
+
+            // Context Rules, re-evaluated only when one of the sampled inputs below changes
+            Rules::DecisionTable                _rules;
+            std::vector<std::uint32_t>          _locationKeywords;
+            RE::BGSLocation*                    _lastLocation    = nullptr;
+            std::uint32_t                       _lastWorldspace  = 0;
+            std::uint32_t                       _lastRuleWeather = 0;
+            std::uint32_t                       _lastHour        = 0;
+            std::int32_t                        _activeRule      = -1;  // Settings index, for telemetry
+
+            // Blur Zones, the grid is only probed when the player crosses into another grid cell
+            Zones::Grid                         _zoneGrid;
+            Zones::Tracker                      _zoneTracker;
+        
+            // Settings Data, handed over by whichever thread edited it
+            Published::Slot<Published::Tables, 1> _published;
+            std::uint64_t                       _compiledEpoch = 0;     // Game thread
+            bool                                _editsPending  = false; // UI thread
+            bool  _contextDirty           = true;   // Re-evaluate the rules even if no input moved
+
+            // Idle Gate
+            std::atomic<std::uint32_t>          _state{ kWakeSettings };
+            float                               _idleTime = 0.0f;
+            std::vector<RE::BSFixedString>      _suspendingMenus;  // Menu event thread only
+            bool  _lastCellWasInterior    = false;
+
+            // Frame Recorder, game thread only. The crash file is re-prepared whenever the rows or automatic entries change.
+            Trace::Ring                         _recorder;
+            Trace::CrashFile                    _crashFile;
+            bool                                _crashFileStale = true;
+
+            // Telemetry, game thread only
+            std::uint64_t                       _telemetryFrame = 0;
+    };
+
+
+    void InstallHooks();
+
+    struct UpdateHook {
+        static void Install();
+        static void Update(RE::Actor* a_this, float a_delta);
+        static inline REL::Relocation<decltype(Update)> Update_;
+    };
 }
\ No newline at end of file
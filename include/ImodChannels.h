@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "Easing.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define DB_IMOD_SSE 1
+#endif
+
+// The runtime IMOD parameters a weather row can drive. Values live in packed arrays indexed by Channel,
+// so a frame blends every channel in one pass and reports which ones moved as a bitmask.
+namespace Imod {
+
+	enum Channel : std::uint32_t {
+		kDOFStrength,
+		kDOFRange,
+		kBloomBlurRadius,
+		kCinematicSaturation,
+		kCinematicBrightness,
+		kCinematicContrast,
+		kHDREyeAdaptSpeed,
+		kRadialBlurStrength,
+		kTintRed,
+		kTintGreen,
+		kTintBlue,
+		kTintAlpha,
+		kFadeRed,
+		kFadeGreen,
+		kFadeBlue,
+		kFadeAlpha,
+		kChannelCount
+	};
+
+	static_assert(kChannelCount % 4 == 0, "The blend pass works on groups of four lanes");
+
+	inline constexpr std::uint32_t dofMask    = (1u << kDOFStrength) | (1u << kDOFRange);
+	inline constexpr std::uint32_t noChannels = 0xFFFFFFFF;
+
+	// JSON keys, in Channel order
+	inline constexpr std::string_view channelNames[kChannelCount] = {
+		"dofStrength",
+		"dofRange",
+		"bloomBlurRadius",
+		"cinematicSaturation",
+		"cinematicBrightness",
+		"cinematicContrast",
+		"hdrEyeAdaptSpeed",
+		"radialBlurStrength",
+		"tintRed",
+		"tintGreen",
+		"tintBlue",
+		"tintAlpha",
+		"fadeRed",
+		"fadeGreen",
+		"fadeBlue",
+		"fadeAlpha"
+	};
+
+	inline std::optional<Channel> ChannelFromName(std::string_view a_name) {
+		for (std::uint32_t i = 0; i < kChannelCount; i++) {
+			if (channelNames[i] == a_name) return static_cast<Channel>(i);
+		}
+		return std::nullopt;
+	}
+
+	/**
+	 * @brief One channel a row sets, the rest of the IMOD stays at the source IMAD's values.
+	 */
+	struct ChannelTarget {
+		Channel channel = kBloomBlurRadius;
+		float   value   = 0.0f;
+
+		bool operator==(const ChannelTarget&) const = default;
+	};
+
+	using Values = std::array<float, kChannelCount>;
+
+	static_assert(alignof(Values) <= 16);
+
+	/**
+	 * @return Bitmask of the lanes where the two arrays differ, compared four at a time.
+	 */
+	inline std::uint32_t DifferingLanes(const Values& a_lhs, const Values& a_rhs) {
+		std::uint32_t changed = 0;
+#ifdef DB_IMOD_SSE
+		for (std::uint32_t i = 0; i < kChannelCount; i += 4) {
+			const auto lanes = _mm_movemask_ps(_mm_cmpneq_ps(_mm_loadu_ps(a_lhs.data() + i), _mm_loadu_ps(a_rhs.data() + i)));
+			changed |= static_cast<std::uint32_t>(lanes) << i;
+		}
+#else
+		for (std::uint32_t i = 0; i < kChannelCount; i++) {
+			if (a_lhs[i] != a_rhs[i]) changed |= 1u << i;
+		}
+#endif
+		return changed;
+	}
+
+	/**
+	 * @brief Applied, target and transition start for every channel, packed for the blend pass.
+	 *
+	 * A transition is closed-form: every lane sits at lerp(start, target, weight), where the weight comes from
+	 * the easing table at elapsed / duration. The result only depends on how much time has passed, so the same
+	 * fade plays out identically at any frame rate, and a long frame simply lands further along it. A target
+	 * that moves on its own during a transition (a time-of-day curve) is followed, the start stays put.
+	 * The DOF pair is always blended, the other lanes only while extrasMoving is set.
+	 */
+	struct ChannelState {
+		alignas(16) Values applied{};
+		alignas(16) Values target{};
+		alignas(16) Values start{};  // applied when the running transition began
+
+		double        elapsed  = 0.0;  // Double, so thousands of small frames add up to what one long one does
+		double        duration = 0.0;  // 0 takes the target directly
+		Easing::Curve easing   = Easing::defaultCurve;
+
+		bool extrasMoving = false;  // Set by whoever changes a non-DOF target, cleared once those lanes arrive
+
+		/**
+		 * @brief Starts a transition from the applied values to the current targets.
+		 */
+		void Begin(float a_duration, Easing::Curve a_easing) {
+			start    = applied;
+			elapsed  = 0.0;
+			duration = a_duration > 0.0f ? a_duration : 0.0;
+			easing   = a_easing;
+		}
+
+		/**
+		 * @brief Moves the transition clock, the lanes follow on the next Step().
+		 */
+		void Advance(float a_delta) {
+			if (elapsed < duration) elapsed = std::min(elapsed + a_delta, duration);
+		}
+
+		/**
+		 * @return How far the running transition is, the weight of the target in [0, 1].
+		 */
+		float Weight() const { return duration > 0.0 ? Easing::table.Sample(easing, static_cast<float>(elapsed / duration)) : 1.0f; }
+
+		/**
+		 * @brief Re-evaluates every moving lane at the current point of the transition.
+		 * @return Bitmask of the channels whose applied value changed.
+		 */
+		std::uint32_t Step();
+
+		bool IsSettled() const {
+			return !extrasMoving && applied[kDOFStrength] == target[kDOFStrength] && applied[kDOFRange] == target[kDOFRange];
+		}
+	};
+}
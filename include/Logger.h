@@ -1,27 +1,126 @@
-#pragma once
-
-#include <spdlog/sinks/basic_file_sink.h>
-
-static void SetupLog() {
-    auto logsFolder    = SKSE::log::log_directory();
-
-    if (!logsFolder) {
-        SKSE::stl::report_and_fail("SKSE log directory not provided, logs disabled.");
-    }
-
-    auto pluginName    = SKSE::PluginDeclaration::GetSingleton()->GetName();
-    auto logFilePath   = *logsFolder / std::format("{}.log", pluginName);
-    auto fileLoggerPtr = std::make_shared<spdlog::sinks::basic_file_sink_mt>(logFilePath.string(), true);
-    auto loggerPtr     = std::make_shared<spdlog::logger>("log", std::move(fileLoggerPtr));
-
-    spdlog::set_default_logger(std::move(loggerPtr));
-
-#ifndef NDEBUG
-    spdlog::set_level(spdlog::level::trace);
-    spdlog::flush_on(spdlog::level::trace);
-#else
-    spdlog::set_level(spdlog::level::info);
-    spdlog::flush_on(spdlog::level::info);
-#endif
-    Logger::info("Loading {} Version {}.", pluginName, SKSE::PluginDeclaration::GetSingleton()->GetVersion());
-}
\ No newline at end of file
+#pragma once
+
+#include <spdlog/async.h>
+#include <spdlog/sinks/basic_file_sink.h>
+
+#include "Memory.h"
+
+// ------------------------------
+// Per-subsystem log levels
+// ------------------------------
+// The levels gate LOG_DEBUG and LOG_TRACE only. Logger::info, warn and error are not tied to a subsystem
+// and always reach the log, so a subsystem set to warn or above is silenced below info, not below warn.
+namespace Log {
+    enum Subsystem : std::uint8_t {
+        kUI,
+        kHooks,
+        kSettings,
+        kCache,
+        kSubsystemCount
+    };
+
+    inline constexpr const char* subsystemNames[kSubsystemCount] = { "UI", "Hooks", "Settings", "Cache" };
+
+    inline constexpr std::size_t queueSize = 8192;  // Messages the async logger buffers
+
+    inline std::array<std::atomic<int>, kSubsystemCount> levels{ spdlog::level::info, spdlog::level::info, spdlog::level::info, spdlog::level::info };
+
+    inline bool ShouldLog(Subsystem a_subsystem, spdlog::level::level_enum a_level) {
+        return a_level >= levels[a_subsystem].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Sets a subsystem level and lowers the logger's own level just enough to let it through.
+     */
+    inline void SetLevel(Subsystem a_subsystem, int a_level) {
+        levels[a_subsystem].store(std::clamp<int>(a_level, spdlog::level::trace, spdlog::level::off), std::memory_order_relaxed);
+
+        int lowest = spdlog::level::info;
+        for (const auto& level : levels) {
+            lowest = std::min(lowest, level.load(std::memory_order_relaxed));
+        }
+        spdlog::set_level(static_cast<spdlog::level::level_enum>(lowest));
+    }
+}
+
+// Trace calls are compiled out of release builds entirely, define LOG_TRACE_ENABLED to keep them.
+// Debug calls stay in, but cost a single branch on the subsystem level when disabled.
+#ifndef LOG_TRACE_ENABLED
+    #ifdef NDEBUG
+        #define LOG_TRACE_ENABLED 0
+    #else
+        #define LOG_TRACE_ENABLED 1
+    #endif
+#endif
+
+#define LOG_AT(a_subsystem, a_level, ...)                                                                                     \
+    do {                                                                                                                      \
+        if (Log::ShouldLog(a_subsystem, a_level)) {                                                                           \
+            spdlog::default_logger_raw()->log(spdlog::source_loc{ __FILE__, __LINE__, SPDLOG_FUNCTION }, a_level, __VA_ARGS__); \
+        }                                                                                                                     \
+    } while (false)
+
+#if LOG_TRACE_ENABLED
+    #define LOG_TRACE(a_subsystem, ...) LOG_AT(a_subsystem, spdlog::level::trace, __VA_ARGS__)
+#else
+    #define LOG_TRACE(a_subsystem, ...) ((void)0)
+#endif
+
+#define LOG_DEBUG(a_subsystem, ...) LOG_AT(a_subsystem, spdlog::level::debug, __VA_ARGS__)
+
+/**
+ * @brief Drains the async queue into the file, stops the periodic flush and joins both threads, so neither
+ *        outlives the DLL. Anything logged afterwards is dropped.
+ *
+ * At process exit Windows has already ended the logging thread by the time this runs, so whatever is still
+ * queued is lost. A full queue then keeps its pool alive for good, the terminate message the pool posts when
+ * it is destroyed would otherwise wait forever for room that a dead thread never makes.
+ */
+inline void ShutdownLog() {
+    const auto pool = spdlog::thread_pool();
+    if (pool && pool->queue_size() >= Log::queueSize) {
+        [[maybe_unused]] static const auto leaked = new std::shared_ptr(pool);
+        return;
+    }
+
+    spdlog::default_logger_raw()->flush();
+    spdlog::shutdown();
+}
+
+inline void SetupLog() {
+    auto logsFolder    = SKSE::log::log_directory();
+
+    if (!logsFolder) {
+        SKSE::stl::report_and_fail("SKSE log directory not provided, logs disabled.");
+    }
+
+    auto pluginName    = SKSE::PluginDeclaration::GetSingleton()->GetName();
+    auto logFilePath   = *logsFolder / std::format("{}.log", pluginName);
+    auto fileLoggerPtr = std::make_shared<spdlog::sinks::basic_file_sink_mt>(logFilePath.string(), true);
+
+    // Bounded ring buffer drained by one background thread. When it fills up the oldest
+    // messages are dropped, so logging can never stall the game or render thread.
+    spdlog::init_thread_pool(Log::queueSize, 1);
+    Memory::Measured(Memory::kLogging, (Log::queueSize + 1) * sizeof(spdlog::details::async_msg), 1);  // The queue is the bulk of it, the file sink writes through stdio
+    auto loggerPtr     = std::make_shared<spdlog::async_logger>("log", std::move(fileLoggerPtr), spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
+
+    spdlog::set_default_logger(std::move(loggerPtr));
+
+#ifndef NDEBUG
+    for (std::uint8_t i = 0; i < Log::kSubsystemCount; ++i) {
+        Log::SetLevel(static_cast<Log::Subsystem>(i), spdlog::level::debug);
+    }
+#else
+    spdlog::set_level(spdlog::level::info);
+#endif
+    spdlog::flush_on(spdlog::level::warn);
+    spdlog::flush_every(std::chrono::seconds(1));
+
+    // SKSE never unloads plugins and sends no quit message, so this runs on DLL_PROCESS_DETACH. Constructed
+    // after the spdlog registry, so it is destroyed before it.
+    static struct Shutdown {
+        ~Shutdown() { ShutdownLog(); }
+    } logShutdown;
+
+    Logger::info("Loading {} Version {}.", pluginName, SKSE::PluginDeclaration::GetSingleton()->GetVersion());
+}
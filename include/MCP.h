@@ -1,55 +1,207 @@
-#pragma once
-
-#include "PCH.h"
-
-namespace MCP {
-	using namespace ImGuiMCP;
-
-	void Register();
-	
-	static ImGuiTableFlags       tableFlags      = ImGuiTableFlags_Resizable          | ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_BordersInner | ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersH | ImGuiTableFlags_SizingFixedFit;
-	static ImGuiTableColumnFlags columnFlags     = ImGuiTableColumnFlags_WidthFixed   | ImGuiTableColumnFlags_NoReorder;
-	static ImGuiTableColumnFlags lastColumnFlags = ImGuiTableColumnFlags_WidthStretch | ImGuiTableColumnFlags_NoReorder;
-	static ImGuiInputTextFlags   inputFlags      = ImGuiInputTextFlags_CharsDecimal   | ImGuiInputTextFlags_AutoSelectAll;
-	static ImGuiHoveredFlags     tooltipFlags    = ImGuiHoveredFlags_DelayNormal      | ImGuiHoveredFlags_NoSharedDelay;
-
-	namespace General {
-		void Render();
-	}
-
-	namespace Advanced {
-		struct WeatherSettingRow {
-			bool        rowToggle       = true;
-			std::string rowWeatherType  = "None";
-			float       rowBlurStrength = 1.0f;
-			float       rowBlurRange    = 100.0f;
-			bool        rowStaticToggle = false;
-
-			bool operator==(const WeatherSettingRow& other) const {
-				return rowToggle       == other.rowToggle &&
-					   rowWeatherType  == other.rowWeatherType &&
-					   rowBlurStrength == other.rowBlurStrength &&
-					   rowBlurRange    == other.rowBlurRange &&
-					   rowStaticToggle == other.rowStaticToggle;
-			}
-		};
-
-		struct AdvancedWeatherState {
-			std::vector<WeatherSettingRow> settings;
-			int                            rowToRemove = -1;
-
-			void AddRow() { settings.emplace_back(); }
-			void RemoveRow() {
-				if (rowToRemove != -1) {
-					settings.erase(settings.begin() + rowToRemove);
-					rowToRemove = -1;
-				}
-			}
-		};
-
-		extern AdvancedWeatherState g_advancedWeatherData;
-
-		void Render();
-	}
-
+#pragma once
+
+#include "PCH.h"
+#include "Easing.h"
+#include "ImodChannels.h"
+#include "Memory.h"
+#include "TimeCurve.h"
+
+namespace MCP {
+	using namespace ImGuiMCP;
+
+	void Register();
+	
+	static ImGuiTableFlags       tableFlags      = ImGuiTableFlags_Resizable          | ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_BordersInner | ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersH | ImGuiTableFlags_SizingFixedFit;
+	static ImGuiTableColumnFlags columnFlags     = ImGuiTableColumnFlags_WidthFixed   | ImGuiTableColumnFlags_NoReorder;
+	static ImGuiTableColumnFlags lastColumnFlags = ImGuiTableColumnFlags_WidthStretch | ImGuiTableColumnFlags_NoReorder;
+	static ImGuiInputTextFlags   inputFlags      = ImGuiInputTextFlags_CharsDecimal   | ImGuiInputTextFlags_AutoSelectAll;
+	static ImGuiHoveredFlags     tooltipFlags    = ImGuiHoveredFlags_DelayNormal      | ImGuiHoveredFlags_NoSharedDelay;
+
+	namespace General {
+		void Render();
+	}
+
+	namespace Advanced {
+		struct WeatherSettingRow {
+			bool        rowToggle       = true;
+			std::string rowWeatherType  = "None";
+			float       rowBlurStrength = 1.0f;
+			float       rowBlurRange    = 100.0f;
+			bool        rowStaticToggle = false;
+
+			float         rowDuration = Easing::defaultDuration;  // Seconds to fade to this row, unused when static
+			Easing::Curve rowEasing   = Easing::defaultCurve;
+
+			std::vector<TimeCurve::Keyframe> rowCurve;     // Optional, overrides strength and range by time of day
+			std::vector<Imod::ChannelTarget> rowChannels;  // Optional, other IMOD channels this weather sets
+
+			bool operator==(const WeatherSettingRow& other) const {
+				return rowToggle       == other.rowToggle &&
+					   rowWeatherType  == other.rowWeatherType &&
+					   rowBlurStrength == other.rowBlurStrength &&
+					   rowBlurRange    == other.rowBlurRange &&
+					   rowStaticToggle == other.rowStaticToggle &&
+					   rowDuration     == other.rowDuration &&
+					   rowEasing       == other.rowEasing &&
+					   rowCurve        == other.rowCurve &&
+					   rowChannels     == other.rowChannels;
+			}
+		};
+
+		/**
+		 * @brief A context rule, authored in the JSON. Rules are checked top to bottom before the
+		 *        weather table and the first one that matches decides the blur values.
+		 */
+		struct ContextRuleRow {
+			bool                     ruleToggle       = true;
+			std::string              ruleWeatherType  = "Any";  // Weather editorID, "Any" matches every weather
+			int                      ruleCell         = 0;      // 0 = Any, 1 = Interior, 2 = Exterior
+			std::string              ruleWorldspace   = "Any";  // Worldspace editorID
+			std::vector<std::string> ruleKeywords;              // Location keyword editorIDs, any of them matches
+			int                      ruleHourStart    = 0;      // [start, end) in game hours, wraps past midnight
+			int                      ruleHourEnd      = 0;      // start == end covers the whole day
+			float                    ruleBlurStrength = 1.0f;
+			float                    ruleBlurRange    = 100.0f;
+			bool                     ruleStaticToggle = false;
+
+			bool operator==(const ContextRuleRow&) const = default;
+		};
+
+		/**
+		 * @brief A blur zone, authored in the JSON. Inside a zone the blur is pulled towards its values, on top of
+		 *        the weather table and the context rules. Where zones overlap the first one in the list wins.
+		 */
+		struct BlurZoneRow {
+			bool                 zoneToggle       = true;
+			std::string          zoneWorldspace   = "Tamriel";  // Worldspace editorID
+			int                  zoneShape        = 0;          // 0 = Sphere, 1 = Box
+			std::array<float, 3> zoneCenter       = {};         // Sphere, game units
+			float                zoneRadius       = 0.0f;
+			std::array<float, 3> zoneMin          = {};         // Box corners, game units
+			std::array<float, 3> zoneMax          = {};
+			float                zoneBlurStrength = 1.0f;
+			float                zoneBlurRange    = 100.0f;
+			float                zoneFalloff      = 0.0f;       // Distance inside the edge over which the zone fades in
+
+			bool operator==(const BlurZoneRow&) const = default;
+		};
+
+		struct StringHash {
+			using is_transparent = void;
+			std::size_t operator()(std::string_view a_value) const { return std::hash<std::string_view>{}(a_value); }
+		};
+
+		/**
+		 * @brief The working copy the UI edits. The game thread never reads it, it compiles what
+		 *        Hooks::BlurManager::PublishSettings() resolves from it instead.
+		 */
+		struct AdvancedWeatherState {
+			std::mutex                     lock;  // Held by the UI while it renders and by the reload watcher while it applies an edit
+			std::vector<WeatherSettingRow> settings;
+			std::vector<ContextRuleRow>    rules;
+			std::vector<BlurZoneRow>       zones;
+			int                            rowToRemove = -1;
+
+			// How many rows reference each weather, "None" is never counted. Kept in step with
+			// every edit so the picker can answer "is this taken?" in O(1) instead of scanning rows.
+			std::unordered_map<std::string, int, StringHash, std::equal_to<>> usedWeathers;
+			std::uint64_t                                                     usedVersion = 0;
+
+			void AddRow() { settings.emplace_back(); }
+			void RemoveRow() {
+				if (rowToRemove != -1) {
+					ReleaseWeather(settings[rowToRemove].rowWeatherType);
+					settings.erase(settings.begin() + rowToRemove);
+					rowToRemove = -1;
+				}
+			}
+
+			bool IsWeatherUsed(std::string_view a_weather) const { return usedWeathers.find(a_weather) != usedWeathers.end(); }
+
+			void TrackWeatherChange(std::string_view a_old, std::string_view a_new) {
+				if (a_old == a_new) return;
+				ReleaseWeather(a_old);
+				AcquireWeather(a_new);
+			}
+
+			void RebuildUsedWeathers() {
+				usedWeathers.clear();
+				for (const auto& row : settings) {
+					AcquireWeather(row.rowWeatherType);
+				}
+				++usedVersion;
+			}
+
+			/**
+			 * @brief Books the heap held by the rows, rules, zones and usage map under Memory::kWeatherData. Call with lock held.
+			 *        Map nodes are estimated, everything else is read from the containers' capacities.
+			 */
+			void MeasureMemory() const {
+				std::size_t bytes  = 0;
+				std::size_t blocks = 0;
+
+				const auto add = [&](std::size_t a_bytes) {
+					if (!a_bytes) return;
+					bytes += a_bytes;
+					++blocks;
+				};
+				const auto addString = [&](const std::string& a_string) {
+					if (a_string.capacity() > std::string().capacity()) add(a_string.capacity() + 1);  // Past the small string buffer
+				};
+
+				add(settings.capacity() * sizeof(WeatherSettingRow));
+				for (const auto& row : settings) {
+					addString(row.rowWeatherType);
+					add(row.rowCurve.capacity() * sizeof(TimeCurve::Keyframe));
+					add(row.rowChannels.capacity() * sizeof(Imod::ChannelTarget));
+				}
+
+				add(rules.capacity() * sizeof(ContextRuleRow));
+				for (const auto& rule : rules) {
+					addString(rule.ruleWeatherType);
+					addString(rule.ruleWorldspace);
+					add(rule.ruleKeywords.capacity() * sizeof(std::string));
+					for (const auto& keyword : rule.ruleKeywords) addString(keyword);
+				}
+
+				add(zones.capacity() * sizeof(BlurZoneRow));
+				for (const auto& zone : zones) addString(zone.zoneWorldspace);
+
+				add(usedWeathers.bucket_count() * sizeof(void*));
+				for (const auto& [weather, count] : usedWeathers) {
+					add(sizeof(std::pair<const std::string, int>) + 2 * sizeof(void*));
+					addString(weather);
+				}
+
+				Memory::Measured(Memory::kWeatherData, bytes, blocks);
+			}
+
+		private:
+			void AcquireWeather(std::string_view a_weather) {
+				if (a_weather == "None") return;
+				if (auto it = usedWeathers.find(a_weather); it != usedWeathers.end()) {
+					++it->second;
+				} else {
+					usedWeathers.emplace(a_weather, 1);
+				}
+				++usedVersion;
+			}
+
+			void ReleaseWeather(std::string_view a_weather) {
+				if (auto it = usedWeathers.find(a_weather); it != usedWeathers.end()) {
+					if (--it->second <= 0) usedWeathers.erase(it);
+					++usedVersion;
+				}
+			}
+		};
+
+		extern AdvancedWeatherState g_advancedWeatherData;
+
+		void Render();
+	}
+
+	namespace Diagnostics {
+		void Render();
+	}
+
 }
\ No newline at end of file
@@ -1,6 +1,6 @@
-#pragma once
-
-namespace Manager {
-	void Initialize();
-	void InitializeFormCaches();
+#pragma once
+
+namespace Manager {
+	void Initialize();
+	void InitializeFormCaches();
 }
\ No newline at end of file
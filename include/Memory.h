@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Memory accounting per subsystem. Containers that hold long-lived plugin state allocate through
+// Memory::Allocator, rapidjson documents through Memory::JsonAllocator, and state that lives in
+// library-owned buffers is measured or reserved explicitly. Counters are relaxed atomics, so any
+// thread can allocate while the Diagnostics page reads them.
+namespace Memory {
+
+	enum Subsystem : std::uint8_t {
+		kFormCache,    // g_formCache entries and editorID arenas
+		kWeatherData,  // g_advancedWeatherData rows, rules and zones, measured
+		kJson,         // rapidjson documents and write buffers
+		kLogging,      // spdlog's message queue and sinks, reserved
+		kSubsystemCount
+	};
+
+	inline constexpr const char* subsystemNames[kSubsystemCount] = { "Form cache", "Weather data", "JSON", "Logging" };
+
+	struct Usage {
+		std::int64_t  bytes            = 0;  // Held right now
+		std::int64_t  allocations      = 0;  // Live blocks
+		std::uint64_t totalAllocations = 0;  // Since startup
+		std::int64_t  peakBytes        = 0;
+	};
+
+	namespace detail {
+		struct Counters {
+			std::atomic<std::int64_t>  bytes{ 0 };
+			std::atomic<std::int64_t>  allocations{ 0 };
+			std::atomic<std::uint64_t> totalAllocations{ 0 };
+			std::atomic<std::int64_t>  peakBytes{ 0 };
+
+			void RaisePeak(std::int64_t a_bytes) {
+				auto peak = peakBytes.load(std::memory_order_relaxed);
+				while (a_bytes > peak && !peakBytes.compare_exchange_weak(peak, a_bytes, std::memory_order_relaxed)) {}
+			}
+		};
+
+		inline std::array<Counters, kSubsystemCount> counters;
+	}
+
+	inline void Allocated(Subsystem a_subsystem, std::size_t a_bytes) {
+		auto& counters = detail::counters[a_subsystem];
+		counters.allocations.fetch_add(1, std::memory_order_relaxed);
+		counters.totalAllocations.fetch_add(1, std::memory_order_relaxed);
+		counters.RaisePeak(counters.bytes.fetch_add(static_cast<std::int64_t>(a_bytes), std::memory_order_relaxed) + static_cast<std::int64_t>(a_bytes));
+	}
+
+	inline void Freed(Subsystem a_subsystem, std::size_t a_bytes) {
+		auto& counters = detail::counters[a_subsystem];
+		counters.allocations.fetch_sub(1, std::memory_order_relaxed);
+		counters.bytes.fetch_sub(static_cast<std::int64_t>(a_bytes), std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Replaces the current figures of a subsystem that is measured rather than allocated through here.
+	 */
+	inline void Measured(Subsystem a_subsystem, std::size_t a_bytes, std::size_t a_allocations) {
+		auto& counters = detail::counters[a_subsystem];
+		counters.bytes.store(static_cast<std::int64_t>(a_bytes), std::memory_order_relaxed);
+		counters.allocations.store(static_cast<std::int64_t>(a_allocations), std::memory_order_relaxed);
+		counters.RaisePeak(static_cast<std::int64_t>(a_bytes));
+	}
+
+	// Plugin only, in src/Memory.cpp
+	void Refresh();                          // Re-measures kWeatherData, takes g_advancedWeatherData.lock
+	void DumpToLog(std::string_view a_when);  // One line per subsystem and a total, after Refresh()
+
+	inline Usage Read(Subsystem a_subsystem) {
+		const auto& counters = detail::counters[a_subsystem];
+		return { counters.bytes.load(std::memory_order_relaxed), counters.allocations.load(std::memory_order_relaxed),
+			counters.totalAllocations.load(std::memory_order_relaxed), counters.peakBytes.load(std::memory_order_relaxed) };
+	}
+
+	/**
+	 * @brief std allocator that books every block against a subsystem.
+	 */
+	template <typename T, Subsystem S>
+	struct Allocator {
+		using value_type = T;
+
+		template <typename U>
+		struct rebind {
+			using other = Allocator<U, S>;
+		};
+
+		Allocator() noexcept = default;
+		template <typename U>
+		Allocator(const Allocator<U, S>&) noexcept {}
+
+		T* allocate(std::size_t a_count) {
+			const auto bytes = a_count * sizeof(T);
+			const auto block = static_cast<T*>(::operator new(bytes));
+			Allocated(S, bytes);
+			return block;
+		}
+
+		void deallocate(T* a_block, std::size_t a_count) noexcept {
+			::operator delete(a_block);
+			Freed(S, a_count * sizeof(T));
+		}
+
+		template <typename U>
+		bool operator==(const Allocator<U, S>&) const noexcept { return true; }
+	};
+
+	template <typename T, Subsystem S>
+	using Vector = std::vector<T, Allocator<T, S>>;
+
+	template <Subsystem S>
+	using String = std::basic_string<char, std::char_traits<char>, Allocator<char, S>>;
+
+	/**
+	 * @brief rapidjson base allocator booked against kJson. Free() gets no size, so each block carries it in a header.
+	 */
+	class JsonAllocator {
+		public:
+			static const bool kNeedFree = true;
+
+			void* Malloc(std::size_t a_size) {
+				if (!a_size) return nullptr;
+				const auto block = static_cast<std::byte*>(std::malloc(headerSize + a_size));
+				if (!block) return nullptr;
+				std::memcpy(block, &a_size, sizeof(a_size));
+				Allocated(kJson, a_size);
+				return block + headerSize;
+			}
+
+			void* Realloc(void* a_original, std::size_t a_originalSize, std::size_t a_newSize) {
+				(void)a_originalSize;
+				if (!a_newSize) {
+					Free(a_original);
+					return nullptr;
+				}
+				if (!a_original) return Malloc(a_newSize);
+
+				const auto        header = static_cast<std::byte*>(a_original) - headerSize;
+				const std::size_t size   = SizeOf(a_original);
+				const auto        block  = static_cast<std::byte*>(std::realloc(header, headerSize + a_newSize));
+				if (!block) return nullptr;
+				std::memcpy(block, &a_newSize, sizeof(a_newSize));
+				Freed(kJson, size);
+				Allocated(kJson, a_newSize);
+				return block + headerSize;
+			}
+
+			static void Free(void* a_block) {
+				if (!a_block) return;
+				Freed(kJson, SizeOf(a_block));
+				std::free(static_cast<std::byte*>(a_block) - headerSize);
+			}
+
+			bool operator==(const JsonAllocator&) const { return true; }
+			bool operator!=(const JsonAllocator&) const { return false; }
+
+		private:
+			static constexpr std::size_t headerSize = alignof(std::max_align_t);
+
+			static std::size_t SizeOf(void* a_block) {
+				std::size_t size = 0;
+				std::memcpy(&size, static_cast<std::byte*>(a_block) - headerSize, sizeof(size));
+				return size;
+			}
+	};
+}
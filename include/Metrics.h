@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Always-on counters for the update hook. Writers are the game and settings threads,
+// readers are the Diagnostics page, so everything is a relaxed atomic.
+namespace Metrics {
+
+	enum class Counter : std::uint32_t {
+		kWeatherChanges,
+		kTriggers,
+		kRetriggers,
+		kStops,
+		kParks,
+		kUnparks,
+		kDOFWrites,
+		kChannelWrites,
+		kSettingsSaves,
+		kCount
+	};
+
+	inline constexpr const char* counterNames[static_cast<std::size_t>(Counter::kCount)] = {
+		"Weather Changes",
+		"IMOD Triggers",
+		"IMOD Re-Triggers",
+		"IMOD Stops",
+		"IMOD Parks",
+		"IMOD Unparks",
+		"DOF Writes",
+		"Channel Writes",
+		"Settings Saves"
+	};
+
+	/**
+	 * @brief Log-linear latency histogram: every power of two is split into 4 linear sub-buckets,
+	 *        which keeps percentile estimates within ~25% while recording stays a handful of instructions.
+	 */
+	class LatencyHistogram {
+		public:
+			static constexpr std::size_t subBucketBits = 2;
+			static constexpr std::size_t bucketCount   = 40 << subBucketBits;
+
+			void Record(std::uint64_t a_nanoseconds);
+			void Reset();
+
+			std::uint64_t Count() const { return _count.load(std::memory_order_relaxed); }
+			std::uint64_t Max() const { return _max.load(std::memory_order_relaxed); }
+			std::uint64_t Total() const { return _total.load(std::memory_order_relaxed); }
+
+			/**
+			 * @brief Returns the upper bound of the bucket holding the given percentile, in nanoseconds.
+			 * @param a_percentile A value in [0, 1].
+			 */
+			std::uint64_t Percentile(double a_percentile) const;
+
+		private:
+			static std::size_t   BucketFor(std::uint64_t a_nanoseconds);
+			static std::uint64_t UpperBound(std::size_t a_bucket);
+
+			std::array<std::atomic<std::uint64_t>, bucketCount> _buckets{};
+			std::atomic<std::uint64_t>                          _count{ 0 };
+			std::atomic<std::uint64_t>                          _total{ 0 };
+			std::atomic<std::uint64_t>                          _max{ 0 };
+	};
+
+	void Increment(Counter a_counter, std::uint64_t a_amount = 1);
+	std::uint64_t Get(Counter a_counter);
+
+	LatencyHistogram& UpdateLatency();
+
+	void Reset();
+	void DumpToLog();
+
+	/**
+	 * @brief Records the lifetime of the scope into the update latency histogram.
+	 */
+	class ScopedUpdateTimer {
+		public:
+			ScopedUpdateTimer() : _start(std::chrono::steady_clock::now()) {}
+			~ScopedUpdateTimer() {
+				const auto elapsed = std::chrono::steady_clock::now() - _start;
+				UpdateLatency().Record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+			}
+
+			ScopedUpdateTimer(const ScopedUpdateTimer&)            = delete;
+			ScopedUpdateTimer& operator=(const ScopedUpdateTimer&) = delete;
+
+		private:
+			std::chrono::steady_clock::time_point _start;
+	};
+}
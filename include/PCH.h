@@ -1,29 +1,32 @@
-#pragma once
-
-// External Library Headers
-#include "RE/Skyrim.h"
-#include "SKSE/SKSE.h"
-#include <wrl/client.h>
-#include <CLIBUtil/utils.hpp>
-#include "SKSEMCP/SKSEMenuFramework.hpp"
-
-
-// Standard Library Headers
-#include <cstdint>
-#include <map>
-#include <string>
-#include <vector>
-#include <typeindex>
-#include <functional>
-
-
-namespace Plugin {
-	inline std::string modName            = std::string(SKSE::PluginDeclaration::GetSingleton()->GetName());
-	inline std::string settingsPathString = "Data/SKSE/Plugins/" + modName + ".ini";
-	inline const char* settingsPath       = nullptr; // Initialized in Manager.cpp
-}
-
-namespace Logger = SKSE::log;
-
-using namespace std::literals;
+#pragma once
+
+// External Library Headers
+#include "RE/Skyrim.h"
+#include "SKSE/SKSE.h"
+#include <wrl/client.h>
+#include <CLIBUtil/utils.hpp>
+#include "SKSEMCP/SKSEMenuFramework.hpp"
+
+
+// Standard Library Headers
+#include <cstdint>
+#include <execution>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+namespace Plugin {
+	inline std::string modName            = std::string(SKSE::PluginDeclaration::GetSingleton()->GetName());
+	inline std::string settingsPathString = "Data/SKSE/Plugins/" + modName + ".ini";
+	inline const char* settingsPath       = nullptr; // Initialized in Manager.cpp
+}
+
+namespace Logger = SKSE::log;
+
+using namespace std::literals;
 using namespace Plugin;
\ No newline at end of file
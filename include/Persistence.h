@@ -0,0 +1,118 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+// Debounced background writes, game-agnostic so tools/blur-sim can check the coalescing and ordering.
+namespace Persistence {
+
+	/**
+	 * @brief Coalesces write requests and hands the latest one to a writer on a background thread.
+	 *
+	 * Every request replaces the pending value and pushes the deadline back by the debounce window,
+	 * so a burst of edits (dragging a value, spamming +/-) results in a single write. Writes never
+	 * overlap and land in the order their values were requested: whoever takes the pending value,
+	 * the worker or Flush(), takes the write lock before letting go of the pending lock.
+	 *
+	 * @tparam T The value written, moved in by Request() and only ever read by the writer.
+	 */
+	template <typename T>
+	class Debouncer {
+		public:
+			using Writer = std::function<void(const T&)>;
+
+			Debouncer(std::chrono::steady_clock::duration a_debounce, Writer a_writer) : _debounce(a_debounce), _writer(std::move(a_writer)) {}
+
+			Debouncer(const Debouncer&)            = delete;
+			Debouncer(Debouncer&&)                 = delete;
+			Debouncer& operator=(const Debouncer&) = delete;
+			Debouncer& operator=(Debouncer&&)      = delete;
+
+			~Debouncer() {
+				if (_thread.joinable()) {
+					_thread.request_stop();
+					_condition.notify_one();
+					_thread.join();
+				}
+				Flush();  // The worker may have been torn down before its deadline on process exit
+			}
+
+			void Request(T&& a_value) {
+				{
+					std::scoped_lock lock(_lock);
+					_pending  = std::move(a_value);
+					_deadline = std::chrono::steady_clock::now() + _debounce;
+
+					if (!_thread.joinable()) {
+						_thread = std::jthread([this](std::stop_token a_token) { Run(a_token); });
+					}
+				}
+				_condition.notify_one();
+			}
+
+			/**
+			 * @brief Writes the pending value on the calling thread, after a write already in flight has landed.
+			 */
+			void Flush() {
+				std::unique_lock lock(_lock);
+				std::unique_lock write(_writeLock);
+				if (!_pending) return;
+
+				auto value = std::move(*_pending);
+				_pending.reset();
+				lock.unlock();
+
+				_writer(value);
+			}
+
+			/**
+			 * @brief Drops the pending value without writing it. A write already in flight still lands.
+			 * @return true if a value was pending.
+			 */
+			bool Discard() {
+				std::scoped_lock lock(_lock);
+				return std::exchange(_pending, std::nullopt).has_value();
+			}
+
+		private:
+			void Run(std::stop_token a_token) {
+				std::unique_lock lock(_lock);
+				while (!a_token.stop_requested()) {
+					_condition.wait(lock, a_token, [this] { return _pending.has_value(); });
+
+					// Keep sleeping while new edits keep pushing the deadline back
+					while (!a_token.stop_requested() && std::chrono::steady_clock::now() < _deadline) {
+						const auto deadline = _deadline;
+						_condition.wait_until(lock, a_token, deadline, [&] { return _deadline != deadline; });
+					}
+
+					if (!_pending || a_token.stop_requested()) continue;
+
+					std::unique_lock write(_writeLock);
+					auto             value = std::move(*_pending);
+					_pending.reset();
+
+					lock.unlock();
+					_writer(value);
+					write.unlock();
+					lock.lock();
+				}
+			}
+
+			const std::chrono::steady_clock::duration _debounce;
+			const Writer                              _writer;
+
+			std::mutex                                _lock;       // _pending and _deadline, always taken before _writeLock
+			std::mutex                                _writeLock;  // Held for a whole write
+			std::condition_variable_any               _condition;
+			std::optional<T>                          _pending;
+			std::chrono::steady_clock::time_point     _deadline;
+			std::jthread                              _thread;
+	};
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "BlurController.h"
+#include "BlurZones.h"
+#include "ContextRules.h"
+
+// Settings cross from the threads that edit them (the UI, the reload watcher) to the game thread
+// as immutable snapshots. Writers build a complete value and swap it in, readers only ever see a
+// whole one, and an old value is freed once no reader can still be looking at it.
+namespace Published {
+
+	/**
+	 * @brief An atomic pointer with epoch-based reclamation.
+	 *
+	 * Every publish bumps the epoch and retires the previous value tagged with the last epoch it was
+	 * current in. A reader announces the epoch it entered in for as long as it holds a Guard, and a
+	 * retired value is freed once every announced epoch is newer than its tag. Readers never lock
+	 * or wait, writers serialize on a mutex of their own.
+	 *
+	 * @tparam Readers Number of reader threads, each reads through its own index.
+	 */
+	template <typename T, std::size_t Readers>
+	class Slot {
+		private:
+			struct Node {
+				T             value;
+				std::uint64_t epoch = 0;
+			};
+
+			struct alignas(64) Reader {
+				std::atomic<std::uint64_t> epoch{ idle };
+			};
+
+			// Not 0: a reader entering before the first publish announces epoch 0 and must still hold back what it loaded
+			static constexpr std::uint64_t idle = UINT64_MAX;
+
+		public:
+			/**
+			 * @brief Keeps the value it was handed alive. Must not outlive the slot.
+			 */
+			class Guard {
+				public:
+					Guard(Guard&& a_other) noexcept :
+						_reader(std::exchange(a_other._reader, nullptr)), _node(a_other._node) {}
+					Guard(const Guard&)            = delete;
+					Guard& operator=(const Guard&) = delete;
+					Guard& operator=(Guard&&)      = delete;
+
+					~Guard() {
+						if (_reader) _reader->epoch.store(idle, std::memory_order_release);
+					}
+
+					const T*      get() const { return _node ? &_node->value : nullptr; }
+					const T*      operator->() const { return get(); }
+					const T&      operator*() const { return _node->value; }
+					explicit      operator bool() const { return _node != nullptr; }
+					std::uint64_t Epoch() const { return _node ? _node->epoch : 0; }  // The publish that produced this value
+
+				private:
+					friend class Slot;
+
+					Guard(Reader* a_reader, const Node* a_node) :
+						_reader(a_reader), _node(a_node) {}
+
+					Reader*     _reader;
+					const Node* _node;
+			};
+
+			Slot() = default;
+			Slot(const Slot&)            = delete;
+			Slot& operator=(const Slot&) = delete;
+
+			~Slot() {
+				delete _current.load(std::memory_order_relaxed);
+			}
+
+			/**
+			 * @brief Wait-free. Only one Guard per reader index may be alive at a time.
+			 */
+			Guard Read(std::size_t a_reader) {
+				auto& reader = _readers[a_reader];
+
+				// The announcement has to be visible before the pointer is loaded, or a writer could free
+				// the value between the two. Both sides use sequentially consistent operations for that.
+				reader.epoch.store(_epoch.load());
+				return Guard(&reader, _current.load());
+			}
+
+			/**
+			 * @return Epoch of the newest value, 0 before the first publish. A relaxed load, for polling.
+			 */
+			std::uint64_t Epoch() const { return _epoch.load(std::memory_order_relaxed); }
+
+			/**
+			 * @brief Swaps in a new value and frees whatever retired values no reader can see anymore.
+			 * @return The epoch the value was published in.
+			 */
+			std::uint64_t Publish(T&& a_value) {
+				std::scoped_lock lock(_writeLock);
+
+				const auto epoch = _epoch.load() + 1;
+				auto       node  = std::make_unique<Node>(Node{ std::move(a_value), epoch });
+
+				if (const auto previous = _current.exchange(node.release())) {
+					_retired.push_back({ std::unique_ptr<const Node>(previous), epoch - 1 });
+				}
+				_epoch.store(epoch);
+
+				Collect();
+				return epoch;
+			}
+
+			/**
+			 * @return Values replaced but not freed yet because a reader may still hold them.
+			 */
+			std::size_t Retired() const {
+				std::scoped_lock lock(_writeLock);
+				return _retired.size();
+			}
+
+		private:
+			struct Retiree {
+				std::unique_ptr<const Node> node;
+				std::uint64_t               epoch;  // Last epoch in which this was the current value
+			};
+
+			void Collect() {
+				auto oldest = idle;
+				for (const auto& reader : _readers) {
+					oldest = std::min(oldest, reader.epoch.load());
+				}
+				std::erase_if(_retired, [&](const Retiree& a_retiree) { return a_retiree.epoch < oldest; });
+			}
+
+			std::atomic<const Node*>        _current{ nullptr };
+			std::atomic<std::uint64_t>      _epoch{ 0 };
+			std::array<Reader, Readers>     _readers{};
+			mutable std::mutex              _writeLock;
+			std::vector<Retiree>            _retired;
+	};
+
+	/**
+	 * @brief The weather table, context rules and blur zones with every name resolved to a FormID, ready to compile.
+	 *        Built by whichever thread edited the settings and never modified once published.
+	 */
+	struct Tables {
+		std::vector<TimeCurve::Keyframe> keyframes;  // Backing storage for the rows' curve spans
+		std::vector<Imod::ChannelTarget> channels;   // Backing storage for the rows' channel spans
+		std::vector<Blur::RowInput>      rows;
+		std::vector<Rules::RuleInput>    rules;
+		std::vector<Zones::ZoneInput>    zones;
+		std::size_t                      authoredRows  = 0;  // Before unresolved weathers were dropped
+		std::size_t                      authoredRules = 0;
+		std::size_t                      authoredZones = 0;
+
+		// What changed since the previous epoch. A reader that skipped an epoch has to treat everything as changed.
+		bool                       rowsChanged  = true;   // false when only changedWeathers differ
+		std::vector<std::uint32_t> changedWeathers;
+		bool                       rulesChanged = true;
+		bool                       zonesChanged = true;
+	};
+}
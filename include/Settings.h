@@ -1,45 +1,118 @@
-#pragma once
-
-#include "MCP.h"
-
-namespace Settings {
-
-    // ------------------------------
-    // Main
-    // ------------------------------
-    void LoadAll();      // Loads INI and JSON
-    void SaveAll();      // Saves INI and JSON
-    void ResetAll();     // Resets to defaults and saves
-
-    inline std::string weatherListPath = "Data/SKSE/Plugins/DBWeatherList.json";
-
-    // ------------------------------
-    // General (INI)
-    // ------------------------------
-    struct GeneralSettings {
-        int  BlurType       = 1;  // 0=None, 1=Advanced
-		bool ExtraChecks    = true;
-		bool VerboseLogging = false;
-    };
-
-    // Global instances
-    inline GeneralSettings general;
-
-    // ------------------------------
-    // JSON
-    // ------------------------------
-    namespace Json {
-        bool Load();
-        bool Save();
-        void Clear();
-    }
-
-    // ------------------------------
-    // INI handlers
-    // ------------------------------
-    namespace INI {
-        bool Load();
-        bool Save();
-        void Reset();
-    }
-}
+#pragma once
+
+#include "AutoBlur.h"
+#include "MCP.h"
+
+namespace Settings {
+
+    // ------------------------------
+    // Main
+    // ------------------------------
+    void LoadAll();      // Loads INI and JSON
+    void SaveAll();      // Saves INI and JSON
+    void ResetAll();     // Resets to defaults and saves
+
+    // ------------------------------
+    // Persistence
+    // ------------------------------
+    void RequestSave();  // Snapshots current settings and queues a debounced background save
+    void FlushSave();    // Writes any queued snapshot immediately on the calling thread
+
+    constexpr auto saveDebounce = std::chrono::milliseconds(750);
+
+    // ------------------------------
+    // Hot reload
+    // ------------------------------
+    /**
+     * @brief What an external edit changed, relative to the rows that were live before it.
+     */
+    struct RowDiff {
+        std::size_t              changedRows = 0;   // Rows added, removed or edited in place
+        std::vector<std::string> changedWeathers;   // Weathers whose effective (first enabled) row changed
+        bool                     rulesChanged = false;
+        bool                     zonesChanged = false;
+    };
+
+    /**
+     * @brief Called on the watcher thread after an external JSON edit was applied to g_advancedWeatherData, with its lock held.
+     */
+    using RowsReloaded = std::function<void(const RowDiff&)>;
+
+    void StartWatcher(RowsReloaded a_onRows);     // Polls the INI and JSON for external edits on a background thread
+    bool ApplyPendingReload();                    // Game thread: swaps in an INI reload the watcher parsed, if one is waiting
+
+    constexpr auto reloadPollInterval = std::chrono::seconds(1);
+
+    inline std::string weatherListPath     = "Data/SKSE/Plugins/DBWeatherList.json";
+    inline std::string weatherSnapshotPath = "Data/SKSE/Plugins/DBWeatherList.bin";
+    inline std::string frameTracePath      = "Data/SKSE/Plugins/DBFrameTrace.bin";
+    inline std::string crashTracePath      = "Data/SKSE/Plugins/DBFrameTrace-Crash.bin";
+
+    // ------------------------------
+    // General (INI)
+    // ------------------------------
+    struct GeneralSettings {
+        int  BlurType       = 1;  // 0=None, 1=Advanced, 2=Automatic
+		bool ExtraChecks    = false;  // Background form validation after load
+		bool VerboseLogging = false;
+		bool FrameRecorder  = false;
+		bool Telemetry      = false;  // Shared memory block for external overlays, see Telemetry.h
+
+        AutoBlur::Tuning Automatic;  // [Automatic]
+    };
+
+    // ------------------------------
+    // Logging (INI)
+    // ------------------------------
+    struct LoggingSettings {
+#ifndef NDEBUG
+        int UI       = 1;  // spdlog levels: 0=trace, 1=debug, 2=info, 3=warn, 4=error, 5=critical, 6=off
+        int Hooks    = 1;
+        int Settings = 1;
+        int Cache    = 1;
+#else
+        int UI       = 2;
+        int Hooks    = 2;
+        int Settings = 2;
+        int Cache    = 2;
+#endif
+    };
+
+    // Global instances
+    inline GeneralSettings general;
+    inline LoggingSettings logging;
+
+    // ------------------------------
+    // JSON
+    // ------------------------------
+    namespace Json {
+        bool        Load();
+        bool        Save();
+        void        Clear();
+        bool        Parse(std::string_view a_content, std::vector<MCP::Advanced::WeatherSettingRow>& a_rows, std::vector<MCP::Advanced::ContextRuleRow>& a_rules,
+                        std::vector<MCP::Advanced::BlurZoneRow>& a_zones);
+        std::string Serialize(const std::vector<MCP::Advanced::WeatherSettingRow>& a_rows, const std::vector<MCP::Advanced::ContextRuleRow>& a_rules,
+                        const std::vector<MCP::Advanced::BlurZoneRow>& a_zones);
+    }
+
+    // ------------------------------
+    // Binary snapshot of the JSON
+    // ------------------------------
+    namespace Binary {
+        bool Load();  // Appends the snapshot rows if it still matches the JSON on disk
+        void Save(const std::vector<MCP::Advanced::WeatherSettingRow>& a_rows, const std::vector<MCP::Advanced::ContextRuleRow>& a_rules,
+                  const std::vector<MCP::Advanced::BlurZoneRow>& a_zones, std::string_view a_json);
+    }
+
+    // ------------------------------
+    // INI handlers
+    // ------------------------------
+    namespace INI {
+        bool        Load();
+        bool        Save();
+        void        Reset();
+        bool        Parse(std::string_view a_content, GeneralSettings& a_general, LoggingSettings& a_logging);
+        std::string Serialize(const GeneralSettings& a_general, const LoggingSettings& a_logging);
+        void        ApplyLogLevels();
+    }
+}
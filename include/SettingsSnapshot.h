@@ -0,0 +1,209 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Easing.h"
+#include "ImodChannels.h"
+#include "TimeCurve.h"
+
+// Binary mirror of DBWeatherList.json. The JSON stays the human-editable source of truth, this file only
+// exists so startup can skip building a DOM while the JSON is byte-for-byte what the snapshot was made from.
+// Game-agnostic on purpose so the encoder and decoder can be benchmarked headless (see tools/).
+namespace SettingsSnapshot {
+
+	inline constexpr std::array<char, 4> fileMagic   = { 'D', 'B', 'W', 'S' };
+	inline constexpr std::uint32_t       fileVersion = 5;  // 2: time-of-day keyframes, 3: IMOD channels, 4: transitions, 5: HashContent
+
+	/**
+	 * @brief Identity of the JSON file a snapshot was built from.
+	 */
+	struct Source {
+		std::uint64_t hash  = 0;  // HashContent of the file
+		std::int64_t  mtime = 0;  // Raw last_write_time ticks
+		std::uint64_t size  = 0;
+
+		bool operator==(const Source&) const = default;
+	};
+
+	/**
+	 * @brief 64-bit hash of the JSON a snapshot mirrors, run over the whole file on every load.
+	 *        Eight bytes per multiply rather than FNV-1a's one, so it stays well under the cost of decoding.
+	 */
+	inline std::uint64_t HashContent(std::string_view a_bytes) {
+		std::uint64_t hash = 0xCBF29CE484222325ull ^ a_bytes.size();
+		std::size_t   i    = 0;
+
+		for (; i + sizeof(std::uint64_t) <= a_bytes.size(); i += sizeof(std::uint64_t)) {
+			std::uint64_t word;
+			std::memcpy(&word, a_bytes.data() + i, sizeof(word));
+			hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+			hash ^= hash >> 32;
+		}
+		for (; i < a_bytes.size(); i++) {
+			hash = (hash ^ static_cast<std::uint8_t>(a_bytes[i])) * 0x100000001B3ull;
+		}
+
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		return hash ^ (hash >> 33);
+	}
+
+	struct FileHeader {
+		std::array<char, 4> magic;
+		std::uint32_t       version;
+		Source              source;
+		std::uint32_t       rowCount;
+		std::uint32_t       arenaSize;
+		std::uint32_t       keyframeCount;
+		std::uint32_t       channelCount;
+	};
+
+	enum RecordFlags : std::uint32_t {
+		kToggle = 1 << 0,
+		kStatic = 1 << 1
+	};
+
+	struct Record {
+		std::uint32_t nameOffset;
+		std::uint32_t nameLength;
+		float         strength;
+		float         range;
+		std::uint32_t flags;
+		float         duration;
+		std::uint32_t easing;
+		std::uint32_t curveOffset;  // Into the keyframe section
+		std::uint32_t curveCount;
+		std::uint32_t channelOffset;  // Into the channel section
+		std::uint32_t channelCount;
+	};
+
+	// Layout: header, records, keyframes, channels, name arena.
+	static_assert(sizeof(FileHeader) == 48);
+	static_assert(sizeof(Record) == 44);
+	static_assert(sizeof(TimeCurve::Keyframe) == 12);
+	static_assert(sizeof(Imod::ChannelTarget) == 8);
+
+	/**
+	 * @brief Serializes the rows, in order, into a snapshot tagged with the JSON they mirror.
+	 * @tparam Row Anything shaped like MCP::Advanced::WeatherSettingRow.
+	 */
+	template <typename Row>
+	std::string Encode(std::span<const Row> a_rows, const Source& a_source) {
+		std::vector<Record>              records;
+		std::vector<TimeCurve::Keyframe> keyframes;
+		std::vector<Imod::ChannelTarget> channels;
+		std::string                      arena;
+		records.reserve(a_rows.size());
+
+		for (const auto& row : a_rows) {
+			records.push_back({ static_cast<std::uint32_t>(arena.size()),
+				static_cast<std::uint32_t>(row.rowWeatherType.size()),
+				row.rowBlurStrength,
+				row.rowBlurRange,
+				(row.rowToggle ? kToggle : 0u) | (row.rowStaticToggle ? kStatic : 0u),
+				row.rowDuration,
+				row.rowEasing,
+				static_cast<std::uint32_t>(keyframes.size()),
+				static_cast<std::uint32_t>(row.rowCurve.size()),
+				static_cast<std::uint32_t>(channels.size()),
+				static_cast<std::uint32_t>(row.rowChannels.size()) });
+			arena.append(row.rowWeatherType);
+			keyframes.insert(keyframes.end(), row.rowCurve.begin(), row.rowCurve.end());
+			channels.insert(channels.end(), row.rowChannels.begin(), row.rowChannels.end());
+		}
+
+		const FileHeader header{ fileMagic, fileVersion, a_source, static_cast<std::uint32_t>(records.size()), static_cast<std::uint32_t>(arena.size()),
+			static_cast<std::uint32_t>(keyframes.size()), static_cast<std::uint32_t>(channels.size()) };
+
+		std::string buffer;
+		buffer.reserve(sizeof(header) + records.size() * sizeof(Record) + keyframes.size() * sizeof(TimeCurve::Keyframe) +
+		               channels.size() * sizeof(Imod::ChannelTarget) + arena.size());
+		buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+		buffer.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+		buffer.append(reinterpret_cast<const char*>(keyframes.data()), keyframes.size() * sizeof(TimeCurve::Keyframe));
+		buffer.append(reinterpret_cast<const char*>(channels.data()), channels.size() * sizeof(Imod::ChannelTarget));
+		buffer.append(arena);
+		return buffer;
+	}
+
+	/**
+	 * @brief Reads the header only, so a stale snapshot can be rejected before any row is touched.
+	 * @return The source the snapshot was built from, or nothing if the data is not a usable snapshot.
+	 */
+	inline std::optional<Source> ReadSource(std::span<const std::byte> a_data) {
+		FileHeader header{};
+		if (a_data.size() < sizeof(header)) return std::nullopt;
+		std::memcpy(&header, a_data.data(), sizeof(header));
+
+		if (header.magic != fileMagic || header.version != fileVersion) return std::nullopt;
+
+		const std::size_t expectedSize = sizeof(header) + static_cast<std::size_t>(header.rowCount) * sizeof(Record) +
+		                                 static_cast<std::size_t>(header.keyframeCount) * sizeof(TimeCurve::Keyframe) +
+		                                 static_cast<std::size_t>(header.channelCount) * sizeof(Imod::ChannelTarget) + header.arenaSize;
+		if (a_data.size() != expectedSize) return std::nullopt;
+
+		return header.source;
+	}
+
+	/**
+	 * @brief Appends the snapshot rows to a_out. Fails without touching a_out on any inconsistency.
+	 */
+	template <typename Row>
+	bool Decode(std::span<const std::byte> a_data, std::vector<Row>& a_out) {
+		if (!ReadSource(a_data)) return false;
+
+		FileHeader header{};
+		std::memcpy(&header, a_data.data(), sizeof(header));
+
+		const auto recordBase   = a_data.data() + sizeof(header);
+		const auto keyframeBase = recordBase + static_cast<std::size_t>(header.rowCount) * sizeof(Record);
+		const auto channelBase  = keyframeBase + static_cast<std::size_t>(header.keyframeCount) * sizeof(TimeCurve::Keyframe);
+		const auto arena        = std::string_view(reinterpret_cast<const char*>(channelBase + static_cast<std::size_t>(header.channelCount) * sizeof(Imod::ChannelTarget)), header.arenaSize);
+
+		const auto firstNew = a_out.size();
+		a_out.reserve(firstNew + header.rowCount);
+
+		for (std::uint32_t i = 0; i < header.rowCount; i++) {
+			Record record{};
+			std::memcpy(&record, recordBase + static_cast<std::size_t>(i) * sizeof(Record), sizeof(record));
+
+			if (record.nameOffset > arena.size() || record.nameLength > arena.size() - record.nameOffset ||
+				record.curveOffset > header.keyframeCount || record.curveCount > header.keyframeCount - record.curveOffset ||
+				record.channelOffset > header.channelCount || record.channelCount > header.channelCount - record.channelOffset ||
+				record.easing >= Easing::kCurveCount) {
+				a_out.resize(firstNew);
+				return false;
+			}
+
+			auto& row           = a_out.emplace_back();
+			row.rowToggle       = (record.flags & kToggle) != 0;
+			row.rowWeatherType  = arena.substr(record.nameOffset, record.nameLength);
+			row.rowBlurStrength = record.strength;
+			row.rowBlurRange    = record.range;
+			row.rowStaticToggle = (record.flags & kStatic) != 0;
+			row.rowDuration     = record.duration;
+			row.rowEasing       = static_cast<Easing::Curve>(record.easing);
+
+			row.rowCurve.resize(record.curveCount);
+			if (record.curveCount) {
+				std::memcpy(row.rowCurve.data(), keyframeBase + static_cast<std::size_t>(record.curveOffset) * sizeof(TimeCurve::Keyframe),
+					record.curveCount * sizeof(TimeCurve::Keyframe));
+			}
+
+			row.rowChannels.resize(record.channelCount);
+			if (record.channelCount) {
+				std::memcpy(row.rowChannels.data(), channelBase + static_cast<std::size_t>(record.channelOffset) * sizeof(Imod::ChannelTarget),
+					record.channelCount * sizeof(Imod::ChannelTarget));
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#include "BlurController.h"
+#include "Metrics.h"
+
+// Live blur state in a named shared memory block, for overlays and profilers running next to the game.
+// The game thread is the only writer and publishes after every blur update; readers map the block and
+// copy it out at whatever rate they like, without ever blocking the writer or calling into the plugin.
+//
+// Block layout, layoutVersion 1, little-endian:
+//
+//   offset  size  field
+//        0    64  Header, written once before the first publish
+//       64     8  sequence, odd while an update is being written, +2 per published update
+//      128   120  Snapshot, as 15 64-bit words
+//
+// A reader waits for a non-zero sequence before trusting the header, then copies the snapshot between two
+// reads of the sequence and retries while they differ or are odd (Read() below). Fields are only ever added
+// at the end of Snapshot, growing snapshotSize; anything else bumps layoutVersion.
+namespace Telemetry {
+
+	inline constexpr std::array<char, 4> magic         = { 'D', 'B', 'T', 'L' };
+	inline constexpr std::uint32_t       layoutVersion = 1;
+	inline constexpr char                blockName[]   = "DistantBlurTelemetry";  // "Local\\" + name on Windows, "/" + name for POSIX shm
+	inline constexpr std::size_t         counterCount  = 9;
+
+	// Counters are copied in Metrics::Counter order, a new counter needs a new layout version
+	static_assert(counterCount == static_cast<std::size_t>(Metrics::Counter::kCount));
+
+	struct Header {
+		std::array<char, 4> magic;
+		std::uint32_t       version;       // layoutVersion
+		std::uint32_t       blockSize;     // sizeof(Block)
+		std::uint32_t       snapshotSize;  // sizeof(Snapshot)
+		std::uint32_t       counterCount;
+		std::uint32_t       processID;     // Writer, changes when the game restarts
+		std::uint8_t        reserved[40];
+	};
+
+	static_assert(sizeof(Header) == 64);
+
+	struct Snapshot {
+		std::uint64_t frame;                   // Updates published since the block was opened
+		std::uint64_t counters[counterCount];  // Metrics::Counter, since startup
+		float         appliedStrength;         // What the IMOD shows right now
+		float         appliedRange;            // Controller units, row blurRange * 10
+		float         targetStrength;
+		float         targetRange;
+		std::uint32_t weather;                 // Current weather FormID, 0 for none
+		std::int32_t  rule;                    // Settings index of the matching context rule, -1 for none
+		std::uint32_t zoneSignature;           // Zones::Sample::signature, 0 outside every blur zone
+		std::uint32_t updateNanoseconds;       // Cost of the last Blur::Controller::Update()
+		std::uint16_t events;                  // Blur::UpdateEvent of the last update
+		std::uint8_t  mode;                    // Blur::Mode
+		std::uint8_t  lifecycle;               // Blur::Controller::Lifecycle
+	};
+
+	static_assert(sizeof(Snapshot) == 120 && sizeof(Snapshot) % sizeof(std::uint64_t) == 0);
+
+	inline constexpr std::size_t snapshotWords = sizeof(Snapshot) / sizeof(std::uint64_t);
+
+	// Word-sized atomics, so a reader racing the writer gets a stale or fresh word but never half of one
+	struct Block {
+		Header                                                            header;
+		alignas(64) std::atomic<std::uint64_t>                            sequence{ 0 };
+		alignas(64) std::array<std::atomic<std::uint64_t>, snapshotWords> words{};
+	};
+
+	static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "the block is shared between processes");
+	static_assert(sizeof(Block) == 256);
+
+	/**
+	 * @brief Constructs an empty block in freshly mapped memory.
+	 */
+	inline Block* Create(void* a_memory, std::uint32_t a_processID) {
+		const auto block = new (a_memory) Block{};
+		block->header    = { magic, layoutVersion, sizeof(Block), sizeof(Snapshot), counterCount, a_processID, {} };
+		return block;
+	}
+
+	/**
+	 * @return true if a reader built against this header can read the block. Only valid once Published().
+	 */
+	inline bool Compatible(const Header& a_header) {
+		return a_header.magic == magic && a_header.version == layoutVersion && a_header.blockSize >= sizeof(Block) &&
+		       a_header.snapshotSize >= sizeof(Snapshot) && a_header.counterCount == counterCount;
+	}
+
+	inline bool Published(const Block& a_block) {
+		return a_block.sequence.load(std::memory_order_acquire) != 0;
+	}
+
+	/**
+	 * @brief Single writer only. Wait-free: two stores to the sequence and one per word, no retries.
+	 */
+	inline void Publish(Block& a_block, const Snapshot& a_snapshot) {
+		std::array<std::uint64_t, snapshotWords> words;
+		std::memcpy(words.data(), &a_snapshot, sizeof(Snapshot));
+
+		const auto sequence = a_block.sequence.load(std::memory_order_relaxed);
+		a_block.sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);  // The odd sequence is seen before any new word
+
+		for (std::size_t i = 0; i < snapshotWords; i++) {
+			a_block.words[i].store(words[i], std::memory_order_relaxed);
+		}
+		a_block.sequence.store(sequence + 2, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Copies out a consistent snapshot, retrying while the writer is in the middle of an update.
+	 * @param a_retries Incremented per discarded copy, if given.
+	 * @return false if nothing was published yet, or no attempt got a whole copy.
+	 */
+	inline bool Read(const Block& a_block, Snapshot& a_out, std::uint32_t a_attempts = 64, std::uint64_t* a_retries = nullptr) {
+		for (std::uint32_t attempt = 0; attempt < a_attempts; attempt++) {
+			const auto before = a_block.sequence.load(std::memory_order_acquire);
+			if (!before) return false;
+
+			if (!(before & 1)) {
+				std::array<std::uint64_t, snapshotWords> words;
+				for (std::size_t i = 0; i < snapshotWords; i++) {
+					words[i] = a_block.words[i].load(std::memory_order_relaxed);
+				}
+				std::atomic_thread_fence(std::memory_order_acquire);  // Every word is read before the sequence again
+
+				if (a_block.sequence.load(std::memory_order_relaxed) == before) {
+					std::memcpy(&a_out, words.data(), sizeof(Snapshot));
+					return true;
+				}
+			}
+			if (a_retries) ++*a_retries;
+		}
+		return false;
+	}
+
+	/**
+	 * @brief Fills everything but frame and counters from the controller, right after its Update().
+	 */
+	inline Snapshot Capture(const Blur::Controller& a_controller, std::uint32_t a_events, std::int32_t a_rule, std::uint64_t a_nanoseconds) {
+		const auto checkpoint = a_controller.GetCheckpoint();
+
+		Snapshot snapshot{};
+		snapshot.appliedStrength   = checkpoint.appliedStrength;
+		snapshot.appliedRange      = checkpoint.appliedRange;
+		snapshot.targetStrength    = checkpoint.targetStrength;
+		snapshot.targetRange       = checkpoint.targetRange;
+		snapshot.weather           = a_controller.GetCurrentWeather();
+		snapshot.rule              = a_rule;
+		snapshot.zoneSignature     = a_controller.GetZone().signature;
+		snapshot.updateNanoseconds = static_cast<std::uint32_t>(std::min<std::uint64_t>(a_nanoseconds, UINT32_MAX));
+		snapshot.events            = static_cast<std::uint16_t>(a_events);
+		snapshot.mode              = static_cast<std::uint8_t>(checkpoint.mode);
+		snapshot.lifecycle         = static_cast<std::uint8_t>(checkpoint.lifecycle);
+		return snapshot;
+	}
+
+	// Plugin only, in src/Telemetry.cpp, game thread
+	void   SetEnabled(bool a_enabled);  // Maps the block on the first call with true, it stays mapped until the game exits
+	Block* Get();                       // nullptr while disabled, or when the block could not be created
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Time-of-day curves for a weather row. Keyframes are baked into a fixed-resolution lookup table
+// when the settings are compiled, so sampling on the update path is a single indexed lerp.
+namespace TimeCurve {
+
+	struct Keyframe {
+		float hour     = 0.0f;    // [0, 24)
+		float strength = 1.0f;
+		float range    = 100.0f;
+
+		bool operator==(const Keyframe&) const = default;
+	};
+
+	inline constexpr std::uint32_t noCurve = 0xFFFFFFFF;
+
+	class LUT {
+		public:
+			static constexpr std::size_t resolution = 96;  // One sample per 15 game minutes
+
+			/**
+			 * @brief Bakes the keyframes, interpolating linearly between them and wrapping around midnight.
+			 * @param a_rangeScale Applied to every range value, so the table holds the same units as the weather index.
+			 */
+			void Bake(std::span<const Keyframe> a_keys, float a_rangeScale) {
+				std::vector<Keyframe> keys(a_keys.begin(), a_keys.end());
+				for (auto& key : keys) {
+					key.hour = WrapHour(key.hour);
+				}
+				std::ranges::stable_sort(keys, {}, &Keyframe::hour);
+
+				for (std::size_t i = 0; i < resolution; i++) {
+					const auto [strength, range] = Evaluate(keys, static_cast<float>(i) * (24.0f / resolution));
+					_strength[i] = strength;
+					_range[i]    = range * a_rangeScale;
+				}
+			}
+
+			/**
+			 * @return Strength and range at the given hour.
+			 */
+			std::pair<float, float> Sample(float a_hour) const {
+				const float       position = WrapHour(a_hour) * (resolution / 24.0f);
+				const std::size_t index    = std::min(static_cast<std::size_t>(position), resolution - 1);
+				const std::size_t next     = (index + 1) % resolution;
+				const float       t        = position - static_cast<float>(index);
+
+				return { std::lerp(_strength[index], _strength[next], t), std::lerp(_range[index], _range[next], t) };
+			}
+
+			const std::array<float, resolution>& Strength() const { return _strength; }
+			const std::array<float, resolution>& Range() const { return _range; }
+
+		private:
+			static float WrapHour(float a_hour) {
+				const float hour = std::fmod(a_hour, 24.0f);
+				return hour < 0.0f ? hour + 24.0f : hour;
+			}
+
+			static std::pair<float, float> Evaluate(const std::vector<Keyframe>& a_keys, float a_hour) {
+				if (a_keys.empty()) return { 0.0f, 0.0f };
+				if (a_keys.size() == 1) return { a_keys[0].strength, a_keys[0].range };
+
+				// Neighbours on the 24 hour circle, the last key wraps to before the first one
+				const auto upper = std::ranges::upper_bound(a_keys, a_hour, {}, &Keyframe::hour);
+				const auto& next = upper == a_keys.end() ? a_keys.front() : *upper;
+				const auto& prev = upper == a_keys.begin() ? a_keys.back() : *(upper - 1);
+
+				float span   = next.hour - prev.hour;
+				float offset = a_hour - prev.hour;
+				if (span <= 0.0f) span += 24.0f;
+				if (offset < 0.0f) offset += 24.0f;
+
+				const float t = span > 0.0f ? std::clamp(offset / span, 0.0f, 1.0f) : 0.0f;
+				return { std::lerp(prev.strength, next.strength, t), std::lerp(prev.range, next.range, t) };
+			}
+
+			std::array<float, resolution> _strength{};
+			std::array<float, resolution> _range{};
+	};
+}
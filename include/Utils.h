@@ -1,93 +1,508 @@
-#pragma once
-
-#include "Settings.h"
-
-namespace Utils {
-	extern std::map<std::type_index, std::vector<std::string>> g_formCache;
-	extern std::map<std::type_index, bool>                     g_cachePopulated;
-
-	/**
-	 * @brief Validates a TESForm pointer against expected criteria.
-	 *
-	 * This function checks if the provided form is non-null, has a valid
-	 * FormType matching the expected type, and possesses a valid FormID.
-	 *
-	 * @param form The TESForm pointer to validate.
-	 * @param expectedType The expected FormType of the form.
-	 * @return true if the form is valid and matches the expected type; false otherwise.
-	 */
-	bool ValidateForm(RE::TESForm* form, RE::FormType expectedType);
-
-	/**
-	 * @brief Counts, logs, and caches all forms of a specified type.
-	 *
-	 * This function is a template, allowing it to work with any RE::TESForm-derived class.
-	 * It iterates through the form array for the given type, validates each form,
-	 * logs its information, and stores its editorID in a global cache for later use.
-	 *
-	 * @tparam T The form type to count (e.g., RE::TESWeather, RE::TESImageSpaceModifier).
-	 *           This type MUST have a static member `formType` of type RE::FormType.
-	 * @param specialProcessing An optional lambda function to run on each valid form found.
-	 *                          This is useful for handling type-specific logic without
-	 *                          cluttering the main function.
-	 * @return The total number of valid forms found for the given type.
-	 */
-	template <typename T>
-	int CountAndCacheForms(std::function<void(T*)> specialProcessing = nullptr) {
-		// Get a unique, safe key to use in map.
-		auto typeKey  = std::type_index(typeid(T));
-		auto typeName = typeid(T).name(); // Cache for logging
-
-		if (g_cachePopulated[typeKey]) {
-			Logger::info("Cache for {} is already populated with {} entries. Skipping.", typeName, g_formCache[typeKey].size());
-			return static_cast<int>(g_formCache[typeKey].size());
-		}
-
-		Logger::info("Populating form cache for type: {}.", typeName);
-
-		auto& formList = g_formCache[typeKey];
-		formList.clear();
-		formList.push_back("None"); // Add a default "None" option
-
-		int count = 0;
-
-		for (T* form : RE::TESDataHandler::GetSingleton()->GetFormArray<T>()) {
-			if ((ValidateForm(form, T::FORMTYPE) && Settings::general.ExtraChecks) || form) {
-				auto editorID = clib_util::editorID::get_editorID(form);
-				Logger::trace("Found {}: {} | FormID: {:x}", typeName, editorID, form->GetFormID());
-
-				formList.push_back(editorID);
-				count++;
-
-				if (specialProcessing) {
-					specialProcessing(form);
-				}
-			} else {
-				Logger::warn("Skipping a null pointer in the {} form array.", typeName);
-			}
-		}
-		if (formList.size() > 1) {
-			std::sort(formList.begin() + 1, formList.end());
-		}
-		g_cachePopulated[typeKey] = true;
-		Logger::info("Finished populating cache for {}. Found {} valid entries.", typeName, count);
-
-		// The final size will be count + 1 because of the "None" entry.
-		return static_cast<int>(formList.size());
-	}
-
-	std::string GetCurrentWeather();
-	std::string GetPreviousWeather();
-
-	inline void CenteredImGuiText(const char* text) {
-		ImGuiMCP::ImVec2 a_vec;
-		ImGuiMCP::CalcTextSize(&a_vec, text, nullptr, false, 0);
-
-		// Calculate the horizontal position to center the text
-		float textX = ImGuiMCP::GetCursorPosX() + (ImGuiMCP::GetColumnWidth() - a_vec.x) * 0.5f;
-
-		ImGuiMCP::SetCursorPosX(textX);
-		ImGuiMCP::Text("%s", text);
-		return;
-	}
-}
\ No newline at end of file
+#pragma once
+
+#include "Logger.h"
+#include "Memory.h"
+#include "Settings.h"
+
+namespace Utils {
+	/**
+	 * @brief 64-bit FNV-1a hash, chainable through a_seed.
+	 */
+	inline std::uint64_t HashBytes(std::string_view a_bytes, std::uint64_t a_seed = 0xCBF29CE484222325ull) {
+		std::uint64_t hash = a_seed;
+		for (const auto c : a_bytes) {
+			hash ^= static_cast<std::uint8_t>(c);
+			hash *= 0x100000001B3ull;
+		}
+		return hash;
+	}
+
+	/**
+	 * @brief Writes the content next to the target and renames it over the original,
+	 *        so a crash mid-write never leaves a truncated file behind.
+	 */
+	bool WriteFileAtomic(const std::filesystem::path& a_path, std::string_view a_content);
+
+	/**
+	 * @brief Read-only memory mapping of a whole file, unmapped on destruction.
+	 */
+	class MappedFile {
+		public:
+			MappedFile() = default;
+			explicit MappedFile(const std::filesystem::path& a_path) { Open(a_path); }
+			~MappedFile() { Close(); }
+
+			MappedFile(const MappedFile&)            = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			bool Open(const std::filesystem::path& a_path);
+			void Close();
+
+			bool                       IsOpen() const { return _view != nullptr; }
+			std::span<const std::byte> Data() const { return { static_cast<const std::byte*>(_view), _size }; }
+
+		private:
+			void*       _file    = nullptr;
+			void*       _mapping = nullptr;
+			const void* _view    = nullptr;
+			std::size_t _size    = 0;
+	};
+
+	/**
+	 * @brief A flat, name-sorted cache of every form of a single type.
+	 *
+	 * Each entry holds the FormID, the form pointer and an offset into one shared string arena,
+	 * so a load order with thousands of forms costs two allocations instead of one per editorID.
+	 * Index 0 is always the "None" placeholder with a null form, the rest is sorted by editorID.
+	 *
+	 * @tparam T The form type cached (e.g., RE::TESWeather, RE::TESImageSpaceModifier).
+	 */
+	template <typename T>
+	class FormCache {
+		public:
+			struct Entry {
+				RE::FormID    formID     = 0;
+				T*            form       = nullptr;
+				std::uint32_t nameOffset = 0;
+				std::uint32_t nameLength = 0;
+			};
+
+			using EntryList   = Memory::Vector<Entry, Memory::kFormCache>;
+			using ArenaString = Memory::String<Memory::kFormCache>;
+
+			bool        IsPopulated() const { return _populated; }
+			std::size_t Size() const { return _entries.size(); }
+
+			const Entry&     operator[](std::size_t a_index) const { return _entries[a_index]; }
+			const char*      Name(std::size_t a_index) const { return _arena.data() + _entries[a_index].nameOffset; }
+			std::string_view NameView(std::size_t a_index) const { return { Name(a_index), _entries[a_index].nameLength }; }
+
+			/**
+			 * @brief Binary searches the cache for an editorID.
+			 * @return The matching entry, or nullptr if the name is not cached (or is "None").
+			 */
+			const Entry* Find(std::string_view a_editorID) const {
+				if (_entries.size() <= 1) return nullptr;
+
+				const auto it = std::lower_bound(_entries.begin() + 1, _entries.end(), a_editorID, [this](const Entry& a_entry, std::string_view a_name) {
+					return NameOf(a_entry) < a_name;
+				});
+				return (it != _entries.end() && NameOf(*it) == a_editorID) ? std::to_address(it) : nullptr;
+			}
+
+			const EntryList& Entries() const { return _entries; }
+			std::string_view Arena() const { return _arena; }
+
+			/**
+			 * @brief Replaces the contents with entries that are already sorted, e.g. loaded from disk.
+			 */
+			void Assign(EntryList&& a_entries, ArenaString&& a_arena) {
+				_entries   = std::move(a_entries);
+				_arena     = std::move(a_arena);
+				_populated = true;
+			}
+
+			void Clear() {
+				_entries.clear();
+				_arena.clear();
+				_populated = false;
+			}
+
+			/**
+			 * @brief Clear() that also hands the memory back, for caches only needed during startup.
+			 */
+			void Release() {
+				EntryList().swap(_entries);
+				ArenaString().swap(_arena);
+				_populated = false;
+			}
+
+			void Reserve(std::size_t a_count) {
+				_entries.reserve(a_count + 1);
+				_arena.reserve((a_count + 1) * 24); // Typical editorIDs are well under 24 characters
+			}
+
+			void Add(T* a_form, std::string_view a_editorID) {
+				Entry entry;
+				entry.formID     = a_form ? a_form->GetFormID() : 0;
+				entry.form       = a_form;
+				entry.nameOffset = static_cast<std::uint32_t>(_arena.size());
+				entry.nameLength = static_cast<std::uint32_t>(a_editorID.size());
+
+				_arena.append(a_editorID);
+				_arena.push_back('\0'); // Keep names null terminated so ImGui can take them directly
+				_entries.push_back(entry);
+			}
+
+			void Finalize() {
+				if (_entries.size() > 1) {
+					// Mods can reuse an editorID, the formID tie-break keeps the order the same from load to load
+					std::sort(std::execution::par, _entries.begin() + 1, _entries.end(), [this](const Entry& a_lhs, const Entry& a_rhs) {
+						const auto order = NameOf(a_lhs).compare(NameOf(a_rhs));
+						return order != 0 ? order < 0 : a_lhs.formID < a_rhs.formID;
+					});
+				}
+				_entries.shrink_to_fit();
+				_arena.shrink_to_fit();
+				_populated = true;
+			}
+
+		private:
+			std::string_view NameOf(const Entry& a_entry) const { return { _arena.data() + a_entry.nameOffset, a_entry.nameLength }; }
+
+			EntryList   _entries;
+			ArenaString _arena;
+			bool        _populated = false;
+	};
+
+	// ------------------------------
+	// Persistent Form Cache
+	// ------------------------------
+	namespace FormCacheFile {
+		inline std::string path = "Data/SKSE/Plugins/DBFormCache.bin";
+
+		struct Record {
+			std::uint32_t formID;
+			std::uint32_t nameOffset;
+			std::uint32_t nameLength;
+		};
+
+		struct Section {
+			std::uint32_t           formType = 0;
+			std::span<const Record> records;
+			std::string_view        arena;
+		};
+
+		/**
+		 * @brief Hash of the active plugin list in load order, with each plugin's size and timestamp.
+		 */
+		std::uint64_t GetLoadOrderFingerprint();
+
+		/**
+		 * @brief Maps the cache file and checks it against the current load order. Cheap to call again.
+		 * @return false if the file is missing, corrupt or was built for a different load order.
+		 */
+		bool Open();
+
+		const Section* Find(RE::FormType a_formType);
+
+		/**
+		 * @brief Queues a rebuilt section for Commit().
+		 */
+		void Stage(RE::FormType a_formType, std::vector<Record>&& a_records, std::string_view a_arena);
+
+		/**
+		 * @brief Rewrites the file if any section had to be rebuilt, then releases the mapping.
+		 */
+		void Commit();
+
+		template <typename T>
+		bool Load(FormCache<T>& a_cache) {
+			if (!Open()) return false;
+
+			const auto section = Find(T::FORMTYPE);
+			if (!section || section->records.empty()) return false;
+
+			typename FormCache<T>::EntryList entries;
+			entries.reserve(section->records.size());
+
+			for (const auto& record : section->records) {
+				// Names must stay inside the arena and keep their null terminator
+				if (static_cast<std::size_t>(record.nameOffset) + record.nameLength >= section->arena.size()) return false;
+
+				T* form = nullptr;
+				if (record.formID) {
+					form = RE::TESForm::LookupByID<T>(record.formID);
+					if (!form) return false; // Stale entry, rebuild
+				}
+				entries.push_back({ record.formID, form, record.nameOffset, record.nameLength });
+			}
+
+			a_cache.Assign(std::move(entries), typename FormCache<T>::ArenaString(section->arena));
+			return true;
+		}
+
+		template <typename T>
+		void Stage(const FormCache<T>& a_cache) {
+			std::vector<Record> records;
+			records.reserve(a_cache.Size());
+			for (const auto& entry : a_cache.Entries()) {
+				records.push_back({ entry.formID, entry.nameOffset, entry.nameLength });
+			}
+			Stage(T::FORMTYPE, std::move(records), a_cache.Arena());
+		}
+	}
+
+	/**
+	 * @brief How a range of work is split across the worker pool.
+	 */
+	struct ChunkPlan {
+		std::size_t chunkCount = 1;
+		std::size_t chunkSize  = 0;
+	};
+
+	/**
+	 * @brief Splits a_count items into at most one chunk per core (capped at 8), never smaller than a_minChunkSize.
+	 */
+	inline ChunkPlan PlanChunks(std::size_t a_count, std::size_t a_minChunkSize) {
+		const std::size_t workers = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, 8);
+		const std::size_t chunks  = std::clamp<std::size_t>(a_count / std::max<std::size_t>(a_minChunkSize, 1), 1, workers);
+		return { chunks, (a_count + chunks - 1) / chunks };
+	}
+
+	/**
+	 * @brief Runs a_fn(chunkIndex, begin, end) for every chunk of the plan, the first chunk on the calling thread.
+	 *        Returns once every chunk has finished.
+	 */
+	template <typename Fn>
+	void ParallelForChunks(const ChunkPlan& a_plan, std::size_t a_count, Fn&& a_fn) {
+		std::vector<std::jthread> workers;
+		workers.reserve(a_plan.chunkCount - 1);
+
+		for (std::size_t chunk = 1; chunk < a_plan.chunkCount; chunk++) {
+			workers.emplace_back([&, chunk] {
+				a_fn(chunk, std::min(a_count, chunk * a_plan.chunkSize), std::min(a_count, (chunk + 1) * a_plan.chunkSize));
+			});
+		}
+		a_fn(std::size_t{ 0 }, std::size_t{ 0 }, std::min(a_count, a_plan.chunkSize));
+	}
+
+	// One cache per form type, resolved at compile time.
+	template <typename T>
+	inline FormCache<T> g_formCache;
+
+	/**
+	 * @brief Why a form failed validation, in the order the checks run.
+	 */
+	enum class FormIssue : std::uint8_t {
+		kNone,
+		kNull,
+		kDeleted,
+		kIgnored,
+		kUninitialized,
+		kDisabled,
+		kWrongType,
+		kNoFormID,
+		kNoEditorID,  // Only a warning, the form is still usable
+		kCount
+	};
+
+	inline constexpr const char* formIssueNames[static_cast<std::size_t>(FormIssue::kCount)] = {
+		"valid", "null", "deleted", "ignored", "not initialized", "disabled", "wrong form type", "no FormID", "no editorID"
+	};
+
+	/**
+	 * @brief The first check a form fails, without logging. Read-only, so it is safe off the main thread once data is loaded.
+	 * @note The editorID is not looked up here, callers that have it cached pass it through a_hasEditorID.
+	 */
+	FormIssue CheckForm(RE::TESForm* form, RE::FormType expectedType, bool a_hasEditorID = true);
+
+	/**
+	 * @brief Validates a TESForm pointer against expected criteria.
+	 *
+	 * This function checks if the provided form is non-null, has a valid
+	 * FormType matching the expected type, and possesses a valid FormID.
+	 * Meant for single forms, it logs the failure and, with VerboseLogging, the form's details.
+	 *
+	 * @param form The TESForm pointer to validate.
+	 * @param expectedType The expected FormType of the form.
+	 * @return true if the form is valid and matches the expected type; false otherwise.
+	 */
+	bool ValidateForm(RE::TESForm* form, RE::FormType expectedType);
+
+	/**
+	 * @brief With ExtraChecks on, validates every cached weather and IMAD on a background thread and logs one
+	 *        summary with the count per FormIssue. The form lists are copied first, so the caches may change meanwhile.
+	 */
+	void StartFormValidation();
+
+	/**
+	 * @brief Counts, logs, and caches all forms of a specified type.
+	 *
+	 * This function is a template, allowing it to work with any RE::TESForm-derived class.
+	 * It iterates through the form array for the given type, validates each form,
+	 * logs its information, and stores it in g_formCache<T> for later use.
+	 *
+	 * @tparam T The form type to count (e.g., RE::TESWeather, RE::TESImageSpaceModifier).
+	 *           This type MUST have a static member `formType` of type RE::FormType.
+	 * @param specialProcessing An optional callable to run on each valid form found.
+	 *                          This is useful for handling type-specific logic without
+	 *                          cluttering the main function.
+	 * @return The total number of entries in the cache, including the "None" entry.
+	 */
+	template <typename T, typename Fn = std::nullptr_t>
+	int CountAndCacheForms(Fn&& specialProcessing = nullptr) {
+		auto typeName = typeid(T).name(); // Cache for logging
+		auto& cache   = g_formCache<T>;
+
+		if (cache.IsPopulated()) {
+			Logger::info("Cache for {} is already populated with {} entries. Skipping.", typeName, cache.Size());
+			return static_cast<int>(cache.Size());
+		}
+
+		using Clock = std::chrono::steady_clock;
+		const auto toMilliseconds = [](Clock::duration a_duration) { return std::chrono::duration<double, std::milli>(a_duration).count(); };
+
+		// Fast path: the load order matches the one the cache file was built for.
+		const auto diskStart = Clock::now();
+		if (FormCacheFile::Load(cache)) {
+			if constexpr (!std::is_same_v<std::remove_cvref_t<Fn>, std::nullptr_t>) {
+				for (const auto& entry : cache.Entries()) {
+					if (entry.form) specialProcessing(entry.form);
+				}
+			}
+			Logger::info("Loaded cache for {} from '{}' with {} entries in {:.2f} ms.", typeName, FormCacheFile::path, cache.Size(), toMilliseconds(Clock::now() - diskStart));
+			return static_cast<int>(cache.Size());
+		}
+
+		Logger::info("Populating form cache for type: {}.", typeName);
+
+		const auto& formArray = RE::TESDataHandler::GetSingleton()->GetFormArray<T>();
+		const auto  formCount = static_cast<std::size_t>(formArray.size());
+
+		// Phase 1: validate and fetch editorIDs in parallel. This is read-only, nothing here touches plugin state.
+		struct FoundForm {
+			T*          form;
+			std::string editorID;
+		};
+
+		const auto                          plan = PlanChunks(formCount, 512);
+		std::vector<std::vector<FoundForm>> chunks(plan.chunkCount);
+		std::vector<std::size_t>            skipped(plan.chunkCount, 0);
+
+		const auto enumerateStart = Clock::now();
+		ParallelForChunks(plan, formCount, [&](std::size_t a_chunk, std::size_t a_begin, std::size_t a_end) {
+			auto& found = chunks[a_chunk];
+			found.reserve(a_end - a_begin);
+
+			for (std::size_t i = a_begin; i < a_end; i++) {
+				T* form = formArray[static_cast<std::uint32_t>(i)];
+				// Validation is opt-in and runs after load, see StartFormValidation()
+				if (form) {
+					found.push_back({ form, clib_util::editorID::get_editorID(form) });
+				} else {
+					skipped[a_chunk]++;
+				}
+			}
+		});
+		const auto enumerateTime = Clock::now() - enumerateStart;
+
+		// Phase 2: merge the chunks into the arena in form array order.
+		const auto mergeStart = Clock::now();
+
+		cache.Clear();
+		cache.Reserve(formCount);
+		cache.Add(nullptr, "None"); // Add a default "None" option
+
+		int         count        = 0;
+		std::size_t skippedCount = 0;
+
+		for (std::size_t chunk = 0; chunk < plan.chunkCount; chunk++) {
+			for (const auto& [form, editorID] : chunks[chunk]) {
+				LOG_TRACE(Log::kCache, "Found {}: {} | FormID: {:x}", typeName, editorID, form->GetFormID());
+				cache.Add(form, editorID);
+				count++;
+			}
+			skippedCount += skipped[chunk];
+		}
+		const auto mergeTime = Clock::now() - mergeStart;
+
+		// Phase 3: parallel sort by editorID.
+		const auto sortStart = Clock::now();
+		cache.Finalize();
+		const auto sortTime = Clock::now() - sortStart;
+
+		// Phase 4: type-specific processing mutates plugin state, so it stays on this thread.
+		const auto processStart = Clock::now();
+		if constexpr (!std::is_same_v<std::remove_cvref_t<Fn>, std::nullptr_t>) {
+			for (const auto& chunk : chunks) {
+				for (const auto& found : chunk) {
+					specialProcessing(found.form);
+				}
+			}
+		}
+		const auto processTime = Clock::now() - processStart;
+
+		if (skippedCount) {
+			Logger::warn("Skipped {} null pointers in the {} form array.", skippedCount, typeName);
+		}
+		Logger::info("Finished populating cache for {}. Found {} valid entries.", typeName, count);
+		Logger::info("Form cache timings for {}: enumerate {:.2f} ms ({} threads), merge {:.2f} ms, sort {:.2f} ms, processing {:.2f} ms.",
+			typeName, toMilliseconds(enumerateTime), plan.chunkCount, toMilliseconds(mergeTime), toMilliseconds(sortTime), toMilliseconds(processTime));
+
+		FormCacheFile::Stage(cache);
+
+		// The final size will be count + 1 because of the "None" entry.
+		return static_cast<int>(cache.Size());
+	}
+
+	std::string GetCurrentWeather();
+	std::string GetPreviousWeather();
+
+	/**
+	 * @brief Centers already measured text in the current column, for callers that cache their text widths.
+	 */
+	inline void CenteredImGuiText(const char* text, float textWidth) {
+		// Calculate the horizontal position to center the text
+		float textX = ImGuiMCP::GetCursorPosX() + (ImGuiMCP::GetColumnWidth() - textWidth) * 0.5f;
+
+		ImGuiMCP::SetCursorPosX(textX);
+		ImGuiMCP::Text("%s", text);
+	}
+
+	inline void CenteredImGuiText(const char* text) {
+		ImGuiMCP::ImVec2 a_vec;
+		ImGuiMCP::CalcTextSize(&a_vec, text, nullptr, false, 0);
+		CenteredImGuiText(text, a_vec.x);
+	}
+
+	/**
+	 * @brief Manual list clipper for items of a fixed height inside the current scrolling window.
+	 *        Only the [first, last) range is submitted, the rest is replaced by two spacers so the
+	 *        scrollbar still covers the full list.
+	 */
+	class ListClip {
+		public:
+			ListClip(int a_count, float a_itemHeight) : _count(a_count), _itemHeight(a_itemHeight) {
+				const float spacing = _itemHeight - ImGuiMCP::GetTextLineHeight();
+				const float startY  = ImGuiMCP::GetCursorPosY();
+				const float scrollY = ImGuiMCP::GetScrollY();
+				const float height  = ImGuiMCP::GetWindowHeight();
+
+				first = std::clamp(static_cast<int>((scrollY - startY) / _itemHeight), 0, _count);
+				last  = std::clamp(static_cast<int>((scrollY + height - startY) / _itemHeight) + 2, first, _count);
+
+				if (first > 0) {
+					ImGuiMCP::Dummy(ImGuiMCP::ImVec2(0.0f, first * _itemHeight - spacing));
+				}
+			}
+
+			~ListClip() {
+				const float spacing = _itemHeight - ImGuiMCP::GetTextLineHeight();
+				if (last < _count) {
+					ImGuiMCP::Dummy(ImGuiMCP::ImVec2(0.0f, (_count - last) * _itemHeight - spacing));
+				}
+			}
+
+			ListClip(const ListClip&)            = delete;
+			ListClip& operator=(const ListClip&) = delete;
+
+			int first = 0;
+			int last  = 0;
+
+		private:
+			int   _count;
+			float _itemHeight;
+	};
+
+	/**
+	 * @brief Case-insensitive ASCII substring test, an empty needle matches everything.
+	 */
+	inline bool ContainsNoCase(std::string_view a_haystack, std::string_view a_needle) {
+		if (a_needle.empty()) return true;
+		const auto it = std::search(a_haystack.begin(), a_haystack.end(), a_needle.begin(), a_needle.end(), [](char a, char b) {
+			return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+		});
+		return it != a_haystack.end();
+	}
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Easing.h"
+#include "ImodChannels.h"
+#include "TimeCurve.h"
+
+namespace WeatherIndex {
+
+	/**
+	 * @brief The resolved blur values for a single weather, as compiled from a WeatherSettingRow.
+	 */
+	struct Entry {
+		float         strength     = 0.0f;
+		float         range        = 0.0f;
+		bool          staticToggle = false;
+		Easing::Curve easing       = Easing::defaultCurve;
+		float         duration     = Easing::defaultDuration;  // Ignored when staticToggle is set
+
+		std::uint32_t curve    = TimeCurve::noCurve;  // Index into the controller's baked curves
+		std::uint32_t channels = Imod::noChannels;    // Index into the controller's channel sets
+
+		bool operator==(const Entry&) const = default;
+	};
+
+	/**
+	 * @brief Flat open-addressing hash map keyed by FormID.
+	 *
+	 * FormID 0 is never a valid record, so it doubles as the empty-slot marker.
+	 * The table is sized once when compiled and never grows on the hot path,
+	 * so Find() is a single probe in the common case and never allocates.
+	 *
+	 * @tparam T The value stored per FormID.
+	 */
+	template <typename T>
+	class FormMap {
+		public:
+			void Reserve(std::size_t a_count) {
+				std::size_t capacity = 16;
+				while (capacity < a_count * 2) {
+					capacity <<= 1;
+				}
+				_slots.assign(capacity, Slot{});
+				_mask = static_cast<std::uint32_t>(capacity - 1);
+				_size = 0;
+			}
+
+			void Clear() {
+				_slots.clear();
+				_mask = 0;
+				_size = 0;
+			}
+
+			/**
+			 * @brief Inserts a value for a FormID. The first insertion wins, mirroring the
+			 *        first-match semantics of the weather table.
+			 * @return false if the FormID is 0 or already present.
+			 */
+			bool Insert(std::uint32_t a_formID, const T& a_value) {
+				if (!a_formID) return false;
+				if (_slots.empty() || (_size + 1) * 2 > _slots.size()) {
+					Rehash(_size + 1);
+				}
+
+				for (std::uint32_t i = Hash(a_formID);; i = (i + 1) & _mask) {
+					auto& slot = _slots[i];
+					if (slot.key == a_formID) return false;
+					if (!slot.key) {
+						slot.key   = a_formID;
+						slot.value = a_value;
+						++_size;
+						return true;
+					}
+				}
+			}
+
+			const T* Find(std::uint32_t a_formID) const {
+				if (!a_formID || _slots.empty()) return nullptr;
+
+				for (std::uint32_t i = Hash(a_formID);; i = (i + 1) & _mask) {
+					const auto& slot = _slots[i];
+					if (slot.key == a_formID) return &slot.value;
+					if (!slot.key) return nullptr;
+				}
+			}
+
+			std::size_t Size() const { return _size; }
+			bool        Empty() const { return _size == 0; }
+
+		private:
+			struct Slot {
+				std::uint32_t key = 0;
+				T             value{};
+			};
+
+			std::uint32_t Hash(std::uint32_t a_formID) const {
+				// Fibonacci hashing, load order index lives in the top byte so mix it down.
+				return static_cast<std::uint32_t>((a_formID * 0x9E3779B9u) ^ (a_formID >> 16)) & _mask;
+			}
+
+			void Rehash(std::size_t a_count) {
+				auto old = std::move(_slots);
+				Reserve(a_count);
+				for (const auto& slot : old) {
+					if (slot.key) Insert(slot.key, slot.value);
+				}
+			}
+
+			std::vector<Slot> _slots;
+			std::uint32_t     _mask = 0;
+			std::size_t       _size = 0;
+	};
+
+	using WeatherMap = FormMap<Entry>;
+}
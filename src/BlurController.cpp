@@ -0,0 +1,335 @@
+#include "BlurController.h"
+
+#include <bit>
+#include <cmath>
+
+namespace Blur {
+
+	void Controller::Compile(std::span<const RowInput> a_rows, bool a_reselect) {
+		_index.Reserve(a_rows.size());
+		_noWeather.reset();
+		_curves.clear();
+		_channelSets.clear();
+
+		for (const auto& row : a_rows) {
+			if (!row.enabled || (row.formID ? _index.Find(row.formID) != nullptr : _noWeather.has_value())) continue;
+
+			WeatherIndex::Entry entry{ row.strength, row.range * 10, row.staticToggle, row.easing, row.duration };
+			if (!row.curve.empty()) {
+				entry.curve = static_cast<std::uint32_t>(_curves.size());
+				_curves.emplace_back().Bake(row.curve, 10.0f);
+			}
+
+			// DOF comes from the row's own strength and range, so only the other channels are packed here
+			ChannelSet set;
+			for (const auto& target : row.channels) {
+				if (target.channel >= Imod::kChannelCount || ((1u << target.channel) & Imod::dofMask)) continue;
+				set.mask |= 1u << target.channel;
+				set.values[target.channel] = target.value;
+			}
+			if (set.mask) {
+				entry.channels = static_cast<std::uint32_t>(_channelSets.size());
+				_channelSets.push_back(set);
+			}
+			if (row.formID) {
+				_index.Insert(row.formID, entry);
+			} else {
+				_noWeather = entry;
+			}
+		}
+
+		if (a_reselect) {
+			_dirty = true;
+		} else if (!_override) {
+			// Curve indices may have shifted even though the active row did not change
+			const auto entry = Find(_currentWeather, _lastMode);
+			_activeCurve     = entry ? entry->curve : TimeCurve::noCurve;
+		}
+	}
+
+	void Controller::SetAutomatic(std::span<const AutoBlur::Derived> a_table) {
+		_automatic.Reserve(a_table.size());
+		for (const auto& derived : a_table) {
+			WeatherIndex::Entry entry{ derived.strength, derived.range * 10, false, Easing::defaultCurve, derived.duration };  // Same units as Compile
+			_automatic.Insert(derived.formID, entry);
+		}
+		_dirty = true;
+	}
+
+	const WeatherIndex::Entry* Controller::Find(std::uint32_t a_weather, Mode a_mode) const {
+		if (!a_weather) return _noWeather ? &*_noWeather : nullptr;
+
+		const auto entry = _index.Find(a_weather);
+		return entry || a_mode != Mode::kAutomatic ? entry : _automatic.Find(a_weather);
+	}
+
+	void Controller::SetOverride(const WeatherIndex::Entry* a_entry) {
+		const auto next = a_entry ? std::optional(*a_entry) : std::nullopt;
+		if (next != _override) {
+			_override = next;
+			_dirty    = true;
+		}
+	}
+
+	void Controller::SetZone(const Zones::Sample& a_sample) {
+		if (a_sample == _zone) return;
+		_zoneCrossed |= a_sample.signature != _zone.signature;
+		_zoneMoved    = true;
+		_zone         = a_sample;
+	}
+
+	void Controller::SetBaseline(const Imod::Values& a_values) {
+		_baseline                     = a_values;
+		_baseline[Imod::kDOFStrength] = 0.0f;
+		_baseline[Imod::kDOFRange]    = 0.0f;
+
+		// Nothing has been written yet, so the IMOD already holds these values
+		for (std::uint32_t i = 0; i < Imod::kChannelCount; i++) {
+			if ((1u << i) & Imod::dofMask) continue;
+			_channels.applied[i] = _baseline[i];
+			_channels.target[i]  = _baseline[i];
+			_channels.start[i]   = _baseline[i];
+		}
+		_channels.extrasMoving = false;
+		_extrasTargeted        = false;
+		_dirty                 = true;
+	}
+
+	void Controller::ResetExtraTargets(const WeatherIndex::Entry* a_entry) {
+		const auto set = a_entry && a_entry->channels != Imod::noChannels ? &_channelSets[a_entry->channels] : nullptr;
+		if (!set && !_extrasTargeted) return;  // Already resting at the baseline
+
+		auto&      target   = _channels.target;
+		const auto strength = target[Imod::kDOFStrength];
+		const auto range    = target[Imod::kDOFRange];
+
+		target                     = _baseline;
+		target[Imod::kDOFStrength] = strength;
+		target[Imod::kDOFRange]    = range;
+
+		if (set) {
+			for (auto mask = set->mask; mask; mask &= mask - 1) {
+				const auto channel = std::countr_zero(mask);
+				target[channel]    = set->values[channel];
+			}
+		}
+		_extrasTargeted        = set != nullptr;
+		_channels.extrasMoving = (Imod::DifferingLanes(_channels.applied, target) & ~Imod::dofMask) != 0;
+	}
+
+	bool Controller::ExtrasAtBaseline(const Imod::Values& a_values) const {
+		return (Imod::DifferingLanes(a_values, _baseline) & ~Imod::dofMask) == 0;
+	}
+
+	void Controller::BeginTransition(const WeatherIndex::Entry* a_entry) {
+		if (!a_entry) {
+			_channels.Begin(Easing::defaultDuration, Easing::defaultCurve);
+		} else {
+			_channels.Begin(a_entry->staticToggle ? 0.0f : a_entry->duration, a_entry->easing);
+		}
+	}
+
+	void Controller::SetBaseTarget(float a_strength, float a_range) {
+		_baseStrength = a_strength;
+		_baseRange    = a_range;
+		ApplyZone();
+	}
+
+	void Controller::ApplyZone() {
+		// Without a zone this is 1 * base + 0, the base values exactly
+		_channels.target[Imod::kDOFStrength] = _zone.Strength(_baseStrength);
+		_channels.target[Imod::kDOFRange]    = _zone.Range(_baseRange);
+	}
+
+	void Controller::SelectTarget(const ISky& a_sky, std::uint32_t a_weather, Mode a_mode) {
+		auto&      target   = _channels.target;
+		const auto previous = target;
+		const auto entry    = _override ? &*_override : Find(a_weather, a_mode);
+		_activeCurve        = entry ? entry->curve : TimeCurve::noCurve;
+		ResetExtraTargets(entry);
+
+		if (_activeCurve != TimeCurve::noCurve) {
+			const auto [strength, range] = _curves[_activeCurve].Sample(a_sky.GetGameHour());
+			SetBaseTarget(strength, range);
+		} else if (entry) {
+			SetBaseTarget(entry->strength, entry->range);
+		} else {
+			SetBaseTarget(0.0f, 0.0f);
+		}
+
+		// A re-selection that lands on the same values leaves the running transition alone
+		if (!Imod::DifferingLanes(previous, target)) return;
+
+		// Check PREVIOUS weather to decide how we transition OUT
+		BeginTransition(entry ? entry : Find(a_sky.GetPreviousWeather(), a_mode));
+	}
+
+	std::uint32_t Controller::Update(float a_delta, Mode a_mode, const ISky& a_sky, IImodSink& a_sink) {
+		std::uint32_t events  = kNoEvent;
+		std::uint32_t changed = 0;
+		auto&         target  = _channels.target;
+
+		// The running transition reaches this frame before anything can replace it, so a new one starts
+		// from exactly where the old one is now, whatever the frame rate
+		_channels.Advance(a_delta);
+
+		// A curved row moves its own target with the clock
+		if (_activeCurve != TimeCurve::noCurve) {
+			const auto [strength, range] = _curves[_activeCurve].Sample(a_sky.GetGameHour());
+			SetBaseTarget(strength, range);
+		}
+
+		if (a_mode == Mode::kNone) {
+			// ========================================================
+			// MODE: NONE (Disable Blur)
+			// ========================================================
+			_activeCurve = TimeCurve::noCurve;
+			if (target[Imod::kDOFStrength] != 0.0f || _extrasTargeted) {
+				changed |= _channels.Step();
+				target[Imod::kDOFStrength] = 0.0f;
+				target[Imod::kDOFRange]    = 0.0f;
+				ResetExtraTargets(nullptr);
+				BeginTransition(nullptr); // Fade out nicely
+			}
+		} else {
+			// ========================================================
+			// MODE: ADVANCED / AUTOMATIC (Weather Table)
+			// ========================================================
+			const auto newWeather = a_sky.GetCurrentWeather();
+
+			if (newWeather != _currentWeather || _dirty || a_mode != _lastMode) {
+				changed |= _channels.Step();
+				_currentWeather = newWeather;
+				SelectTarget(a_sky, newWeather, a_mode);
+				events |= kWeatherChanged;
+			} else if (_zoneMoved) {
+				// Crossing a zone edge fades like a weather change, inside a falloff band the target follows the player
+				if (_zoneCrossed) {
+					changed |= _channels.Step();
+					const float strength = target[Imod::kDOFStrength];
+					const float range    = target[Imod::kDOFRange];
+					ApplyZone();
+					if (target[Imod::kDOFStrength] != strength || target[Imod::kDOFRange] != range) BeginTransition(nullptr);
+				} else {
+					ApplyZone();
+				}
+			}
+		}
+
+		_lastMode    = a_mode;
+		_dirty       = false;
+		_zoneMoved   = false;
+		_zoneCrossed = false;
+
+		// One pass over every channel, the mask says which ones the IMOD needs to hear about
+		changed |= _channels.Step();
+
+		if (changed) {
+			const bool dofActive = _channels.applied[Imod::kDOFStrength] > 0.0f;
+			_wantActive          = dofActive || !ExtrasAtBaseline(_channels.applied);
+
+			// DOF is written while an instance exists, so a parked one shows zero strength instead of the last fade step
+			std::uint32_t writeMask = changed & ~Imod::dofMask;
+			if (dofActive || _lifecycle != Lifecycle::kStopped) writeMask |= changed & Imod::dofMask;
+
+			if (writeMask) {
+				a_sink.SetChannels(writeMask, _channels.applied);
+				if (writeMask & Imod::dofMask) events |= kDOFWritten;
+				if (writeMask & ~Imod::dofMask) events |= kChannelsWritten;
+			}
+		}
+
+		return events | UpdateLifecycle(a_delta, a_sink);
+	}
+
+	Controller::Checkpoint Controller::GetCheckpoint() const {
+		return { _currentWeather,
+			_lastMode,
+			_channels.target[Imod::kDOFStrength],
+			_channels.target[Imod::kDOFRange],
+			_channels.applied[Imod::kDOFStrength],
+			_channels.applied[Imod::kDOFRange],
+			_channels.start[Imod::kDOFStrength],
+			_channels.start[Imod::kDOFRange],
+			_channels.elapsed,
+			_channels.duration,
+			_channels.easing,
+			_lifecycle,
+			_parkedTime,
+			_baseStrength,
+			_baseRange };
+	}
+
+	void Controller::Restore(const Checkpoint& a_checkpoint) {
+		_currentWeather = a_checkpoint.weather;
+		_lastMode       = a_checkpoint.mode;
+		_dirty          = false;
+		_zoneMoved      = false;
+		_zoneCrossed    = false;
+		_baseStrength   = a_checkpoint.baseStrength;
+		_baseRange      = a_checkpoint.baseRange;
+
+		const auto entry = a_checkpoint.mode == Mode::kNone ? nullptr : _override ? &*_override : Find(_currentWeather, a_checkpoint.mode);
+		_activeCurve     = entry ? entry->curve : TimeCurve::noCurve;
+
+		// Channel lanes are not recorded, they start out settled on whatever the restored row sets
+		ResetExtraTargets(entry);
+		for (std::uint32_t i = 0; i < Imod::kChannelCount; i++) {
+			if (!((1u << i) & Imod::dofMask)) _channels.applied[i] = _channels.target[i];
+		}
+		_channels.extrasMoving = false;
+		_channels.start        = _channels.applied;
+
+		_channels.target[Imod::kDOFStrength]  = a_checkpoint.targetStrength;
+		_channels.target[Imod::kDOFRange]     = a_checkpoint.targetRange;
+		_channels.applied[Imod::kDOFStrength] = a_checkpoint.appliedStrength;
+		_channels.applied[Imod::kDOFRange]    = a_checkpoint.appliedRange;
+		_channels.start[Imod::kDOFStrength]   = a_checkpoint.startStrength;
+		_channels.start[Imod::kDOFRange]      = a_checkpoint.startRange;
+		_channels.elapsed                     = a_checkpoint.elapsed;
+		_channels.duration                    = a_checkpoint.duration;
+		_channels.easing                      = a_checkpoint.easing;
+
+		_lifecycle  = a_checkpoint.lifecycle;
+		_parkedTime = a_checkpoint.parkedTime;
+		_wantActive = a_checkpoint.appliedStrength > 0.0f || !ExtrasAtBaseline(_channels.applied);
+	}
+
+	std::uint32_t Controller::UpdateLifecycle(float a_delta, IImodSink& a_sink) {
+		std::uint32_t events = kNoEvent;
+
+		if (_lifecycle == Lifecycle::kParked) {
+			if (_wantActive) {
+				_lifecycle = Lifecycle::kActive;
+				events |= kUnparked;
+			} else if ((_parkedTime += a_delta) >= parkGracePeriod || !a_sink.IsInstanceAlive()) {
+				// Nothing came back for it, or the engine already let it go
+				a_sink.Stop();
+				_lifecycle = Lifecycle::kStopped;
+				return events | kStopped;
+			} else {
+				return events;
+			}
+		}
+
+		if (_lifecycle == Lifecycle::kStopped) {
+			if (_wantActive) {
+				a_sink.Trigger();
+				_lifecycle = Lifecycle::kActive;
+				events |= kTriggered;
+			}
+			return events;
+		}
+
+		if (!_wantActive) {
+			_lifecycle  = Lifecycle::kParked;
+			_parkedTime = 0.0f;
+			events |= kParked;
+		} else if (!a_sink.IsInstanceAlive()) {
+			// Dropped behind our back, a load screen clears every running modifier
+			a_sink.Trigger();
+			events |= kTriggered | kRetriggered;
+		}
+		return events;
+	}
+}
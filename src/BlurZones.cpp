@@ -0,0 +1,179 @@
+#include "BlurZones.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+namespace Zones {
+
+	namespace {
+		std::int32_t Axis(float a_value) {
+			const float cell = std::floor(a_value / Grid::cellSize);
+			if (!(cell > -Grid::maxCellIndex)) return -Grid::maxCellIndex;  // Also catches NaN
+			return cell < Grid::maxCellIndex ? static_cast<std::int32_t>(cell) : Grid::maxCellIndex;
+		}
+	}
+
+	Grid::CellCoord Grid::CellOf(const Point& a_position) {
+		return { Axis(a_position.x), Axis(a_position.y) };
+	}
+
+	std::uint32_t Grid::CellKey(CellCoord a_cell) {
+		// Both halves are at least 1 after the offset, so no cell maps to the empty-slot key
+		return (static_cast<std::uint32_t>(a_cell.x + 32768) << 16) | static_cast<std::uint32_t>(a_cell.y + 32768);
+	}
+
+	void Grid::Compile(std::span<const ZoneInput> a_zones) {
+		_zones.clear();
+		_cellZones.clear();
+		_worldIndex.Clear();
+		_worlds.clear();
+		_cellCount    = 0;
+		_droppedZones = 0;
+
+		struct Placement {
+			std::uint32_t world;
+			std::uint32_t key;
+			std::uint32_t zone;
+		};
+		std::vector<Placement> placements;
+
+		for (std::size_t i = 0; i < a_zones.size(); i++) {
+			const auto& zone = a_zones[i];
+			if (!zone.enabled) continue;
+
+			const bool sphere = zone.shape == Shape::kSphere;
+			Point      low    = zone.min;
+			Point      high   = zone.max;
+			if (sphere) {
+				low  = { zone.center.x - zone.radius, zone.center.y - zone.radius, zone.center.z - zone.radius };
+				high = { zone.center.x + zone.radius, zone.center.y + zone.radius, zone.center.z + zone.radius };
+			}
+
+			// Comparisons with NaN are false, so NaN coordinates come out invalid too
+			const bool valid = zone.worldspace && (sphere ? zone.radius > 0.0f : (low.x <= high.x && low.y <= high.y && low.z <= high.z));
+			const auto first = CellOf(low);
+			const auto last  = CellOf(high);
+			if (!valid || static_cast<std::size_t>(last.x - first.x + 1) * static_cast<std::size_t>(last.y - first.y + 1) > maxCellsPerZone) {
+				_droppedZones++;
+				continue;
+			}
+
+			auto world = _worldIndex.Find(zone.worldspace);
+			if (!world) {
+				_worlds.emplace_back();
+				_worldIndex.Insert(zone.worldspace, static_cast<std::uint32_t>(_worlds.size()));
+				world = _worldIndex.Find(zone.worldspace);
+			}
+
+			const auto index = static_cast<std::uint32_t>(_zones.size());
+			// Range in the same units as Controller::Compile
+			_zones.push_back({ zone.shape, zone.center, zone.radius, low, high, zone.strength, zone.range * 10, std::max(zone.falloff, 0.0f), static_cast<std::uint32_t>(i) });
+
+			for (auto x = first.x; x <= last.x; x++) {
+				for (auto y = first.y; y <= last.y; y++) {
+					placements.push_back({ *world - 1, CellKey({ x, y }), index });
+				}
+			}
+		}
+
+		// Zone indices grow in settings order, so every bucket comes out in settings order too
+		const auto order = [](const Placement& a_placement) { return std::tuple(a_placement.world, a_placement.key, a_placement.zone); };
+		std::ranges::sort(placements, {}, order);
+
+		std::vector<std::size_t> buckets(_worlds.size(), 0);
+		for (std::size_t i = 0; i < placements.size(); i++) {
+			if (!i || placements[i].world != placements[i - 1].world || placements[i].key != placements[i - 1].key) buckets[placements[i].world]++;
+		}
+		for (std::size_t i = 0; i < _worlds.size(); i++) {
+			_worlds[i].Reserve(buckets[i]);
+			_cellCount += buckets[i];
+		}
+
+		_cellZones.reserve(placements.size());
+		for (std::size_t i = 0; i < placements.size();) {
+			const auto& head   = placements[i];
+			Bucket      bucket{ static_cast<std::uint32_t>(_cellZones.size()), 0 };
+			for (; i < placements.size() && placements[i].world == head.world && placements[i].key == head.key; i++) {
+				_cellZones.push_back(placements[i].zone);
+				bucket.count++;
+			}
+			_worlds[head.world].Insert(head.key, bucket);
+		}
+	}
+
+	std::span<const std::uint32_t> Grid::Candidates(std::uint32_t a_worldspace, CellCoord a_cell) const {
+		const auto world = _worldIndex.Find(a_worldspace);
+		if (!world) return {};
+
+		const auto bucket = _worlds[*world - 1].Find(CellKey(a_cell));
+		return bucket ? std::span(_cellZones).subspan(bucket->offset, bucket->count) : std::span<const std::uint32_t>{};
+	}
+
+	float Grid::Weight(const Compiled& a_zone, const Point& a_position) const {
+		float inside = 0.0f;  // Distance to the nearest edge, negative outside
+		if (a_zone.shape == Shape::kSphere) {
+			const float dx = a_position.x - a_zone.center.x;
+			const float dy = a_position.y - a_zone.center.y;
+			const float dz = a_position.z - a_zone.center.z;
+			inside         = a_zone.radius - std::sqrt(dx * dx + dy * dy + dz * dz);
+		} else {
+			inside = std::min({ a_position.x - a_zone.min.x, a_zone.max.x - a_position.x, a_position.y - a_zone.min.y, a_zone.max.y - a_position.y,
+				a_position.z - a_zone.min.z, a_zone.max.z - a_position.z });
+		}
+
+		if (!(inside >= 0.0f)) return 0.0f;
+		return a_zone.falloff > 0.0f ? std::min(inside / a_zone.falloff, 1.0f) : 1.0f;
+	}
+
+	Sample Grid::Evaluate(std::span<const std::uint32_t> a_candidates, const Point& a_position, bool* a_inFalloff) const {
+		Sample        sample;
+		std::uint32_t signature = 2166136261u;  // FNV-1a over the contributing zones
+		bool          any       = false;
+		bool          inFalloff = false;
+
+		// Last to first, so the first zone in the settings is applied last and has the final say
+		for (auto it = a_candidates.rbegin(); it != a_candidates.rend(); ++it) {
+			const auto& zone   = _zones[*it];
+			const float weight = Weight(zone, a_position);
+			if (weight <= 0.0f) continue;
+
+			sample.keep     *= 1.0f - weight;
+			sample.strength  = std::lerp(sample.strength, zone.strength, weight);
+			sample.range     = std::lerp(sample.range, zone.range, weight);
+			signature        = (signature ^ zone.id) * 16777619u;
+			any              = true;
+			inFalloff       |= weight < 1.0f;
+		}
+
+		if (any) sample.signature = signature ? signature : 1;
+		if (a_inFalloff) *a_inFalloff = inFalloff;
+		return sample;
+	}
+
+	bool Tracker::Update(const Grid& a_grid, std::uint32_t a_worldspace, const Point& a_position) {
+		const auto cell = Grid::CellOf(a_position);
+		if (!_valid || a_worldspace != _worldspace || cell != _cell) {
+			_candidates = a_grid.Candidates(a_worldspace, cell);
+			_worldspace = a_worldspace;
+			_cell       = cell;
+			_valid      = true;
+			_lookups++;
+		} else if (_candidates.empty()) {
+			return false;  // Same empty cell, which is most of the map
+		}
+
+		bool       inFalloff = false;
+		const auto sample    = _candidates.empty() ? Sample{} : a_grid.Evaluate(_candidates, a_position, &inFalloff);
+		_inFalloff           = inFalloff;
+		if (sample == _sample) return false;
+
+		_sample = sample;
+		return true;
+	}
+
+	void Tracker::Reset() {
+		_candidates = {};
+		_valid      = false;
+	}
+}
@@ -0,0 +1,91 @@
+#include "ContextRules.h"
+
+namespace Rules {
+
+	std::uint32_t DecisionTable::HourMask(std::uint8_t a_start, std::uint8_t a_end) {
+		a_start %= 24;
+		a_end   %= 24;
+		if (a_start == a_end) return allHours;
+
+		std::uint32_t mask = 0;
+		for (std::uint32_t hour = 0; hour < 24; hour++) {
+			const bool inside = a_start < a_end ? (hour >= a_start && hour < a_end) : (hour >= a_start || hour < a_end);
+			if (inside) mask |= 1u << hour;
+		}
+		return mask;
+	}
+
+	void DecisionTable::Compile(std::span<const RuleInput> a_rules) {
+		_rules.clear();
+		_rules.reserve(a_rules.size());
+		_keywordBits.Clear();
+		_keywordCount    = 0;
+		_droppedKeywords = 0;
+		_dependsOnHour   = false;
+
+		std::size_t keywordTotal = 0;
+		for (const auto& rule : a_rules) {
+			keywordTotal += rule.keywords.size();
+		}
+		_keywordBits.Reserve(keywordTotal);
+
+		for (const auto& rule : a_rules) {
+			if (!rule.enabled) continue;
+
+			CompiledRule compiled{};
+			compiled.weather      = rule.weather;
+			compiled.worldspace   = rule.worldspace;
+			compiled.hourMask     = HourMask(rule.hourStart, rule.hourEnd);
+			compiled.cellMask     = rule.cell == Cell::kInterior ? 0b10 : rule.cell == Cell::kExterior ? 0b01 : 0b11;
+			compiled.needsKeyword = !rule.keywords.empty();
+			compiled.source       = rule.source;
+			compiled.value        = { rule.strength, rule.range * 10, rule.staticToggle };  // Same units as Controller::Compile
+
+			for (const auto keyword : rule.keywords) {
+				if (const auto bit = _keywordBits.Find(keyword)) {
+					compiled.keywordMask |= 1ull << *bit;
+				} else if (_keywordCount < maxKeywords) {
+					_keywordBits.Insert(keyword, static_cast<std::uint8_t>(_keywordCount));
+					compiled.keywordMask |= 1ull << _keywordCount++;
+				} else {
+					_droppedKeywords++;
+				}
+			}
+
+			_dependsOnHour |= compiled.hourMask != allHours;
+			_rules.push_back(compiled);
+		}
+	}
+
+	std::uint64_t DecisionTable::KeywordMask(std::span<const std::uint32_t> a_keywords) const {
+		std::uint64_t mask = 0;
+		for (const auto keyword : a_keywords) {
+			if (const auto bit = _keywordBits.Find(keyword)) mask |= 1ull << *bit;
+		}
+		return mask;
+	}
+
+	const WeatherIndex::Entry* DecisionTable::Evaluate(const Context& a_context) const {
+		const std::uint64_t keywords = _keywordCount ? KeywordMask(a_context.keywords) : 0;
+		const std::uint8_t  cellBit  = a_context.interior ? 0b10 : 0b01;
+		const std::uint32_t hourBit  = 1u << (a_context.hour % 24);
+
+		for (const auto& rule : _rules) {
+			if (rule.weather && rule.weather != a_context.weather) continue;
+			if (!(rule.cellMask & cellBit)) continue;
+			if (rule.worldspace && rule.worldspace != a_context.worldspace) continue;
+			if (rule.needsKeyword && !(rule.keywordMask & keywords)) continue;
+			if (!(rule.hourMask & hourBit)) continue;
+			return &rule.value;
+		}
+		return nullptr;
+	}
+
+	std::int32_t DecisionTable::SourceOf(const WeatherIndex::Entry* a_value) const {
+		if (!a_value) return -1;
+		for (const auto& rule : _rules) {
+			if (&rule.value == a_value) return static_cast<std::int32_t>(rule.source);
+		}
+		return -1;
+	}
+}
@@ -1,174 +1,622 @@
-#include "PCH.h"
-#include "Hooks.h"
-#include "MCP.h"
-#include "Utils.h"
-
-namespace Hooks {
-
-    void InstallHooks() {
-		if (BlurManager::GetSingleton().Initialize()) {
-			UpdateHook::Install();
-			Logger::info("Hooks installed successfully.");
-		} else {
-			Logger::critical("Failed to initialize BlurManager. Hooks will not be installed.");
-		}
-	}
-
-
-	void UpdateHook::Install() {
-		REL::Relocation<std::uintptr_t> playerVtbl{ RE::VTABLE_PlayerCharacter[0] };
-		Update_ = playerVtbl.write_vfunc(0xAD, Update);
-		Logger::info("Player update hook installed.");
-	}
-
-	void UpdateHook::Update(RE::Actor* a_this, float a_delta) {
-		Update_(a_this, a_delta);
-		BlurManager::GetSingleton().OnPlayerUpdate(a_delta);
-	}
-
-
-	bool BlurManager::Initialize() {
-		if (!_sourceIMod) {
-			Utils::CountAndCacheForms<RE::TESImageSpaceModifier>();
-			if (!_sourceIMod) {
-				Logger::error("BlurManager: sourceIMod is null. Cannot create runtime IMOD.");
-				return false;
-			}
-		}
-
-		const auto factory = RE::IFormFactory::GetConcreteFormFactoryByType<RE::TESImageSpaceModifier>();
-		_imod = factory ? factory->Create() : nullptr;
-
-		if (!Utils::ValidateForm(_imod, RE::FormType::ImageAdapter)) {
-			Logger::error("BlurManager: Failed to create TESImageSpaceModifier form.");
-			return false;
-		}
-
-		CopyIMODData(_sourceIMod, _imod);
-		_imod->SetFormEditorID("DistantBlurIMOD");
-
-		auto dataHandler = RE::TESDataHandler::GetSingleton();
-		dataHandler->GetFormArray<RE::TESImageSpaceModifier>().push_back(_imod);
-
-        Logger::info("Runtime IMOD '{}' created successfully.", clib_util::editorID::get_editorID(_imod));
-		return true;
-	}
-
-    void BlurManager::OnPlayerUpdate(float a_delta) {
-        if (!_imod) return;
-
-        // 0 = None, 1 = Advanced
-        if (!Settings::general.BlurType) {
-            // ========================================================
-            // MODE: NONE (Disable Blur)
-            // ========================================================
-            if (_currentTargetStrength != 0.0f) {
-                _currentTargetStrength  = 0.0f;
-                _currentTargetRange     = 0.0f;
-                _useStaticTransition    = false; // Fade out nicely
-                Logger::trace("Mode is None: Removing blur.");
-            }
-        } else {
-            // ========================================================
-            // MODE: ADVANCED (Weather Table)
-            // ========================================================
-            auto newWeather       = RE::Sky::GetSingleton()->currentWeather;
-            bool isWeatherChanged = (newWeather != _currentWeather || _settingsDirty);
-        
-            if (isWeatherChanged) {
-                _currentWeather   = newWeather;
-                auto  weatherID   = Utils::GetCurrentWeather(); // I might have to tweak this function later so I can use it for both "newWeather" above and prevWeatherID below.
-                auto& settings    = MCP::Advanced::g_advancedWeatherData.settings;
-                auto  it          = std::find_if(settings.begin(), settings.end(), [&](const auto& setting) {
-                    return setting.rowToggle && setting.rowWeatherType == weatherID;
-                });
-        
-                if (it != settings.end()) {
-                    Logger::trace("Advanced Mode: Weather changed to '{}', applying blur.", weatherID);
-                    _currentTargetStrength = it->rowBlurStrength;
-                    _currentTargetRange    = it->rowBlurRange * 10;
-                    _useStaticTransition   = it->rowStaticToggle;
-                } else {
-                    Logger::trace("Advanced Mode: Weather changed to '{}', removing blur.", weatherID);
-                    _currentTargetStrength = 0.0f;
-                    _currentTargetRange    = 0.0f;
-        
-                    // Check PREVIOUS weather to decide how we transition OUT
-					// There's probably a cleaner way to do this but for now this works.
-                    auto prevWeatherID = Utils::GetPreviousWeather();
-                    auto it_old        = std::find_if(settings.begin(), settings.end(), [&](const auto& setting) {
-                        return setting.rowToggle && setting.rowWeatherType == prevWeatherID;
-                    });
-        
-                    if (it_old != settings.end()) {
-                        _useStaticTransition = it_old->rowStaticToggle;
-                    } else {
-                        _useStaticTransition = false; // Default to smooth fade out
-                    }
-                }
-            }
-        }
-
-        if (_settingsDirty) _settingsDirty = false;
-
-        float nextStrength = _currentAppliedStrength;
-        float nextRange    = _currentAppliedRange;
-
-        if (_useStaticTransition) {
-            nextStrength   = _currentTargetStrength;
-            nextRange      = _currentTargetRange;
-        } else {
-            if (std::abs(_currentAppliedStrength - _currentTargetStrength) > 0.001f) {
-                const float transitionSpeed = 0.5f;
-                float       blendFactor     = 1.0f - powf(1.0f - transitionSpeed, a_delta);
-
-                nextStrength = std::lerp(_currentAppliedStrength, _currentTargetStrength, blendFactor);
-                nextRange    = std::lerp(_currentAppliedRange, _currentTargetRange, blendFactor);
-            } else {
-                nextStrength = _currentTargetStrength;
-                nextRange    = _currentTargetRange;
-            }
-        }
-
-        bool strengthChanged = (nextStrength != _currentAppliedStrength);
-        bool rangeChanged    = (nextRange    != _currentAppliedRange);
-
-        if (strengthChanged || rangeChanged) {
-            _currentAppliedStrength = nextStrength;
-            _currentAppliedRange    = nextRange;
-
-            if (_currentAppliedStrength > 0.0f) {
-                _imod->dof.strength->floatValue = _currentAppliedStrength;
-                _imod->dof.range->floatValue    = _currentAppliedRange;
-
-                Logger::trace("DOF updated: Str {}, Rng {}", _currentAppliedStrength, _currentAppliedRange);
-
-                if (!_effectIsActive) {
-                    _imodInstance   = RE::ImageSpaceModifierInstanceForm::Trigger(_imod, 1.0, nullptr);
-                    _effectIsActive = true;
-                    Logger::debug("Blur effect triggered.");
-                }
-            }
-        }
-
-        if (_currentAppliedStrength <= 0.0f && _effectIsActive) {
-            RE::ImageSpaceModifierInstanceForm::Stop(_imod);
-            _imodInstance   = nullptr;
-            _effectIsActive = false;
-            Logger::debug("Blur effect stopped.");
-        }
-    }
-
-	void BlurManager::CopyIMODData(RE::TESImageSpaceModifier* a_source, RE::TESImageSpaceModifier* a_dest) {
-		a_dest->formFlags            = a_source->formFlags;
-		a_dest->formType             = a_source->formType;
-		a_dest->bloom                = a_source->bloom;
-		a_dest->cinematic            = a_source->cinematic;
-		a_dest->hdr                  = a_source->hdr;
-		a_dest->radialBlur           = a_source->radialBlur;
-		a_dest->dof                  = a_source->dof;
-		a_dest->doubleVisionStrength = a_source->doubleVisionStrength;
-		a_dest->fadeColor            = a_source->fadeColor;
-		a_dest->tintColor            = a_source->tintColor;
-	}
+#include "PCH.h"
+#include "Hooks.h"
+#include "Logger.h"
+#include "MCP.h"
+#include "Metrics.h"
+#include "Telemetry.h"
+#include "Utils.h"
+
+namespace Hooks {
+
+    namespace {
+        LPTOP_LEVEL_EXCEPTION_FILTER previousCrashFilter = nullptr;
+        std::wstring                 crashTraceFile;  // Converted up front, the filter cannot allocate
+
+        // Leaves the frames that led up to a crash next to the settings, then lets the crash loggers do their thing.
+        // Nothing is written unless the frame recorder is on, the game thread only prepares the trace then.
+        LONG WINAPI DumpTraceOnCrash(EXCEPTION_POINTERS* a_info) {
+            static std::atomic_flag dumped;
+            if (!dumped.test_and_set()) {
+                BlurManager::GetSingleton().DumpCrashTrace(crashTraceFile.c_str());
+            }
+            return previousCrashFilter ? previousCrashFilter(a_info) : EXCEPTION_CONTINUE_SEARCH;
+        }
+
+        AutoBlur::WeatherTraits TraitsOf(const RE::TESWeather* a_weather) {
+            const auto& fog = a_weather->fogData;
+            return { a_weather->GetFormID(), fog.dayNear, fog.dayFar, fog.nightNear, fog.nightFar,
+                static_cast<std::uint8_t>(a_weather->data.flags.underlying()), a_weather->precipitationData != nullptr };
+        }
+
+        // Where each Imod::Channel lives on an IMOD, nullptr if the interpolator is missing. Colors are split per component.
+        float* ChannelSlot(RE::TESImageSpaceModifier* a_imod, Imod::Channel a_channel) {
+            const auto scalar = [](RE::NiFloatInterpolator* a_interpolator) { return a_interpolator ? &a_interpolator->floatValue : nullptr; };
+            const auto color  = [](RE::NiColorInterpolator* a_interpolator, float RE::NiColorA::*a_component) {
+                return a_interpolator ? &(a_interpolator->colorValue.*a_component) : nullptr;
+            };
+
+            switch (a_channel) {
+                case Imod::kDOFStrength:         return scalar(a_imod->dof.strength);
+                case Imod::kDOFRange:            return scalar(a_imod->dof.range);
+                case Imod::kBloomBlurRadius:     return scalar(a_imod->bloom.blurRadius);
+                case Imod::kCinematicSaturation: return scalar(a_imod->cinematic.saturationMult);
+                case Imod::kCinematicBrightness: return scalar(a_imod->cinematic.brightnessMult);
+                case Imod::kCinematicContrast:   return scalar(a_imod->cinematic.contrastMult);
+                case Imod::kHDREyeAdaptSpeed:    return scalar(a_imod->hdr.eyeAdaptSpeedMult);
+                case Imod::kRadialBlurStrength:  return scalar(a_imod->radialBlur.strength);
+                case Imod::kTintRed:             return color(a_imod->tintColor, &RE::NiColorA::red);
+                case Imod::kTintGreen:           return color(a_imod->tintColor, &RE::NiColorA::green);
+                case Imod::kTintBlue:            return color(a_imod->tintColor, &RE::NiColorA::blue);
+                case Imod::kTintAlpha:           return color(a_imod->tintColor, &RE::NiColorA::alpha);
+                case Imod::kFadeRed:             return color(a_imod->fadeColor, &RE::NiColorA::red);
+                case Imod::kFadeGreen:           return color(a_imod->fadeColor, &RE::NiColorA::green);
+                case Imod::kFadeBlue:            return color(a_imod->fadeColor, &RE::NiColorA::blue);
+                case Imod::kFadeAlpha:           return color(a_imod->fadeColor, &RE::NiColorA::alpha);
+                default:                         return nullptr;
+            }
+        }
+
+        // The weather cache is sorted by editorID, so each row resolves with a binary search.
+        void ResolveRows(const std::vector<MCP::Advanced::WeatherSettingRow>& a_settings, Published::Tables& a_tables) {
+            const auto& weathers = Utils::g_formCache<RE::TESWeather>;
+
+            // Sized up front, the rows' spans point into these
+            std::size_t keyframeCount = 0;
+            std::size_t channelCount  = 0;
+            for (const auto& row : a_settings) {
+                keyframeCount += row.rowCurve.size();
+                channelCount  += row.rowChannels.size();
+            }
+            a_tables.keyframes.reserve(keyframeCount);
+            a_tables.channels.reserve(channelCount);
+            a_tables.rows.reserve(a_settings.size());
+            a_tables.authoredRows = a_settings.size();
+
+            for (const auto& row : a_settings) {
+                // "None" is FormID 0 and matches while the sky has no weather, anything else must be loaded
+                const bool none    = row.rowWeatherType == "None";
+                const auto weather = none ? nullptr : weathers.Find(row.rowWeatherType);
+                if (!none && !weather) continue;
+
+                a_tables.keyframes.insert(a_tables.keyframes.end(), row.rowCurve.begin(), row.rowCurve.end());
+                a_tables.channels.insert(a_tables.channels.end(), row.rowChannels.begin(), row.rowChannels.end());
+                a_tables.rows.push_back({ weather ? weather->formID : 0, row.rowToggle, row.rowBlurStrength, row.rowBlurRange, row.rowStaticToggle,
+                    row.rowDuration, row.rowEasing, std::span(a_tables.keyframes).last(row.rowCurve.size()), std::span(a_tables.channels).last(row.rowChannels.size()) });
+            }
+        }
+
+        // Worldspaces and keywords resolve through their form caches as well, never through the game's editorID map,
+        // which is not safe to read from the reload watcher's thread
+        void ResolveRules(const std::vector<MCP::Advanced::ContextRuleRow>& a_rules, Published::Tables& a_tables) {
+            const auto& weathers    = Utils::g_formCache<RE::TESWeather>;
+            const auto& worldspaces = Utils::g_formCache<RE::TESWorldSpace>;
+            const auto& keywords    = Utils::g_formCache<RE::BGSKeyword>;
+            const auto  isAny    = [](const std::string& a_name) { return a_name.empty() || a_name == "Any"; };
+
+            a_tables.rules.reserve(a_rules.size());
+            a_tables.authoredRules = a_rules.size();
+
+            // A rule naming a form that is not loaded can never match, so it is dropped instead of widened to "Any".
+            for (std::size_t i = 0; i < a_rules.size(); i++) {
+                const auto&      rule = a_rules[i];
+                Rules::RuleInput input;
+                input.enabled      = rule.ruleToggle;
+                input.cell         = static_cast<Rules::Cell>(std::clamp(rule.ruleCell, 0, 2));
+                input.hourStart    = static_cast<std::uint8_t>(std::clamp(rule.ruleHourStart, 0, 24));
+                input.hourEnd      = static_cast<std::uint8_t>(std::clamp(rule.ruleHourEnd, 0, 24));
+                input.strength     = rule.ruleBlurStrength;
+                input.range        = rule.ruleBlurRange;
+                input.staticToggle = rule.ruleStaticToggle;
+                input.source       = static_cast<std::uint32_t>(i);
+
+                if (!isAny(rule.ruleWeatherType)) {
+                    const auto weather = weathers.Find(rule.ruleWeatherType);
+                    if (!weather || !weather->form) {
+                        LOG_DEBUG(Log::kHooks, "BlurManager: Context rule {} skipped, weather '{}' is not loaded.", i, rule.ruleWeatherType);
+                        continue;
+                    }
+                    input.weather = weather->formID;
+                }
+
+                if (!isAny(rule.ruleWorldspace)) {
+                    const auto worldspace = worldspaces.Find(rule.ruleWorldspace);
+                    if (!worldspace || !worldspace->form) {
+                        LOG_DEBUG(Log::kHooks, "BlurManager: Context rule {} skipped, worldspace '{}' is not loaded.", i, rule.ruleWorldspace);
+                        continue;
+                    }
+                    input.worldspace = worldspace->formID;
+                }
+
+                for (const auto& keywordName : rule.ruleKeywords) {
+                    if (const auto keyword = keywords.Find(keywordName); keyword && keyword->form) {
+                        input.keywords.push_back(keyword->formID);
+                    } else {
+                        LOG_DEBUG(Log::kHooks, "BlurManager: Context rule {} ignores unknown keyword '{}'.", i, keywordName);
+                    }
+                }
+                if (!rule.ruleKeywords.empty() && input.keywords.empty()) {
+                    LOG_DEBUG(Log::kHooks, "BlurManager: Context rule {} skipped, none of its keywords are loaded.", i);
+                    continue;
+                }
+
+                a_tables.rules.push_back(std::move(input));
+            }
+        }
+
+        void ResolveZones(const std::vector<MCP::Advanced::BlurZoneRow>& a_zones, Published::Tables& a_tables) {
+            const auto& worldspaces = Utils::g_formCache<RE::TESWorldSpace>;
+            const auto  point       = [](const std::array<float, 3>& a_point) { return Zones::Point{ a_point[0], a_point[1], a_point[2] }; };
+
+            a_tables.zones.reserve(a_zones.size());
+            a_tables.authoredZones = a_zones.size();
+
+            for (std::size_t i = 0; i < a_zones.size(); i++) {
+                const auto& zone       = a_zones[i];
+                const auto  worldspace = worldspaces.Find(zone.zoneWorldspace);
+                if (!worldspace || !worldspace->form) {
+                    LOG_DEBUG(Log::kHooks, "BlurManager: Blur zone {} skipped, worldspace '{}' is not loaded.", i, zone.zoneWorldspace);
+                    continue;
+                }
+
+                a_tables.zones.push_back({ zone.zoneToggle, worldspace->formID, zone.zoneShape == 1 ? Zones::Shape::kBox : Zones::Shape::kSphere,
+                    point(zone.zoneCenter), zone.zoneRadius, point(zone.zoneMin), point(zone.zoneMax), zone.zoneBlurStrength, zone.zoneBlurRange, zone.zoneFalloff });
+            }
+        }
+    }
+
+    void InstallHooks() {
+		if (BlurManager::GetSingleton().Initialize()) {
+			BlurManager::GetSingleton().RegisterEvents();
+			UpdateHook::Install();
+			crashTraceFile      = std::filesystem::path(Settings::crashTracePath).wstring();
+			previousCrashFilter = ::SetUnhandledExceptionFilter(DumpTraceOnCrash);
+			Logger::info("Hooks installed successfully.");
+		} else {
+			Logger::critical("Failed to initialize BlurManager. Hooks will not be installed.");
+		}
+	}
+
+
+	void UpdateHook::Install() {
+		REL::Relocation<std::uintptr_t> playerVtbl{ RE::VTABLE_PlayerCharacter[0] };
+		Update_ = playerVtbl.write_vfunc(0xAD, Update);
+		Logger::info("Player update hook installed.");
+	}
+
+	void UpdateHook::Update(RE::Actor* a_this, float a_delta) {
+		Update_(a_this, a_delta);
+
+		auto& manager = BlurManager::GetSingleton();
+		if (!manager.ShouldUpdate(a_delta)) return;
+
+		Metrics::ScopedUpdateTimer timer;
+		manager.OnPlayerUpdate(a_delta);
+	}
+
+
+	bool BlurManager::Initialize() {
+		if (!_sourceIMod) {
+			Utils::CountAndCacheForms<RE::TESImageSpaceModifier>();
+			if (!_sourceIMod) {
+				Logger::error("BlurManager: sourceIMod is null. Cannot create runtime IMOD.");
+				return false;
+			}
+		}
+
+		const auto factory = RE::IFormFactory::GetConcreteFormFactoryByType<RE::TESImageSpaceModifier>();
+		_imod = factory ? factory->Create() : nullptr;
+
+		if (!Utils::ValidateForm(_imod, RE::FormType::ImageAdapter)) {
+			Logger::error("BlurManager: Failed to create TESImageSpaceModifier form.");
+			return false;
+		}
+
+		CopyIMODData(_sourceIMod, _imod);
+		_imod->SetFormEditorID("DistantBlurIMOD");
+
+		// Channels a row does not set rest at whatever the source IMAD holds
+		Imod::Values baseline{};
+		for (std::uint32_t i = 0; i < Imod::kChannelCount; i++) {
+			const auto slot = ChannelSlot(_imod, static_cast<Imod::Channel>(i));
+			baseline[i]     = slot ? *slot : 0.0f;
+		}
+		_controller.SetBaseline(baseline);
+		LoadWeatherTraits();
+
+		{
+			std::scoped_lock lock(MCP::Advanced::g_advancedWeatherData.lock);
+			PublishSettings(nullptr);
+		}
+
+		auto dataHandler = RE::TESDataHandler::GetSingleton();
+		dataHandler->GetFormArray<RE::TESImageSpaceModifier>().push_back(_imod);
+
+        Logger::info("Runtime IMOD '{}' created successfully.", clib_util::editorID::get_editorID(_imod));
+		return true;
+	}
+
+	void BlurManager::LoadWeatherTraits() {
+		const auto start = std::chrono::steady_clock::now();
+
+		// Every weather record, not just the ones with an editorID in the form cache
+		const auto& weathers = RE::TESDataHandler::GetSingleton()->GetFormArray<RE::TESWeather>();
+		_weatherTraits.clear();
+		_weatherTraits.reserve(weathers.size());
+		for (const auto weather : weathers) {
+			if (weather) _weatherTraits.push_back(TraitsOf(weather));
+		}
+
+		RebuildAutomatic();
+		Logger::info("BlurManager: Read {} weathers for automatic mode in {:.2f} ms.", _weatherTraits.size(),
+			std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	void BlurManager::RebuildAutomatic() {
+		_automaticTuning = Settings::general.Automatic;
+		_automatic       = AutoBlur::Build(_weatherTraits, _automaticTuning);
+		_controller.SetAutomatic(_automatic);
+		_crashFileStale  = true;
+		LOG_DEBUG(Log::kHooks, "BlurManager: Derived automatic blur for {} of {} weathers.", _automatic.size(), _weatherTraits.size());
+	}
+
+	void BlurManager::RegisterEvents() {
+		if (const auto ui = RE::UI::GetSingleton()) {
+			ui->AddEventSink<RE::MenuOpenCloseEvent>(this);
+		}
+		if (const auto player = RE::PlayerCharacter::GetSingleton()) {
+			player->AsBGSActorCellEventSource()->AddEventSink<RE::BGSActorCellEvent>(this);
+		}
+		Logger::info("BlurManager: Registered menu and cell event sinks.");
+	}
+
+	RE::BSEventNotifyControl BlurManager::ProcessEvent(const RE::MenuOpenCloseEvent* a_event, RE::BSTEventSource<RE::MenuOpenCloseEvent>*) {
+		if (!a_event) return RE::BSEventNotifyControl::kContinue;
+
+		// Remember which menus suspended us, the menu itself may already be gone by the time it reports closing
+		const auto it = std::ranges::find(_suspendingMenus, a_event->menuName);
+		if (a_event->opening) {
+			const auto ui   = RE::UI::GetSingleton();
+			const auto menu = ui ? ui->GetMenu(a_event->menuName.c_str()) : nullptr;
+			const bool suspends = a_event->menuName == RE::LoadingMenu::MENU_NAME || (menu && menu->PausesGame());
+			if (suspends && it == _suspendingMenus.end()) _suspendingMenus.push_back(a_event->menuName);
+		} else if (it != _suspendingMenus.end()) {
+			_suspendingMenus.erase(it);
+		}
+
+		if (_suspendingMenus.empty()) {
+			_state.fetch_and(~static_cast<std::uint32_t>(kSuspended), std::memory_order_relaxed);
+			Wake(kWakeMenu);  // The weather or cell may have changed behind the menu
+		} else {
+			_state.fetch_or(kSuspended, std::memory_order_relaxed);
+		}
+		return RE::BSEventNotifyControl::kContinue;
+	}
+
+	RE::BSEventNotifyControl BlurManager::ProcessEvent(const RE::BGSActorCellEvent* a_event, RE::BSTEventSource<RE::BGSActorCellEvent>*) {
+		if (a_event && a_event->flags == RE::BGSActorCellEvent::CellFlag::kEnter) {
+			Wake(kWakeCell);
+		}
+		return RE::BSEventNotifyControl::kContinue;
+	}
+
+    void BlurManager::OnPlayerUpdate(float a_delta) {
+        if (!_imod) return;
+
+        // Consume the wake reasons up front, anything raised while this update runs keeps us awake for the next one
+        const auto reasons = _state.fetch_and(~static_cast<std::uint32_t>(kWakeMask), std::memory_order_relaxed) & kWakeMask;
+        _idleTime          = 0.0f;
+        LOG_TRACE(Log::kHooks, "BlurManager: Update woken by {:04X}.", reasons);
+
+        // INI only, edited rows arrive through _published
+        if (Settings::ApplyPendingReload() && Settings::general.Automatic != _automaticTuning) {
+            RebuildAutomatic();
+        }
+
+        if (_published.Epoch() != _compiledEpoch) {
+            CompilePublished();
+        }
+        UpdateRuleContext();
+        UpdateZone();
+
+        // 0 = None, 1 = Advanced, 2 = Automatic
+        const auto mode      = static_cast<Blur::Mode>(Settings::general.BlurType);
+        const bool recording = Settings::general.FrameRecorder;
+        Telemetry::SetEnabled(Settings::general.Telemetry);
+        const auto telemetry = Telemetry::Get();
+        const bool timed     = recording || telemetry;
+        const bool alive     = recording && IsInstanceAlive();
+        const auto start     = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+        const auto events    = _controller.Update(a_delta, mode, *this, *this);
+        const auto cost      = timed ? std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() : 0;
+
+        if (recording) {
+            _recorder.Push(Trace::Capture(_controller, a_delta, *this, alive, events, static_cast<std::uint32_t>(_compiledEpoch), cost));
+
+            // Everything but the frames is encoded here, so a crash only has to copy the ring in
+            if (_crashFileStale || !_crashFile.IsArmed()) {
+                if (const auto tables = _published.Read(kGameThreadReader)) {
+                    _crashFile.Prepare(*tables, _automatic, static_cast<std::uint32_t>(tables.Epoch()));
+                    _crashFileStale = false;
+                }
+            }
+        } else if (_crashFile.IsArmed()) {
+            _crashFile.Disarm();
+        }
+        if (reasons & kWakeTrace) {
+            DumpTrace(Settings::frameTracePath);
+        }
+
+        if (!_controller.IsSettled()) {
+            Wake(kWakeTransition);
+        }
+
+        if (events != Blur::kNoEvent) {
+            CountEvents(events);
+        }
+
+        // After the counters, so a reader sees them agree with the events of the same update
+        if (telemetry) {
+            auto snapshot  = Telemetry::Capture(_controller, events, _activeRule, static_cast<std::uint64_t>(cost));
+            snapshot.frame = ++_telemetryFrame;
+            for (std::size_t i = 0; i < Telemetry::counterCount; i++) {
+                snapshot.counters[i] = Metrics::Get(static_cast<Metrics::Counter>(i));
+            }
+            Telemetry::Publish(*telemetry, snapshot);
+        }
+    }
+
+    void BlurManager::CountEvents(std::uint32_t a_events) {
+        if (a_events & Blur::kWeatherChanged) {
+            Metrics::Increment(Metrics::Counter::kWeatherChanges);
+            LOG_TRACE(Log::kHooks, "Weather changed to {:08X}, target Str {}, Rng {}.",
+                _controller.GetCurrentWeather(), _controller.GetTargetStrength(), _controller.GetTargetRange());
+        }
+        if (a_events & Blur::kDOFWritten)      Metrics::Increment(Metrics::Counter::kDOFWrites);
+        if (a_events & Blur::kChannelsWritten) Metrics::Increment(Metrics::Counter::kChannelWrites);
+        if (a_events & Blur::kTriggered)       Metrics::Increment(Metrics::Counter::kTriggers);
+        if (a_events & Blur::kRetriggered)     Metrics::Increment(Metrics::Counter::kRetriggers);
+        if (a_events & Blur::kStopped)         Metrics::Increment(Metrics::Counter::kStops);
+        if (a_events & Blur::kParked)          Metrics::Increment(Metrics::Counter::kParks);
+        if (a_events & Blur::kUnparked)        Metrics::Increment(Metrics::Counter::kUnparks);
+        if (a_events & Blur::kRetriggered) {
+            Logger::info("BlurManager: The engine dropped the blur instance, triggered a new one.");
+        }
+    }
+
+    bool BlurManager::DumpTrace(const std::string& a_path) {
+        const auto frames = _recorder.Frames();
+        if (frames.empty()) {
+            Logger::warn("BlurManager: No frames to dump, the frame recorder is off or has not seen an update yet.");
+            return false;
+        }
+
+        const auto tables = _published.Read(kGameThreadReader);
+        if (!tables) return false;
+
+        if (!Utils::WriteFileAtomic(a_path, Trace::Encode(frames, *tables, _automatic, static_cast<std::uint32_t>(tables.Epoch())))) {
+            Logger::error("BlurManager: Failed to write the frame trace to '{}'.", a_path);
+            return false;
+        }
+        Logger::info("BlurManager: Wrote {} frames and {} weather rows to '{}'.", frames.size(), tables->rows.size(), a_path);
+        return true;
+    }
+
+    void BlurManager::DumpCrashTrace(const wchar_t* a_path) {
+        const auto trace = _crashFile.Fill(_recorder);
+        if (trace.empty()) return;
+
+        // No temp file and rename, a half-written trace is still worth more than none here
+        const auto file = ::CreateFileW(a_path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+
+        DWORD written = 0;
+        ::WriteFile(file, trace.data(), static_cast<DWORD>(trace.size()), &written, nullptr);
+        ::CloseHandle(file);
+    }
+
+    std::uint32_t BlurManager::GetCurrentWeather() const {
+        const auto sky     = RE::Sky::GetSingleton();
+        const auto weather = sky ? sky->currentWeather : nullptr;
+        return weather ? weather->GetFormID() : 0;
+    }
+
+    std::uint32_t BlurManager::GetPreviousWeather() const {
+        const auto sky     = RE::Sky::GetSingleton();
+        const auto weather = sky ? sky->lastWeather : nullptr;
+        return weather ? weather->GetFormID() : 0;
+    }
+
+    float BlurManager::GetGameHour() const {
+        const auto calendar = RE::Calendar::GetSingleton();
+        return calendar ? calendar->GetHour() : 0.0f;
+    }
+
+    void BlurManager::SetChannels(std::uint32_t a_mask, const Imod::Values& a_values) {
+        for (auto mask = a_mask; mask; mask &= mask - 1) {
+            const auto channel = static_cast<Imod::Channel>(std::countr_zero(mask));
+            if (const auto slot = ChannelSlot(_imod, channel)) {
+                *slot = a_values[channel];
+            }
+        }
+
+        LOG_TRACE(Log::kHooks, "IMOD channels {:04X} updated: Str {}, Rng {}", a_mask, a_values[Imod::kDOFStrength], a_values[Imod::kDOFRange]);
+    }
+
+    void BlurManager::Trigger() {
+        _imodInstance.reset(RE::ImageSpaceModifierInstanceForm::Trigger(_imod, 1.0, nullptr));
+        LOG_DEBUG(Log::kHooks, "Blur effect triggered.");
+    }
+
+    void BlurManager::Stop() {
+        RE::ImageSpaceModifierInstanceForm::Stop(_imod);
+        _imodInstance.reset();
+        LOG_DEBUG(Log::kHooks, "Blur effect stopped.");
+    }
+
+    bool BlurManager::IsInstanceAlive() const {
+        // Our reference keeps the object valid to ask, the engine marks it expired when it stops applying it
+        return _imodInstance && !_imodInstance->IsExpired();
+    }
+
+	void BlurManager::PublishSettings(const Settings::RowDiff* a_diff) {
+		const auto& state = MCP::Advanced::g_advancedWeatherData;
+
+		// Names resolve here, on the editing thread, so the game thread only compiles FormIDs. Only the form caches
+		// are read, they are filled once at kDataLoaded and never change afterwards.
+		Published::Tables tables;
+		ResolveRows(state.settings, tables);
+		ResolveRules(state.rules, tables);
+		ResolveZones(state.zones, tables);
+
+		if (a_diff) {
+			const auto& weathers = Utils::g_formCache<RE::TESWeather>;
+			tables.rowsChanged   = false;
+			tables.rulesChanged  = a_diff->rulesChanged;
+			tables.zonesChanged  = a_diff->zonesChanged;
+			for (const auto& name : a_diff->changedWeathers) {
+				if (name == "None") {
+					tables.changedWeathers.push_back(0);
+				} else if (const auto weather = weathers.Find(name)) {
+					tables.changedWeathers.push_back(weather->formID);
+				}
+			}
+		}
+
+		const auto rowCount  = tables.rows.size();
+		const auto ruleCount = tables.rules.size();
+		const auto zoneCount = tables.zones.size();
+		const auto epoch     = _published.Publish(std::move(tables));
+		Wake(kWakeSettings);
+
+		LOG_DEBUG(Log::kHooks, "BlurManager: Published settings epoch {} with {} of {} weather rows, {} of {} context rules and {} of {} blur zones.",
+			epoch, rowCount, state.settings.size(), ruleCount, state.rules.size(), zoneCount, state.zones.size());
+	}
+
+	void BlurManager::CompilePublished() {
+		const auto tables = _published.Read(kGameThreadReader);
+		if (!tables) return;
+
+		// The change list only describes the step from the previous epoch, after a skipped one everything is recompiled
+		const bool  contiguous  = tables.Epoch() == _compiledEpoch + 1;
+		const bool  rowsChanged = !contiguous || tables->rowsChanged;
+		const auto& changed     = tables->changedWeathers;
+
+		if (rowsChanged || !changed.empty()) {
+			// Only an edit to the weather on screen restarts the selection, anything else is swapped into the index quietly.
+			const bool reselect = rowsChanged || std::ranges::find(changed, _controller.GetCurrentWeather()) != changed.end();
+			_controller.Compile(tables->rows, reselect);
+			LOG_DEBUG(Log::kHooks, "BlurManager: Compiled {} of {} weather rows into the lookup index, active weather {}.",
+				_controller.GetIndexSize(), tables->authoredRows, reselect ? "reselected" : "untouched");
+		}
+
+		// The override only changes if the rule matching the current context did, see Controller::SetOverride.
+		if (!contiguous || tables->rulesChanged) {
+			_rules.Compile(tables->rules);
+			_contextDirty = true;
+
+			if (_rules.DroppedKeywords()) {
+				Logger::warn("BlurManager: {} location keywords exceed the {} keyword limit of the context rules and will never match.",
+					_rules.DroppedKeywords(), Rules::DecisionTable::maxKeywords);
+			}
+			LOG_DEBUG(Log::kHooks, "BlurManager: Compiled {} of {} context rules.", _rules.Size(), tables->authoredRules);
+		}
+
+		// The tracker holds candidates from the old grid, so it looks the player's cell up again
+		if (!contiguous || tables->zonesChanged) {
+			_zoneGrid.Compile(tables->zones);
+			_zoneTracker.Reset();
+
+			if (_zoneGrid.DroppedZones()) {
+				Logger::warn("BlurManager: {} blur zones have no size or cover more than {} grid cells and were dropped.", _zoneGrid.DroppedZones(),
+					Zones::Grid::maxCellsPerZone);
+			}
+			LOG_DEBUG(Log::kHooks, "BlurManager: Compiled {} of {} blur zones into {} grid cells.", _zoneGrid.Size(), tables->authoredZones, _zoneGrid.CellCount());
+		}
+
+		_compiledEpoch  = tables.Epoch();
+		_crashFileStale = true;
+	}
+
+	void BlurManager::UpdateRuleContext() {
+		if (_rules.Empty()) {
+			_controller.SetOverride(nullptr);
+			_activeRule = -1;
+			return;
+		}
+
+		const auto player       = RE::PlayerCharacter::GetSingleton();
+		const auto cell         = player ? player->GetParentCell() : nullptr;
+		const bool interior     = cell && cell->IsInteriorCell();
+		const auto worldspace   = player ? player->GetWorldspace() : nullptr;
+		const auto worldspaceID = worldspace ? worldspace->GetFormID() : 0;
+		const auto location     = player && _rules.DependsOnLocation() ? player->GetCurrentLocation() : nullptr;
+		const auto weather      = GetCurrentWeather();
+		const auto calendar     = _rules.DependsOnHour() ? RE::Calendar::GetSingleton() : nullptr;
+		const auto hour         = calendar ? static_cast<std::uint32_t>(calendar->GetHour()) % 24 : 0;
+
+		if (!_contextDirty && interior == _lastCellWasInterior && worldspaceID == _lastWorldspace &&
+			location == _lastLocation && weather == _lastRuleWeather && hour == _lastHour) {
+			return;
+		}
+
+		if (_contextDirty || location != _lastLocation) {
+			_locationKeywords.clear();
+
+			// Parent locations count too, so a rule on LocTypeHold matches anywhere inside the hold.
+			std::size_t depth = 0;
+			for (auto current = location; current && depth < 8; current = current->parentLoc, depth++) {
+				for (std::uint32_t i = 0; i < current->numKeywords; i++) {
+					if (const auto keyword = current->keywords[i]) _locationKeywords.push_back(keyword->GetFormID());
+				}
+			}
+		}
+
+		_lastCellWasInterior = interior;
+		_lastWorldspace      = worldspaceID;
+		_lastLocation        = location;
+		_lastRuleWeather     = weather;
+		_lastHour            = hour;
+		_contextDirty        = false;
+
+		const auto match = _rules.Evaluate({ weather, interior, worldspaceID, _locationKeywords, hour });
+		_controller.SetOverride(match);
+		_activeRule = _rules.SourceOf(match);
+
+		LOG_TRACE(Log::kHooks, "Context changed (interior {}, worldspace {:08X}, weather {:08X}, hour {}), rule {}.",
+			interior, worldspaceID, weather, hour, match ? "matched" : "not matched");
+	}
+
+	void BlurManager::UpdateZone() {
+		if (_zoneGrid.Empty()) {
+			_controller.SetZone({});
+			return;
+		}
+
+		const auto player       = RE::PlayerCharacter::GetSingleton();
+		const auto worldspace   = player ? player->GetWorldspace() : nullptr;
+		const auto worldspaceID = worldspace ? worldspace->GetFormID() : 0;
+		const auto position     = player ? player->GetPosition() : RE::NiPoint3{};
+
+		if (_zoneTracker.Update(_zoneGrid, worldspaceID, { position.x, position.y, position.z })) {
+			LOG_TRACE(Log::kHooks, "Blur zones at ({:.0f}, {:.0f}, {:.0f}) in {:08X}: keep {}, signature {:08X}.", position.x, position.y, position.z,
+				worldspaceID, _zoneTracker.Get().keep, _zoneTracker.Get().signature);
+		}
+		_controller.SetZone(_zoneTracker.Get());
+
+		// The idle poll would follow a falloff band in visible steps
+		if (_zoneTracker.InFalloff()) Wake(kWakeZone);
+	}
+
+	void BlurManager::CopyIMODData(RE::TESImageSpaceModifier* a_source, RE::TESImageSpaceModifier* a_dest) {
+		a_dest->formFlags            = a_source->formFlags;
+		a_dest->formType             = a_source->formType;
+		a_dest->bloom                = a_source->bloom;
+		a_dest->cinematic            = a_source->cinematic;
+		a_dest->hdr                  = a_source->hdr;
+		a_dest->radialBlur           = a_source->radialBlur;
+		a_dest->dof                  = a_source->dof;
+		a_dest->doubleVisionStrength = a_source->doubleVisionStrength;
+		a_dest->fadeColor            = a_source->fadeColor;
+		a_dest->tintColor            = a_source->tintColor;
+	}
 }
\ No newline at end of file
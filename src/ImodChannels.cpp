@@ -0,0 +1,59 @@
+#include "ImodChannels.h"
+
+#include <cmath>
+
+namespace Imod {
+
+	namespace {
+		// Every lane at the same point between its start and its target.
+		void BlendLanes(const float* a_start, const float* a_target, float a_weight, float* a_next) {
+#ifdef DB_IMOD_SSE
+			const __m128 weight = _mm_set1_ps(a_weight);
+
+			for (std::uint32_t i = 0; i < kChannelCount; i += 4) {
+				const __m128 start  = _mm_load_ps(a_start + i);
+				const __m128 target = _mm_load_ps(a_target + i);
+
+				_mm_store_ps(a_next + i, _mm_add_ps(start, _mm_mul_ps(weight, _mm_sub_ps(target, start))));
+			}
+#else
+			for (std::uint32_t i = 0; i < kChannelCount; i++) {
+				a_next[i] = a_start[i] + a_weight * (a_target[i] - a_start[i]);
+			}
+#endif
+		}
+	}
+
+	std::uint32_t ChannelState::Step() {
+		const float weight = Weight();
+
+		const auto stepDOF = [&]() {
+			const float strength  = applied[kDOFStrength];
+			const float range     = applied[kDOFRange];
+			applied[kDOFStrength] = std::lerp(start[kDOFStrength], target[kDOFStrength], weight);
+			applied[kDOFRange]    = std::lerp(start[kDOFRange], target[kDOFRange], weight);
+			return (applied[kDOFStrength] != strength ? 1u << kDOFStrength : 0u) | (applied[kDOFRange] != range ? 1u << kDOFRange : 0u);
+		};
+
+		// Only DOF in motion, which is every frame of a DOF-only table: two scalar lanes, no packed loads over
+		// values that were just written one float at a time
+		if (!extrasMoving) {
+			if (applied[kDOFStrength] == target[kDOFStrength] && applied[kDOFRange] == target[kDOFRange]) return 0;
+			return stepDOF();
+		}
+
+		alignas(16) Values next;
+		if (weight >= 1.0f) {
+			next = target;
+		} else {
+			BlendLanes(start.data(), target.data(), weight, next.data());
+		}
+		next[kDOFStrength] = applied[kDOFStrength];
+		next[kDOFRange]    = applied[kDOFRange];
+
+		const auto changed = DifferingLanes(applied, next) & ~dofMask;
+		applied            = next;
+		extrasMoving       = weight < 1.0f;  // Extra targets only move when a transition begins, so they arrive with the clock
+		return changed | stepDOF();
+	}
+}
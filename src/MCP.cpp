@@ -1,334 +1,764 @@
-﻿#include "PCH.h"
-#include "MCP.h"
-#include "Hooks.h"
-#include "Settings.h"
-#include "Utils.h"
-
-namespace MCP {
-	void Register() {
-		Logger::info("Registering MCP functionality");
-		if (!SKSEMenuFramework::IsInstalled()) {
-			Logger::error("SKSEMenuFramework is not installed. MCP functionality cannot be registered.");
-			return;
-		}
-		SKSEMenuFramework::SetSection(modName);
-		SKSEMenuFramework::AddSectionItem("General Settings", General::Render);
-		SKSEMenuFramework::AddSectionItem("Advanced Mode", Advanced::Render);
-	}
-	
-	namespace General {
-
-		enum BlurModes { None, Advanced, BlurMode_COUNT };
-
-		inline static int  defaultBlurMode                      = Advanced;
-		inline const char* blurModeNames[BlurMode_COUNT]        = { "None", "Advanced" };
-		inline const char* blurModeDescriptions[BlurMode_COUNT] = {
-			"No blur effects will be applied.\n\nEfficient, but distant objects may appear sharp and distinct.",
-			"The original implementation.\n\nUses weather IDs to determine blur strength. Good for specific weather setups, but requires manual configuration for new weather mods."
-		};
-
-		inline const std::string blurModeIcons[BlurMode_COUNT] = {
-			FontAwesome::UnicodeToUtf8(0xf05e), // Disabled
-			FontAwesome::UnicodeToUtf8(0xf013)  // Advanced
-		};
-
-		void __stdcall Render() {
-			auto& general = Settings::general;
-
-			const char* selectedBlurMode = (defaultBlurMode >= 0 && defaultBlurMode < BlurMode_COUNT) ? blurModeNames[defaultBlurMode] : "Unknown";
-			ImGuiMCP::SetNextItemWidth(-1.0f);
-			if (ImGuiMCP::SliderInt("Blur Mode", &defaultBlurMode, 0, BlurMode_COUNT - 1, selectedBlurMode)) {
-				general.BlurType = defaultBlurMode;
-			}
-
-			ImGuiMCP::Spacing();
-
-			if (ImGuiMCP::BeginChild("BlurModeInfoBox", ImVec2(0, 175.0f), true, ImGuiWindowFlags_NoScrollbar)) {
-
-				if (ImGuiMCP::BeginTable("BlurModeTable", 3, ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingStretchProp)) {
-
-					ImGuiMCP::TableSetupColumn("Icon", columnFlags, 75.0f);
-					ImGuiMCP::TableSetupColumn("Title", columnFlags, 100.0f);
-					ImGuiMCP::TableSetupColumn("Desc", lastColumnFlags); // Making a helper function for this is tempting
-
-					ImGuiMCP::TableNextRow();
-
-					// -- Column 1: Icon --
-					ImGuiMCP::TableNextColumn();
-					float cellHeight = 100.0f;
-					float cursorY    = ImGuiMCP::GetCursorPosY();
-					ImGuiMCP::SetCursorPosY(cursorY + (cellHeight * 0.45f));
-
-					FontAwesome::PushSolid();
-					ImGuiMCP::SetWindowFontScale(1.8f);
-					Utils::CenteredImGuiText(blurModeIcons[defaultBlurMode].c_str());
-					ImGuiMCP::SetWindowFontScale(1.0f);
-					FontAwesome::Pop();
-
-					// -- Column 2: Title --
-					ImGuiMCP::TableNextColumn();
-					ImGuiMCP::SetCursorPosY(cursorY + (cellHeight * 0.5f));
-
-					ImGuiMCP::PushStyleColor(ImGuiCol_Text, ImVec4(0.4f, 0.8f, 1.0f, 1.0f));
-					Utils::CenteredImGuiText(blurModeNames[defaultBlurMode]);
-					ImGuiMCP::PopStyleColor();
-
-					// -- Column 3: Description --
-					ImGuiMCP::TableNextColumn();
-					ImGuiMCP::SetWindowFontScale(0.8f);
-					ImGuiMCP::TextDisabled("Mode Description:");
-					ImGuiMCP::SetWindowFontScale(0.9f);
-					ImGuiMCP::Separator();
-					ImGuiMCP::PushTextWrapPos(0.0f);
-					ImGuiMCP::Text("%s", blurModeDescriptions[defaultBlurMode]);
-					ImGuiMCP::PopTextWrapPos();
-					ImGuiMCP::SetWindowFontScale(1.0f);
-					ImGuiMCP::EndTable();
-				}
-				ImGuiMCP::EndChild();
-			}
-
-			ImGuiMCP::Spacing();
-
-			if (ImGuiMCP::CollapsingHeader("Maintenance Settings##header")) {
-				ImGuiMCP::Checkbox("Extra Validity Checks", &general.ExtraChecks);
-				if (ImGuiMCP::IsItemHovered(tooltipFlags)) {
-					ImGuiMCP::SetTooltip("Perform extra checks on Weather Forms on game startup, this increases stability, but may cause a slight hitch on game load. (Default: Enabled)");
-				}
-
-				ImGuiMCP::Checkbox("Verbose Logging", &general.VerboseLogging);
-				if (ImGuiMCP::IsItemHovered(tooltipFlags)) {
-					ImGuiMCP::SetTooltip("Enable Extra Logging. (Default: Disabled)");
-				}
-			}
-
-		}
-	}
-
-	namespace Advanced {
-
-		AdvancedWeatherState g_advancedWeatherData;
-
-		struct ColumnData {
-			const char* title;
-			float       width;
-		};
-
-		const ColumnData COLUMN_SETUPS[] = {
-			{ "Handle",   55.0f  },
-			{ "Toggle",   60.0f  },
-			{ "Weather",  250.0f },
-			{ "Forecast", 65.0f  },
-			{ "Strength", 175.0f },
-			{ "Range",    175.0f },
-			{ "Static",   50.0f  },
-			{ "Reset",    50.0f  },
-			{ "Remove",   0.0f   }  // A width of 0.0f signifies a stretchy column
-		};
-
-		struct IconLibrary {
-			inline static const std::string DragHandle = FontAwesome::UnicodeToUtf8(0xf0c9) + "##Drag-Handle";
-			inline static const std::string GetWeather = FontAwesome::UnicodeToUtf8(0xe09a) + "##Get-Weather";
-			inline static const std::string ResetRow   = FontAwesome::UnicodeToUtf8(0xf021) + "##Reset-Row";
-			inline static const std::string RemoveRow  = FontAwesome::UnicodeToUtf8(0xf1f8) + "##Remove-Row";
-			inline static const std::string AddRow     = FontAwesome::UnicodeToUtf8(0xf0fe) + "##Add-Row";
-		};
-
-		void DrawTableRow(int rowIndex, WeatherSettingRow& currentRow, const std::vector<std::string>& weatherNames) {
-			ImGuiMCP::PushID(rowIndex);
-			ImGuiMCP::TableNextRow();
-
-			Logger::trace("Drawing row {}: Toggle = {}, Weather = '{}', Strength = {}, Range = {}, Static = {}",
-				rowIndex,
-				currentRow.rowToggle,
-				currentRow.rowWeatherType,
-				currentRow.rowBlurStrength,
-				currentRow.rowBlurRange,
-				currentRow.rowStaticToggle
-			);
-
-			// Column 0: Drag Handle
-			ImGuiMCP::TableNextColumn();
-			FontAwesome::PushSolid();
-			ImGuiMCP::Button(IconLibrary::DragHandle.c_str(), ImVec2(-FLT_MIN, 0.0f));
-			FontAwesome::Pop();
-
-			if (ImGuiMCP::BeginDragDropSource(ImGuiDragDropFlags_SourceAllowNullID)) {
-				ImGuiMCP::SetDragDropPayload("MCP_WEATHER_ROW", &rowIndex, sizeof(int));
-				ImGuiMCP::Text("Moving Row %d", rowIndex);
-				ImGuiMCP::EndDragDropSource();
-			}
-
-			if (ImGuiMCP::BeginDragDropTarget()) {
-				if (const ImGuiPayload* payload = ImGuiMCP::AcceptDragDropPayload("MCP_WEATHER_ROW")) {
-					int sourceIndex = *(const int*)payload->Data;
-					if (sourceIndex != rowIndex) {
-						auto& data = g_advancedWeatherData.settings;
-						std::swap(data[sourceIndex], data[rowIndex]);
-						Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
-					}
-				}
-				ImGuiMCP::EndDragDropTarget();
-			}
-			Logger::trace("Rendered Drag Handle for row {}", rowIndex);
-
-			// Column 1: Toggle
-			ImGuiMCP::TableNextColumn();
-			ImGuiMCP::SetCursorPosX(ImGuiMCP::GetCursorPosX() + (ImGuiMCP::GetColumnWidth() - ImGuiMCP::GetFrameHeight()) * 0.5f);
-			if (ImGuiMCP::Checkbox("##Toggle", &currentRow.rowToggle)) {
-				Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
-			}
-			Logger::trace("Rendered Toggle checkbox for row {}", rowIndex);
-
-			// Column 2: Weather ComboBox
-			ImGuiMCP::TableNextColumn();
-			ImGuiMCP::PushItemWidth(-FLT_MIN);
-			std::string originalWeather = currentRow.rowWeatherType;
-			if (ImGuiMCP::BeginCombo("##Weather", originalWeather.c_str())) {
-				for (const auto& weatherName : weatherNames) {
-					bool isUsedByOther = false;
-
-					// "None" is allowed to be duplicated. Current Row is allowed to select its own weather.
-					if (weatherName != "None" && weatherName != currentRow.rowWeatherType) {
-						for (const auto& existingRow : g_advancedWeatherData.settings) {
-							if (existingRow.rowWeatherType == weatherName) {
-								isUsedByOther = true;
-								break;
-							}
-						}
-					}
-
-					// Skip this iteration if weather is taken
-					if (isUsedByOther) continue;
-					bool isSelected = (currentRow.rowWeatherType == weatherName);
-					if (ImGuiMCP::Selectable(weatherName.c_str(), isSelected)) {
-						currentRow.rowWeatherType = weatherName;
-					}
-					if (isSelected) ImGuiMCP::SetItemDefaultFocus();
-				}
-				ImGuiMCP::EndCombo();
-				if (originalWeather != currentRow.rowWeatherType) {
-					Logger::trace("Weather changed for row {}: '{}' -> '{}'", rowIndex, originalWeather, currentRow.rowWeatherType);
-					Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
-				}
-			}
-			Logger::trace("Rendered Weather ComboBox for row {}", rowIndex);
-
-			// Column 3: Get Current Weather
-			ImGuiMCP::TableNextColumn();
-			ImGuiMCP::PushItemWidth(-FLT_MIN);
-			FontAwesome::PushSolid();
-			if (ImGuiMCP::Button(IconLibrary::GetWeather.c_str(), ImVec2(-FLT_MIN, 0.0f))) {
-				Logger::trace("Weather selection button clicked for row {}", rowIndex);
-				currentRow.rowWeatherType = Utils::GetCurrentWeather();
-			}
-			if (originalWeather != currentRow.rowWeatherType) {
-				Logger::trace("Weather changed for row {}: '{}' -> '{}'", rowIndex, originalWeather, currentRow.rowWeatherType);
-				Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
-			}
-			FontAwesome::Pop();
-			Logger::trace("Rendered Get Current Weather button for row {}", rowIndex);
-
-			// Column 4: Strength
-			ImGuiMCP::TableNextColumn();
-			ImGuiMCP::PushItemWidth(-FLT_MIN);
-			if (ImGuiMCP::InputFloat("##Strength", &currentRow.rowBlurStrength, 0.01f, 0.1f, "%.2f", inputFlags)) {
-				Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
-			}
-			Logger::trace("Rendered Strength input for row {}", rowIndex);
-
-			// Column 5: Range
-			ImGuiMCP::TableNextColumn();
-			ImGuiMCP::PushItemWidth(-FLT_MIN);
-			if (ImGuiMCP::InputFloat("##Range", &currentRow.rowBlurRange, 10.0f, 100.0f, "%.2f", inputFlags)) {
-				Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
-			}
-			Logger::trace("Rendered Range input for row {}", rowIndex);
-
-			// Column 6: Static
-			ImGuiMCP::TableNextColumn();
-			ImGuiMCP::SetCursorPosX(ImGuiMCP::GetCursorPosX() + (ImGuiMCP::GetColumnWidth() - ImGuiMCP::GetFrameHeight()) * 0.5f);
-			if (ImGuiMCP::Checkbox("##Static", &currentRow.rowStaticToggle)) {
-				Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
-			}
-			Logger::trace("Rendered Static checkbox for row {}", rowIndex);
-
-			// Column 7: Reset
-			ImGuiMCP::TableNextColumn();
-			FontAwesome::PushSolid();
-			auto originalRow = currentRow;
-			if (ImGuiMCP::Button(IconLibrary::ResetRow.c_str(), ImVec2(-FLT_MIN, 0.0f))) {
-				currentRow = WeatherSettingRow{};
-			}
-			if (originalRow != currentRow) {
-				Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
-			}
-			FontAwesome::Pop();
-			Logger::trace("Rendered Reset button for row {}", rowIndex);
-
-			// Column 8: Remove
-			ImGuiMCP::TableNextColumn();
-			FontAwesome::PushSolid();
-			if (ImGuiMCP::Button(IconLibrary::RemoveRow.c_str(), ImVec2(-FLT_MIN, 0.0f))) {
-				g_advancedWeatherData.rowToRemove = rowIndex;
-				Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
-			}
-			FontAwesome::Pop();
-			Logger::trace("Rendered Remove button for row {}", rowIndex);
-
-			ImGuiMCP::PopID();
-			Logger::trace("Finished drawing row {}", rowIndex);
-		}
-
-		void RenderWeatherTable() {
-
-			Logger::trace("Rendering Weather Table with {} rows", g_advancedWeatherData.settings.size());
-
-			const auto& weatherNames = Utils::g_formCache[std::type_index(typeid(RE::TESWeather))];
-			const int   columnCount  = std::size(COLUMN_SETUPS);
-			Logger::trace("Weather Table Column Count: {}", columnCount);
-
-			if (ImGuiMCP::BeginTable("WeatherTable", columnCount, tableFlags)) {
-				for (const auto& setup : COLUMN_SETUPS) {
-					if (setup.width > 0.0f) {
-						ImGuiMCP::TableSetupColumn(setup.title, columnFlags, setup.width);
-						Logger::trace("Setting up column '{}' with stretchy width {}", setup.title, setup.width);
-					} else {
-						ImGuiMCP::TableSetupColumn(setup.title, lastColumnFlags);
-						Logger::trace("Setting up last column '{}' with adapting width", setup.title);
-					}
-				}
-
-				ImGuiMCP::TableNextRow(ImGuiTableRowFlags_Headers);
-				for (int headerColumn = 0; headerColumn < columnCount; headerColumn++) {
-					Logger::trace("Drawing header for column index {}", headerColumn);
-					ImGuiMCP::TableSetColumnIndex(headerColumn);
-					Utils::CenteredImGuiText(COLUMN_SETUPS[headerColumn].title);
-					Logger::trace("Header drawn: {}", COLUMN_SETUPS[headerColumn].title);
-				}
-
-				for (int row = 0; row < g_advancedWeatherData.settings.size(); row++) {
-					DrawTableRow(row, g_advancedWeatherData.settings[row], weatherNames);
-					Logger::trace("Drawn row {}", row);
-				}
-				ImGuiMCP::EndTable();
-
-				g_advancedWeatherData.RemoveRow();
-				Logger::trace("Processed row removals if any");
-				
-				// Add Row button
-				FontAwesome::PushRegular();
-				if (ImGuiMCP::Button(IconLibrary::AddRow.c_str(), ImVec2(-FLT_MIN, 0.0f))) {
-					Logger::trace("Add row button clicked");
-					g_advancedWeatherData.AddRow();
-					Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
-				}
-				FontAwesome::Pop();
-			}
-		}
-
-		void __stdcall Render() {
-			RenderWeatherTable();
-		}
-	}
+﻿#include "PCH.h"
+#include "MCP.h"
+#include "Hooks.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "Settings.h"
+#include "Telemetry.h"
+#include "Utils.h"
+
+namespace MCP {
+	void Register() {
+		Logger::info("Registering MCP functionality");
+		if (!SKSEMenuFramework::IsInstalled()) {
+			Logger::error("SKSEMenuFramework is not installed. MCP functionality cannot be registered.");
+			return;
+		}
+		SKSEMenuFramework::SetSection(modName);
+		SKSEMenuFramework::AddSectionItem("General Settings", General::Render);
+		SKSEMenuFramework::AddSectionItem("Advanced Mode", Advanced::Render);
+		SKSEMenuFramework::AddSectionItem("Diagnostics", Diagnostics::Render);
+	}
+	
+	namespace General {
+
+		enum BlurModes { None, Advanced, Automatic, BlurMode_COUNT };
+
+		inline static int  defaultBlurMode                      = Advanced;
+		inline const char* blurModeNames[BlurMode_COUNT]        = { "None", "Advanced", "Automatic" };
+		inline const char* blurModeDescriptions[BlurMode_COUNT] = {
+			"No blur effects will be applied.\n\nEfficient, but distant objects may appear sharp and distinct.",
+			"The original implementation.\n\nUses weather IDs to determine blur strength. Good for specific weather setups, but requires manual configuration for new weather mods.",
+			"Advanced, with every other weather filled in from its own fog distances and type.\n\nWorks with new weather mods out of the box. Tune the curves in the [Automatic] section of the INI, rows in the weather table still take precedence."
+		};
+
+		inline const std::string blurModeIcons[BlurMode_COUNT] = {
+			FontAwesome::UnicodeToUtf8(0xf05e), // Disabled
+			FontAwesome::UnicodeToUtf8(0xf013), // Advanced
+			FontAwesome::UnicodeToUtf8(0xf0d0)  // Automatic
+		};
+
+		void __stdcall Render() {
+			auto& general = Settings::general;
+
+			const char* selectedBlurMode = (defaultBlurMode >= 0 && defaultBlurMode < BlurMode_COUNT) ? blurModeNames[defaultBlurMode] : "Unknown";
+			ImGuiMCP::SetNextItemWidth(-1.0f);
+			if (ImGuiMCP::SliderInt("Blur Mode", &defaultBlurMode, 0, BlurMode_COUNT - 1, selectedBlurMode)) {
+				general.BlurType = defaultBlurMode;
+				Hooks::BlurManager::GetSingleton().Wake(Hooks::BlurManager::kWakeSettings);
+			}
+
+			ImGuiMCP::Spacing();
+
+			if (ImGuiMCP::BeginChild("BlurModeInfoBox", ImVec2(0, 175.0f), true, ImGuiWindowFlags_NoScrollbar)) {
+
+				if (ImGuiMCP::BeginTable("BlurModeTable", 3, ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingStretchProp)) {
+
+					ImGuiMCP::TableSetupColumn("Icon", columnFlags, 75.0f);
+					ImGuiMCP::TableSetupColumn("Title", columnFlags, 100.0f);
+					ImGuiMCP::TableSetupColumn("Desc", lastColumnFlags); // Making a helper function for this is tempting
+
+					ImGuiMCP::TableNextRow();
+
+					// -- Column 1: Icon --
+					ImGuiMCP::TableNextColumn();
+					float cellHeight = 100.0f;
+					float cursorY    = ImGuiMCP::GetCursorPosY();
+					ImGuiMCP::SetCursorPosY(cursorY + (cellHeight * 0.45f));
+
+					FontAwesome::PushSolid();
+					ImGuiMCP::SetWindowFontScale(1.8f);
+					Utils::CenteredImGuiText(blurModeIcons[defaultBlurMode].c_str());
+					ImGuiMCP::SetWindowFontScale(1.0f);
+					FontAwesome::Pop();
+
+					// -- Column 2: Title --
+					ImGuiMCP::TableNextColumn();
+					ImGuiMCP::SetCursorPosY(cursorY + (cellHeight * 0.5f));
+
+					ImGuiMCP::PushStyleColor(ImGuiCol_Text, ImVec4(0.4f, 0.8f, 1.0f, 1.0f));
+					Utils::CenteredImGuiText(blurModeNames[defaultBlurMode]);
+					ImGuiMCP::PopStyleColor();
+
+					// -- Column 3: Description --
+					ImGuiMCP::TableNextColumn();
+					ImGuiMCP::SetWindowFontScale(0.8f);
+					ImGuiMCP::TextDisabled("Mode Description:");
+					ImGuiMCP::SetWindowFontScale(0.9f);
+					ImGuiMCP::Separator();
+					ImGuiMCP::PushTextWrapPos(0.0f);
+					ImGuiMCP::Text("%s", blurModeDescriptions[defaultBlurMode]);
+					ImGuiMCP::PopTextWrapPos();
+					ImGuiMCP::SetWindowFontScale(1.0f);
+					ImGuiMCP::EndTable();
+				}
+				ImGuiMCP::EndChild();
+			}
+
+			ImGuiMCP::Spacing();
+
+			if (ImGuiMCP::CollapsingHeader("Maintenance Settings##header")) {
+				ImGuiMCP::Checkbox("Extra Validity Checks", &general.ExtraChecks);
+				if (ImGuiMCP::IsItemHovered(tooltipFlags)) {
+					ImGuiMCP::SetTooltip("Check every Weather and IMAD form on a background thread after game load, and log one summary of any problems found. Takes effect on the next launch. (Default: Disabled)");
+				}
+
+				ImGuiMCP::Checkbox("Verbose Logging", &general.VerboseLogging);
+				if (ImGuiMCP::IsItemHovered(tooltipFlags)) {
+					ImGuiMCP::SetTooltip("Enable Extra Logging. (Default: Disabled)");
+				}
+			}
+
+		}
+	}
+
+	namespace Advanced {
+
+		AdvancedWeatherState g_advancedWeatherData;
+
+		struct ColumnData {
+			const char* title;
+			float       width;
+		};
+
+		const ColumnData COLUMN_SETUPS[] = {
+			{ "Handle",   55.0f  },
+			{ "Toggle",   60.0f  },
+			{ "Weather",  250.0f },
+			{ "Forecast", 65.0f  },
+			{ "Strength", 175.0f },
+			{ "Range",    175.0f },
+			{ "Static",   50.0f  },
+			{ "Fade",     110.0f },
+			{ "Easing",   120.0f },
+			{ "Curve",    50.0f  },
+			{ "Reset",    50.0f  },
+			{ "Remove",   0.0f   }  // A width of 0.0f signifies a stretchy column
+		};
+
+		// Display names, in Easing::Curve order
+		const char* EASING_LABELS[Easing::kCurveCount] = { "Linear", "Smooth Step", "Ease In", "Ease Out", "Ease In-Out", "Exponential" };
+
+		struct IconLibrary {
+			inline static const std::string DragHandle = FontAwesome::UnicodeToUtf8(0xf0c9) + "##Drag-Handle";
+			inline static const std::string GetWeather = FontAwesome::UnicodeToUtf8(0xe09a) + "##Get-Weather";
+			inline static const std::string ResetRow   = FontAwesome::UnicodeToUtf8(0xf021) + "##Reset-Row";
+			inline static const std::string RemoveRow  = FontAwesome::UnicodeToUtf8(0xf1f8) + "##Remove-Row";
+			inline static const std::string EditCurve  = FontAwesome::UnicodeToUtf8(0xf201) + "##Edit-Curve";
+			inline static const std::string RemoveKey  = FontAwesome::UnicodeToUtf8(0xf1f8) + "##Remove-Key";
+			inline static const std::string AddRow     = FontAwesome::UnicodeToUtf8(0xf0fe) + "##Add-Row";
+		};
+
+		// Filter text and the cache indices it lets through. Only one combo can be open at a time, so every
+		// row shares a single picker, and the list is only rebuilt when the filter, row or used set changes.
+		struct WeatherPicker {
+			static constexpr int maxVisibleItems = 12;
+
+			char                       filter[128] = {};
+			std::vector<std::uint32_t> visible;
+
+			void Refresh(const Utils::FormCache<RE::TESWeather>& weathers, const std::string& currentWeather) {
+				const std::string_view filterView = filter;
+				if (filterView == _builtFilter && currentWeather == _builtForWeather &&
+					_builtUsedVersion == g_advancedWeatherData.usedVersion && _builtCacheSize == weathers.Size()) {
+					return;
+				}
+
+				visible.clear();
+				for (std::size_t weatherIndex = 0; weatherIndex < weathers.Size(); weatherIndex++) {
+					const auto weatherName = weathers.NameView(weatherIndex);
+
+					// "None" is allowed to be duplicated. Current Row is allowed to select its own weather.
+					if (weatherName != currentWeather && g_advancedWeatherData.IsWeatherUsed(weatherName)) continue;
+					if (!Utils::ContainsNoCase(weatherName, filterView)) continue;
+
+					visible.push_back(static_cast<std::uint32_t>(weatherIndex));
+				}
+
+				_builtFilter      = filterView;
+				_builtForWeather  = currentWeather;
+				_builtUsedVersion = g_advancedWeatherData.usedVersion;
+				_builtCacheSize   = weathers.Size();
+			}
+
+		private:
+			std::string   _builtFilter;
+			std::string   _builtForWeather;
+			std::uint64_t _builtUsedVersion = ~0ull;
+			std::size_t   _builtCacheSize   = 0;
+		};
+
+		WeatherPicker g_weatherPicker;
+
+		// Body geometry measured from rows that were actually drawn, so the spacer rows standing in for
+		// clipped ones match them, plus header text widths that only change with the font size.
+		struct TableLayout {
+			float rowStride  = 0.0f;
+			float bodyOffset = 0.0f;
+			float fontSize   = 0.0f;
+
+			std::array<float, std::size(COLUMN_SETUPS)> headerWidths{};
+
+			void RefreshHeaderWidths() {
+				const float currentFontSize = ImGuiMCP::GetFontSize();
+				if (currentFontSize == fontSize) return;
+
+				fontSize = currentFontSize;
+				for (std::size_t column = 0; column < std::size(COLUMN_SETUPS); column++) {
+					ImVec2 textSize;
+					ImGuiMCP::CalcTextSize(&textSize, COLUMN_SETUPS[column].title, nullptr, false, 0);
+					headerWidths[column] = textSize.x;
+				}
+				LOG_TRACE(Log::kUI, "Weather Table header widths measured at font size {}", fontSize);
+			}
+		};
+
+		TableLayout g_tableLayout;
+
+		/**
+		 * @brief Popup body for a row's time-of-day keyframes. The preview is baked the same way as the live table,
+		 *        so what is plotted is exactly what the controller samples.
+		 */
+		void DrawCurveEditor(WeatherSettingRow& currentRow) {
+			auto& keys    = currentRow.rowCurve;
+			bool  changed = false;
+
+			ImGuiMCP::Text("Time of Day Curve");
+			if (keys.empty()) {
+				ImGuiMCP::TextDisabled("No keyframes, the row uses its flat Strength and Range.");
+			} else {
+				TimeCurve::LUT preview;
+				preview.Bake(keys, 1.0f);
+				ImGuiMCP::PlotLines("##Curve-Preview", preview.Strength().data(), static_cast<int>(TimeCurve::LUT::resolution), 0, "Strength 0h - 24h", 0.0f, FLT_MAX, ImVec2(360.0f, 60.0f), sizeof(float));
+			}
+
+			int keyToRemove = -1;
+			if (!keys.empty() && ImGuiMCP::BeginTable("##Curve-Keys", 4, tableFlags)) {
+				ImGuiMCP::TableSetupColumn("Hour", columnFlags, 90.0f);
+				ImGuiMCP::TableSetupColumn("Strength", columnFlags, 110.0f);
+				ImGuiMCP::TableSetupColumn("Range", columnFlags, 110.0f);
+				ImGuiMCP::TableSetupColumn("##Remove", lastColumnFlags, 0.0f);
+				ImGuiMCP::TableHeadersRow();
+
+				for (int keyIndex = 0; keyIndex < static_cast<int>(keys.size()); keyIndex++) {
+					auto& key = keys[keyIndex];
+					ImGuiMCP::PushID(keyIndex);
+					ImGuiMCP::TableNextRow();
+
+					ImGuiMCP::TableNextColumn();
+					ImGuiMCP::PushItemWidth(-FLT_MIN);
+					if (ImGuiMCP::InputFloat("##Hour", &key.hour, 0.0f, 0.0f, "%.2f", inputFlags)) {
+						key.hour = std::clamp(key.hour, 0.0f, 23.99f);
+						changed  = true;
+					}
+
+					ImGuiMCP::TableNextColumn();
+					ImGuiMCP::PushItemWidth(-FLT_MIN);
+					changed |= ImGuiMCP::InputFloat("##Strength", &key.strength, 0.0f, 0.0f, "%.2f", inputFlags);
+
+					ImGuiMCP::TableNextColumn();
+					ImGuiMCP::PushItemWidth(-FLT_MIN);
+					changed |= ImGuiMCP::InputFloat("##Range", &key.range, 0.0f, 0.0f, "%.2f", inputFlags);
+
+					ImGuiMCP::TableNextColumn();
+					FontAwesome::PushSolid();
+					if (ImGuiMCP::Button(IconLibrary::RemoveKey.c_str(), ImVec2(-FLT_MIN, 0.0f))) keyToRemove = keyIndex;
+					FontAwesome::Pop();
+
+					ImGuiMCP::PopID();
+				}
+				ImGuiMCP::EndTable();
+			}
+
+			if (keyToRemove >= 0) {
+				keys.erase(keys.begin() + keyToRemove);
+				changed = true;
+			}
+
+			// New keys start at the current game hour with the row's flat values, which is what the row showed until now
+			if (ImGuiMCP::Button("Add Keyframe", ImVec2(0.0f, 0.0f))) {
+				const auto calendar = RE::Calendar::GetSingleton();
+				const float hour    = calendar ? std::floor(calendar->GetHour()) : 12.0f;
+				keys.push_back({ hour, currentRow.rowBlurStrength, currentRow.rowBlurRange });
+				std::ranges::stable_sort(keys, {}, &TimeCurve::Keyframe::hour);
+				changed = true;
+			}
+			if (!keys.empty()) {
+				ImGuiMCP::SameLine();
+				if (ImGuiMCP::Button("Clear", ImVec2(0.0f, 0.0f))) {
+					keys.clear();
+					changed = true;
+				}
+			}
+
+			if (changed) {
+				LOG_TRACE(Log::kUI, "Curve for '{}' edited, {} keyframes", currentRow.rowWeatherType, keys.size());
+				Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
+			}
+		}
+
+		/**
+		 * @brief Draws a single row and returns the Y position of its first cell, which the table uses to measure row height.
+		 */
+		float DrawTableRow(int rowIndex, WeatherSettingRow& currentRow, const Utils::FormCache<RE::TESWeather>& weathers) {
+			ImGuiMCP::PushID(rowIndex);
+			ImGuiMCP::TableNextRow();
+
+			LOG_TRACE(Log::kUI, "Drawing row {}: Toggle = {}, Weather = '{}', Strength = {}, Range = {}, Static = {}",
+				rowIndex,
+				currentRow.rowToggle,
+				currentRow.rowWeatherType,
+				currentRow.rowBlurStrength,
+				currentRow.rowBlurRange,
+				currentRow.rowStaticToggle
+			);
+
+			// Column 0: Drag Handle
+			ImGuiMCP::TableNextColumn();
+			const float rowY = ImGuiMCP::GetCursorPosY();
+			FontAwesome::PushSolid();
+			ImGuiMCP::Button(IconLibrary::DragHandle.c_str(), ImVec2(-FLT_MIN, 0.0f));
+			FontAwesome::Pop();
+
+			if (ImGuiMCP::BeginDragDropSource(ImGuiDragDropFlags_SourceAllowNullID)) {
+				ImGuiMCP::SetDragDropPayload("MCP_WEATHER_ROW", &rowIndex, sizeof(int));
+				ImGuiMCP::Text("Moving Row %d", rowIndex);
+				ImGuiMCP::EndDragDropSource();
+			}
+
+			if (ImGuiMCP::BeginDragDropTarget()) {
+				if (const ImGuiPayload* payload = ImGuiMCP::AcceptDragDropPayload("MCP_WEATHER_ROW")) {
+					int sourceIndex = *(const int*)payload->Data;
+					if (sourceIndex != rowIndex) {
+						auto& data = g_advancedWeatherData.settings;
+						std::swap(data[sourceIndex], data[rowIndex]);
+						Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
+					}
+				}
+				ImGuiMCP::EndDragDropTarget();
+			}
+			LOG_TRACE(Log::kUI, "Rendered Drag Handle for row {}", rowIndex);
+
+			// Column 1: Toggle
+			ImGuiMCP::TableNextColumn();
+			ImGuiMCP::SetCursorPosX(ImGuiMCP::GetCursorPosX() + (ImGuiMCP::GetColumnWidth() - ImGuiMCP::GetFrameHeight()) * 0.5f);
+			if (ImGuiMCP::Checkbox("##Toggle", &currentRow.rowToggle)) {
+				Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
+			}
+			LOG_TRACE(Log::kUI, "Rendered Toggle checkbox for row {}", rowIndex);
+
+			// Column 2: Weather ComboBox
+			ImGuiMCP::TableNextColumn();
+			ImGuiMCP::PushItemWidth(-FLT_MIN);
+			if (ImGuiMCP::BeginCombo("##Weather", currentRow.rowWeatherType.c_str())) {
+				const std::string originalWeather = currentRow.rowWeatherType;
+				auto&      picker    = g_weatherPicker;
+				const bool appearing = ImGuiMCP::IsWindowAppearing();
+				if (appearing) {
+					picker.filter[0] = '\0';
+					ImGuiMCP::SetKeyboardFocusHere(0);
+				}
+
+				ImGuiMCP::SetNextItemWidth(-FLT_MIN);
+				ImGuiMCP::InputText("##WeatherFilter", picker.filter, sizeof(picker.filter), ImGuiInputTextFlags_AutoSelectAll, nullptr, nullptr);
+				picker.Refresh(weathers, currentRow.rowWeatherType);
+
+				const int   shown      = static_cast<int>(picker.visible.size());
+				const float itemHeight = ImGuiMCP::GetTextLineHeightWithSpacing();
+				const float listHeight = static_cast<float>(std::clamp(shown, 1, WeatherPicker::maxVisibleItems)) * itemHeight;
+
+				if (ImGuiMCP::BeginChild("##WeatherList", ImVec2(0.0f, listHeight), false, 0)) {
+					if (appearing) {
+						const auto selected = std::ranges::find_if(picker.visible, [&](std::uint32_t index) { return weathers.NameView(index) == currentRow.rowWeatherType; });
+						if (selected != picker.visible.end()) {
+							ImGuiMCP::SetScrollY(static_cast<float>(selected - picker.visible.begin()) * itemHeight);
+						}
+					}
+
+					// Only the rows inside the scroll window are submitted, load orders can have thousands of weathers.
+					{
+						Utils::ListClip clip(shown, itemHeight);
+						for (int visibleIndex = clip.first; visibleIndex < clip.last; visibleIndex++) {
+							const auto weatherIndex = picker.visible[visibleIndex];
+							const auto weatherName  = weathers.NameView(weatherIndex);
+							bool       isSelected   = (currentRow.rowWeatherType == weatherName);
+							if (ImGuiMCP::Selectable(weathers.Name(weatherIndex), isSelected)) {
+								currentRow.rowWeatherType = weatherName;
+								ImGuiMCP::CloseCurrentPopup();
+							}
+						}
+					}
+					ImGuiMCP::EndChild();
+				}
+				ImGuiMCP::EndCombo();
+				if (originalWeather != currentRow.rowWeatherType) {
+					LOG_TRACE(Log::kUI, "Weather changed for row {}: '{}' -> '{}'", rowIndex, originalWeather, currentRow.rowWeatherType);
+					g_advancedWeatherData.TrackWeatherChange(originalWeather, currentRow.rowWeatherType);
+					Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
+				}
+			}
+			LOG_TRACE(Log::kUI, "Rendered Weather ComboBox for row {}", rowIndex);
+
+			// Column 3: Get Current Weather
+			ImGuiMCP::TableNextColumn();
+			ImGuiMCP::PushItemWidth(-FLT_MIN);
+			FontAwesome::PushSolid();
+			if (ImGuiMCP::Button(IconLibrary::GetWeather.c_str(), ImVec2(-FLT_MIN, 0.0f))) {
+				LOG_TRACE(Log::kUI, "Weather selection button clicked for row {}", rowIndex);
+				const auto currentWeather = Utils::GetCurrentWeather();
+				if (currentWeather != currentRow.rowWeatherType) {
+					LOG_TRACE(Log::kUI, "Weather changed for row {}: '{}' -> '{}'", rowIndex, currentRow.rowWeatherType, currentWeather);
+					g_advancedWeatherData.TrackWeatherChange(currentRow.rowWeatherType, currentWeather);
+					currentRow.rowWeatherType = currentWeather;
+					Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
+				}
+			}
+			FontAwesome::Pop();
+			LOG_TRACE(Log::kUI, "Rendered Get Current Weather button for row {}", rowIndex);
+
+			// Column 4: Strength
+			ImGuiMCP::TableNextColumn();
+			ImGuiMCP::PushItemWidth(-FLT_MIN);
+			if (ImGuiMCP::InputFloat("##Strength", &currentRow.rowBlurStrength, 0.01f, 0.1f, "%.2f", inputFlags)) {
+				Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
+			}
+			LOG_TRACE(Log::kUI, "Rendered Strength input for row {}", rowIndex);
+
+			// Column 5: Range
+			ImGuiMCP::TableNextColumn();
+			ImGuiMCP::PushItemWidth(-FLT_MIN);
+			if (ImGuiMCP::InputFloat("##Range", &currentRow.rowBlurRange, 10.0f, 100.0f, "%.2f", inputFlags)) {
+				Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
+			}
+			LOG_TRACE(Log::kUI, "Rendered Range input for row {}", rowIndex);
+
+			// Column 6: Static
+			ImGuiMCP::TableNextColumn();
+			ImGuiMCP::SetCursorPosX(ImGuiMCP::GetCursorPosX() + (ImGuiMCP::GetColumnWidth() - ImGuiMCP::GetFrameHeight()) * 0.5f);
+			if (ImGuiMCP::Checkbox("##Static", &currentRow.rowStaticToggle)) {
+				Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
+			}
+			LOG_TRACE(Log::kUI, "Rendered Static checkbox for row {}", rowIndex);
+
+			// Column 7: Fade Duration
+			ImGuiMCP::TableNextColumn();
+			ImGuiMCP::PushItemWidth(-FLT_MIN);
+			if (ImGuiMCP::InputFloat("##Fade", &currentRow.rowDuration, 0.5f, 1.0f, "%.1f s", inputFlags)) {
+				currentRow.rowDuration = std::max(currentRow.rowDuration, 0.0f);
+				Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
+			}
+			if (ImGuiMCP::IsItemHovered(tooltipFlags)) {
+				ImGuiMCP::SetTooltip(currentRow.rowStaticToggle ? "Unused, the row is static." : "Seconds to fade into this weather, and back out of it.");
+			}
+			LOG_TRACE(Log::kUI, "Rendered Fade input for row {}", rowIndex);
+
+			// Column 8: Easing
+			ImGuiMCP::TableNextColumn();
+			ImGuiMCP::PushItemWidth(-FLT_MIN);
+			if (ImGuiMCP::BeginCombo("##Easing", EASING_LABELS[currentRow.rowEasing])) {
+				for (std::uint32_t curve = 0; curve < Easing::kCurveCount; curve++) {
+					const bool isSelected = currentRow.rowEasing == curve;
+					if (ImGuiMCP::Selectable(EASING_LABELS[curve], isSelected) && !isSelected) {
+						currentRow.rowEasing = static_cast<Easing::Curve>(curve);
+						Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
+					}
+				}
+				ImGuiMCP::EndCombo();
+			}
+			LOG_TRACE(Log::kUI, "Rendered Easing combo for row {}", rowIndex);
+
+			// Column 9: Curve
+			ImGuiMCP::TableNextColumn();
+			FontAwesome::PushSolid();
+			if (ImGuiMCP::Button(IconLibrary::EditCurve.c_str(), ImVec2(-FLT_MIN, 0.0f))) {
+				ImGuiMCP::OpenPopup("##Curve-Editor", 0);
+			}
+			FontAwesome::Pop();
+			if (ImGuiMCP::IsItemHovered(tooltipFlags)) {
+				if (currentRow.rowCurve.empty()) {
+					ImGuiMCP::SetTooltip("Flat, click to add time of day keyframes.");
+				} else {
+					ImGuiMCP::SetTooltip("%d time of day keyframes.", static_cast<int>(currentRow.rowCurve.size()));
+				}
+			}
+			if (ImGuiMCP::BeginPopup("##Curve-Editor", 0)) {
+				DrawCurveEditor(currentRow);
+				ImGuiMCP::EndPopup();
+			}
+			LOG_TRACE(Log::kUI, "Rendered Curve button for row {}", rowIndex);
+
+			// Column 10: Reset
+			ImGuiMCP::TableNextColumn();
+			FontAwesome::PushSolid();
+			if (ImGuiMCP::Button(IconLibrary::ResetRow.c_str(), ImVec2(-FLT_MIN, 0.0f))) {
+				const WeatherSettingRow defaultRow{};
+				if (currentRow != defaultRow) {
+					g_advancedWeatherData.TrackWeatherChange(currentRow.rowWeatherType, defaultRow.rowWeatherType);
+					currentRow = defaultRow;
+					Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
+				}
+			}
+			FontAwesome::Pop();
+			LOG_TRACE(Log::kUI, "Rendered Reset button for row {}", rowIndex);
+
+			// Column 11: Remove
+			ImGuiMCP::TableNextColumn();
+			FontAwesome::PushSolid();
+			if (ImGuiMCP::Button(IconLibrary::RemoveRow.c_str(), ImVec2(-FLT_MIN, 0.0f))) {
+				g_advancedWeatherData.rowToRemove = rowIndex;
+				Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
+			}
+			FontAwesome::Pop();
+			LOG_TRACE(Log::kUI, "Rendered Remove button for row {}", rowIndex);
+
+			ImGuiMCP::PopID();
+			LOG_TRACE(Log::kUI, "Finished drawing row {}", rowIndex);
+			return rowY;
+		}
+
+		/**
+		 * @brief Emits empty rows covering a number of clipped body rows. The count of spacer rows keeps
+		 *        the RowBg striping parity of the rows drawn after them.
+		 */
+		void DrawSpacerRows(int clippedRows, float rowStride) {
+			if (clippedRows <= 0) return;
+
+			if (clippedRows % 2 == 0) {
+				ImGuiMCP::TableNextRow(ImGuiTableRowFlags_None, (clippedRows - 1) * rowStride);
+				ImGuiMCP::TableNextRow(ImGuiTableRowFlags_None, rowStride);
+			} else {
+				ImGuiMCP::TableNextRow(ImGuiTableRowFlags_None, clippedRows * rowStride);
+			}
+		}
+
+		void RenderWeatherTable() {
+
+			LOG_TRACE(Log::kUI, "Rendering Weather Table with {} rows", g_advancedWeatherData.settings.size());
+
+			const auto& weathers     = Utils::g_formCache<RE::TESWeather>;
+			const int   columnCount  = std::size(COLUMN_SETUPS);
+			LOG_TRACE(Log::kUI, "Weather Table Column Count: {}", columnCount);
+
+			if (ImGuiMCP::BeginTable("WeatherTable", columnCount, tableFlags)) {
+				// ImGui needs the columns declared every frame, only the text measurements are cached.
+				for (const auto& setup : COLUMN_SETUPS) {
+					ImGuiMCP::TableSetupColumn(setup.title, setup.width > 0.0f ? columnFlags : lastColumnFlags, setup.width);
+				}
+
+				auto& layout = g_tableLayout;
+				layout.RefreshHeaderWidths();
+
+				ImGuiMCP::TableNextRow(ImGuiTableRowFlags_Headers);
+				ImGuiMCP::TableSetColumnIndex(0);
+				const float headerY = ImGuiMCP::GetCursorPosY();
+				for (int headerColumn = 0; headerColumn < columnCount; headerColumn++) {
+					ImGuiMCP::TableSetColumnIndex(headerColumn);
+					Utils::CenteredImGuiText(COLUMN_SETUPS[headerColumn].title, layout.headerWidths[headerColumn]);
+				}
+
+				// Only rows inside the visible part of the window are built, the rest are replaced by spacer rows.
+				auto&       rows      = g_advancedWeatherData.settings;
+				const int   rowCount  = static_cast<int>(rows.size());
+				const float rowStride = layout.rowStride > 0.0f ? layout.rowStride : ImGuiMCP::GetFrameHeightWithSpacing();
+				const float bodyY     = headerY + (layout.bodyOffset > 0.0f ? layout.bodyOffset : rowStride);
+				const float scrollY   = ImGuiMCP::GetScrollY();
+
+				const int firstRow = std::clamp(static_cast<int>((scrollY - bodyY) / rowStride), 0, rowCount);
+				const int lastRow  = std::clamp(static_cast<int>((scrollY + ImGuiMCP::GetWindowHeight() - bodyY) / rowStride) + 2, firstRow, rowCount);
+
+				DrawSpacerRows(firstRow, rowStride);
+
+				float previousRowY = -1.0f;
+				for (int row = firstRow; row < lastRow; row++) {
+					const float rowY = DrawTableRow(row, rows[row], weathers);
+					if (row == 0) layout.bodyOffset = rowY - headerY;
+					if (previousRowY >= 0.0f) layout.rowStride = rowY - previousRowY;
+					previousRowY = rowY;
+				}
+				LOG_TRACE(Log::kUI, "Drew rows [{}, {}) of {}", firstRow, lastRow, rowCount);
+
+				DrawSpacerRows(rowCount - lastRow, rowStride);
+				ImGuiMCP::EndTable();
+
+				g_advancedWeatherData.RemoveRow();
+				LOG_TRACE(Log::kUI, "Processed row removals if any");
+				
+				// Add Row button
+				FontAwesome::PushRegular();
+				if (ImGuiMCP::Button(IconLibrary::AddRow.c_str(), ImVec2(-FLT_MIN, 0.0f))) {
+					LOG_TRACE(Log::kUI, "Add row button clicked");
+					g_advancedWeatherData.AddRow();
+					Hooks::BlurManager::GetSingleton().NotifySettingsChanged();
+				}
+				FontAwesome::Pop();
+			}
+		}
+
+		void __stdcall Render() {
+			bool published = false;
+			{
+				std::scoped_lock lock(g_advancedWeatherData.lock);
+				RenderWeatherTable();
+				published = Hooks::BlurManager::GetSingleton().PublishPendingEdits();  // After RemoveRow, once per frame
+			}
+			if (published) Settings::RequestSave();
+		}
+	}
+
+	namespace Diagnostics {
+
+		void DrawLatencyRow(const char* label, std::uint64_t nanoseconds) {
+			ImGuiMCP::TableNextRow();
+			ImGuiMCP::TableNextColumn();
+			ImGuiMCP::Text("%s", label);
+			ImGuiMCP::TableNextColumn();
+			ImGuiMCP::Text("%.2f us", static_cast<double>(nanoseconds) / 1000.0);
+		}
+
+		inline const char* logLevelNames[] = { "Trace", "Debug", "Info", "Warn", "Error", "Critical", "Off" };
+
+		void DrawLogLevels() {
+			auto& logging = Settings::logging;
+			int*  levels[Log::kSubsystemCount] = { &logging.UI, &logging.Hooks, &logging.Settings, &logging.Cache };
+
+			for (std::uint8_t i = 0; i < Log::kSubsystemCount; ++i) {
+				int& level = *levels[i];
+				level      = std::clamp(level, 0, static_cast<int>(std::size(logLevelNames)) - 1);
+
+				ImGuiMCP::SetNextItemWidth(-1.0f);
+				const auto label = std::format("{}##LogLevel", Log::subsystemNames[i]);
+				if (ImGuiMCP::SliderInt(label.c_str(), &level, 0, static_cast<int>(std::size(logLevelNames)) - 1, logLevelNames[level])) {
+					Log::SetLevel(static_cast<Log::Subsystem>(i), level);
+					Settings::RequestSave();
+				}
+				if (ImGuiMCP::IsItemHovered(tooltipFlags)) {
+					ImGuiMCP::SetTooltip("Log level for debug and trace output from the %s subsystem. Trace output is only compiled into debug builds; info, warnings and errors are always logged.", Log::subsystemNames[i]);
+				}
+			}
+		}
+
+		void __stdcall Render() {
+			const auto& latency = Metrics::UpdateLatency();
+			const auto  samples = latency.Count();
+
+			ImGuiMCP::TextDisabled("Update Cost (OnPlayerUpdate)");
+			ImGuiMCP::Separator();
+
+			if (ImGuiMCP::BeginTable("LatencyTable", 2, tableFlags)) {
+				ImGuiMCP::TableSetupColumn("Metric", columnFlags, 175.0f);
+				ImGuiMCP::TableSetupColumn("Value", lastColumnFlags);
+
+				ImGuiMCP::TableNextRow();
+				ImGuiMCP::TableNextColumn();
+				ImGuiMCP::Text("Samples");
+				ImGuiMCP::TableNextColumn();
+				ImGuiMCP::Text("%llu", static_cast<unsigned long long>(samples));
+
+				DrawLatencyRow("Average", samples ? latency.Total() / samples : 0);
+				DrawLatencyRow("p50", latency.Percentile(0.50));
+				DrawLatencyRow("p99", latency.Percentile(0.99));
+				DrawLatencyRow("Max", latency.Max());
+				ImGuiMCP::EndTable();
+			}
+
+			ImGuiMCP::Spacing();
+			ImGuiMCP::TextDisabled("Counters");
+			ImGuiMCP::Separator();
+
+			if (ImGuiMCP::BeginTable("CounterTable", 2, tableFlags)) {
+				ImGuiMCP::TableSetupColumn("Counter", columnFlags, 175.0f);
+				ImGuiMCP::TableSetupColumn("Count", lastColumnFlags);
+
+				for (std::size_t i = 0; i < static_cast<std::size_t>(Metrics::Counter::kCount); ++i) {
+					ImGuiMCP::TableNextRow();
+					ImGuiMCP::TableNextColumn();
+					ImGuiMCP::Text("%s", Metrics::counterNames[i]);
+					ImGuiMCP::TableNextColumn();
+					ImGuiMCP::Text("%llu", static_cast<unsigned long long>(Metrics::Get(static_cast<Metrics::Counter>(i))));
+				}
+				ImGuiMCP::EndTable();
+			}
+
+			ImGuiMCP::Spacing();
+
+			if (ImGuiMCP::Button("Reset Counters", ImVec2(0.0f, 0.0f))) {
+				Metrics::Reset();
+			}
+			ImGuiMCP::SameLine();
+			if (ImGuiMCP::Button("Dump to Log", ImVec2(0.0f, 0.0f))) {
+				Metrics::DumpToLog();
+				Memory::DumpToLog("on request");
+			}
+
+			ImGuiMCP::Spacing();
+
+			if (ImGuiMCP::CollapsingHeader("Memory##header")) {
+				Memory::Refresh();
+
+				if (ImGuiMCP::BeginTable("MemoryTable", 4, tableFlags)) {
+					ImGuiMCP::TableSetupColumn("Subsystem", columnFlags, 175.0f);
+					ImGuiMCP::TableSetupColumn("Held", columnFlags, 100.0f);
+					ImGuiMCP::TableSetupColumn("Blocks", columnFlags, 100.0f);
+					ImGuiMCP::TableSetupColumn("Peak", lastColumnFlags);
+					ImGuiMCP::TableHeadersRow();
+
+					for (std::uint8_t i = 0; i < Memory::kSubsystemCount; ++i) {
+						const auto usage = Memory::Read(static_cast<Memory::Subsystem>(i));
+						ImGuiMCP::TableNextRow();
+						ImGuiMCP::TableNextColumn();
+						ImGuiMCP::Text("%s", Memory::subsystemNames[i]);
+						ImGuiMCP::TableNextColumn();
+						ImGuiMCP::Text("%.1f KiB", static_cast<double>(usage.bytes) / 1024.0);
+						ImGuiMCP::TableNextColumn();
+						ImGuiMCP::Text("%lld", static_cast<long long>(usage.allocations));
+						ImGuiMCP::TableNextColumn();
+						ImGuiMCP::Text("%.1f KiB", static_cast<double>(usage.peakBytes) / 1024.0);
+					}
+					ImGuiMCP::EndTable();
+				}
+				if (ImGuiMCP::IsItemHovered(tooltipFlags)) {
+					ImGuiMCP::SetTooltip("Form caches and JSON are counted as they allocate, weather data is measured from the rows, logging is the size of its message queue.");
+				}
+			}
+
+			ImGuiMCP::Spacing();
+
+			if (ImGuiMCP::CollapsingHeader("Frame Recorder##header")) {
+				if (ImGuiMCP::Checkbox("Record Frames", &Settings::general.FrameRecorder)) {
+					Settings::RequestSave();
+				}
+				if (ImGuiMCP::IsItemHovered(tooltipFlags)) {
+					ImGuiMCP::SetTooltip("Keeps the last %d blur updates in memory. They are written to '%s' if the game crashes.",
+						static_cast<int>(Trace::Ring::capacity), Settings::crashTracePath.c_str());
+				}
+
+				ImGuiMCP::SameLine();
+				if (ImGuiMCP::Button("Dump Trace", ImVec2(0.0f, 0.0f))) {
+					Hooks::BlurManager::GetSingleton().RequestTraceDump();
+				}
+				if (ImGuiMCP::IsItemHovered(tooltipFlags)) {
+					ImGuiMCP::SetTooltip("Writes the recorded frames to '%s' on the next unpaused frame. Replay them with blur-replay from the tools folder.",
+						Settings::frameTracePath.c_str());
+				}
+			}
+
+			ImGuiMCP::Spacing();
+
+			if (ImGuiMCP::CollapsingHeader("Telemetry##header")) {
+				if (ImGuiMCP::Checkbox("Publish Telemetry", &Settings::general.Telemetry)) {
+					Settings::RequestSave();
+				}
+				if (ImGuiMCP::IsItemHovered(tooltipFlags)) {
+					ImGuiMCP::SetTooltip("Writes the applied blur, weather, active rule, update cost and counters to the shared memory block 'Local\\%s' on every update. Read it with blur-telemetry from the tools folder.",
+						Telemetry::blockName);
+				}
+			}
+
+			ImGuiMCP::Spacing();
+
+			if (ImGuiMCP::CollapsingHeader("Log Levels##header")) {
+				DrawLogLevels();
+			}
+		}
+	}
 }
\ No newline at end of file
@@ -1,48 +1,85 @@
-#include "PCH.h"
-#include "Manager.h"
-#include "Hooks.h"
-#include "Utils.h"
-
-namespace Manager {
-	/**
-	* @brief The main initialization function for the mod logic.
-	* Called from the SKSE plugin entry point after game data is loaded.
-	*/
-	void Initialize() {
-		settingsPath = settingsPathString.c_str(); // Fuck dangling pointers
-		Logger::trace("Manager: Mod name set to {} | Settings path set to {}", modName, settingsPath);
-
-		InitializeFormCaches();
-
-		Settings::LoadAll();
-
-		Hooks::InstallHooks();
-
-		Logger::info("Manager: Exiting, {} Initialization finished.", modName);
-	}
-
-	void InitializeFormCaches() {
-		Logger::info("Initializing form caches...");
-
-		Utils::CountAndCacheForms<RE::TESWeather>();
-
-		auto iMADProcessingLogic = [&](RE::TESImageSpaceModifier* imageAdapter) {
-			if (imageAdapter->GetFormID() == 0x2FBB2) {
-				Logger::trace("Found Vanilla Image Adapter, FormID: {:x}, EditorID: {}, using this record as a source form.",
-					imageAdapter->GetFormID(), clib_util::editorID::get_editorID(imageAdapter));
-
-				Hooks::BlurManager::GetSingleton().SetSourceIMOD(imageAdapter);
-				RE::TESFile* targetFile = imageAdapter->GetFile(0);
-
-				Logger::trace("Setting targetFile to plugin: {}", targetFile->GetFilename());
-			}
-		};
-
-		Utils::CountAndCacheForms<RE::TESImageSpaceModifier>(iMADProcessingLogic);
-
-		const auto& weatherNames = Utils::g_formCache[std::type_index(typeid(RE::TESWeather))];
-		const auto& iMADNames    = Utils::g_formCache[std::type_index(typeid(RE::TESImageSpaceModifier))];
-
-		Logger::info("Found {} weathers and {} IMADs in the cache.", weatherNames.size(), iMADNames.size());
-	}
+#include "PCH.h"
+#include "Manager.h"
+#include "Hooks.h"
+#include "Logger.h"
+#include "Utils.h"
+
+namespace Manager {
+	/**
+	* @brief The main initialization function for the mod logic.
+	* Called from the SKSE plugin entry point after game data is loaded.
+	*/
+	void Initialize() {
+		settingsPath = settingsPathString.c_str(); // Fuck dangling pointers
+		LOG_TRACE(Log::kCache, "Manager: Mod name set to {} | Settings path set to {}", modName, settingsPath);
+
+		using Clock = std::chrono::steady_clock;
+		const auto  initStart  = Clock::now();
+		auto        phaseStart = initStart;
+		std::string phases;
+
+		// Adds the phase that just finished to the summary below
+		const auto endPhase = [&](std::string_view a_phase) {
+			const auto now = Clock::now();
+			phases += std::format("{}{} {:.2f} ms", phases.empty() ? "" : ", ", a_phase, std::chrono::duration<double, std::milli>(now - phaseStart).count());
+			phaseStart = now;
+		};
+
+		InitializeFormCaches();
+		endPhase("form caches");
+
+		Settings::LoadAll();
+		endPhase("settings");
+
+		Settings::StartWatcher([](const Settings::RowDiff& a_diff) { Hooks::BlurManager::GetSingleton().PublishSettings(&a_diff); });
+		endPhase("watcher");
+
+		Hooks::InstallHooks();
+		endPhase("hooks");
+
+		// Needs ExtraChecks from the INI, and reports on its own thread whenever it is done
+		Utils::StartFormValidation();
+
+		// IMAD names only served to find the source IMOD, the validation pass above took its own copy
+		Utils::g_formCache<RE::TESImageSpaceModifier>.Release();
+
+		Logger::info("Manager: Exiting, {} Initialization finished in {:.2f} ms ({}).", modName,
+			std::chrono::duration<double, std::milli>(Clock::now() - initStart).count(), phases);
+		Memory::DumpToLog("after startup");
+	}
+
+	void InitializeFormCaches() {
+		Logger::info("Initializing form caches...");
+		const auto start = std::chrono::steady_clock::now();
+
+		Utils::CountAndCacheForms<RE::TESWeather>();
+
+		auto iMADProcessingLogic = [&](RE::TESImageSpaceModifier* imageAdapter) {
+			if (imageAdapter->GetFormID() == 0x2FBB2) {
+				LOG_TRACE(Log::kCache, "Found Vanilla Image Adapter, FormID: {:x}, EditorID: {}, using this record as a source form.",
+					imageAdapter->GetFormID(), clib_util::editorID::get_editorID(imageAdapter));
+
+				Hooks::BlurManager::GetSingleton().SetSourceIMOD(imageAdapter);
+				RE::TESFile* targetFile = imageAdapter->GetFile(0);
+
+				LOG_TRACE(Log::kCache, "Setting targetFile to plugin: {}", targetFile->GetFilename());
+			}
+		};
+
+		Utils::CountAndCacheForms<RE::TESImageSpaceModifier>(iMADProcessingLogic);
+
+		// Context rules and blur zones name these, and their settings are resolved off the game thread
+		Utils::CountAndCacheForms<RE::TESWorldSpace>();
+		Utils::CountAndCacheForms<RE::BGSKeyword>();
+
+		const auto& weathers    = Utils::g_formCache<RE::TESWeather>;
+		const auto& iMADs       = Utils::g_formCache<RE::TESImageSpaceModifier>;
+		const auto& worldspaces = Utils::g_formCache<RE::TESWorldSpace>;
+		const auto& keywords    = Utils::g_formCache<RE::BGSKeyword>;
+
+		Utils::FormCacheFile::Commit();
+
+		Logger::info("Found {} weathers, {} IMADs, {} worldspaces and {} keywords in the cache.", weathers.Size(), iMADs.Size(), worldspaces.Size(), keywords.Size());
+		Logger::info("Form caches ready in {:.2f} ms.", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
 }
\ No newline at end of file
@@ -0,0 +1,26 @@
+#include "PCH.h"
+#include "Memory.h"
+#include "Logger.h"
+#include "MCP.h"
+
+namespace Memory {
+
+	void Refresh() {
+		auto&            advanced = MCP::Advanced::g_advancedWeatherData;
+		std::scoped_lock lock(advanced.lock);
+		advanced.MeasureMemory();
+	}
+
+	void DumpToLog(std::string_view a_when) {
+		Refresh();
+
+		std::int64_t total = 0;
+		for (std::uint8_t i = 0; i < kSubsystemCount; ++i) {
+			const auto usage = Read(static_cast<Subsystem>(i));
+			total += usage.bytes;
+			Logger::info("Memory: {:<12} {:>8.1f} KiB in {} blocks, {} allocations so far, peak {:.1f} KiB.", subsystemNames[i], usage.bytes / 1024.0,
+				usage.allocations, usage.totalAllocations, usage.peakBytes / 1024.0);
+		}
+		Logger::info("Memory: {:.1f} KiB held {}.", total / 1024.0, a_when);
+	}
+}
@@ -0,0 +1,117 @@
+#include "PCH.h"
+#include "Metrics.h"
+
+namespace Metrics {
+
+	namespace {
+		std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(Counter::kCount)> counters{};
+		LatencyHistogram                                                                 updateLatency;
+	}
+
+	// ============================================================
+	// Histogram
+	// ============================================================
+
+	std::size_t LatencyHistogram::BucketFor(std::uint64_t a_nanoseconds) {
+		constexpr std::uint64_t subBuckets = 1ull << subBucketBits;
+		if (a_nanoseconds < subBuckets) {
+			return static_cast<std::size_t>(a_nanoseconds);
+		}
+
+		const auto msb    = static_cast<std::size_t>(std::bit_width(a_nanoseconds) - 1);
+		const auto sub    = static_cast<std::size_t>((a_nanoseconds >> (msb - subBucketBits)) & (subBuckets - 1));
+		const auto bucket = ((msb - subBucketBits + 1) << subBucketBits) + sub;
+		return std::min(bucket, bucketCount - 1);
+	}
+
+	std::uint64_t LatencyHistogram::UpperBound(std::size_t a_bucket) {
+		constexpr std::size_t subBuckets = 1ull << subBucketBits;
+		if (a_bucket < subBuckets) {
+			return a_bucket;
+		}
+
+		const auto msb   = (a_bucket >> subBucketBits) + subBucketBits - 1;
+		const auto sub   = a_bucket & (subBuckets - 1);
+		const auto width = 1ull << (msb - subBucketBits);
+		return ((subBuckets + sub) << (msb - subBucketBits)) + width - 1;
+	}
+
+	void LatencyHistogram::Record(std::uint64_t a_nanoseconds) {
+		_buckets[BucketFor(a_nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+		_count.fetch_add(1, std::memory_order_relaxed);
+		_total.fetch_add(a_nanoseconds, std::memory_order_relaxed);
+
+		// Single writer, so a plain compare is enough to keep the maximum.
+		if (a_nanoseconds > _max.load(std::memory_order_relaxed)) {
+			_max.store(a_nanoseconds, std::memory_order_relaxed);
+		}
+	}
+
+	void LatencyHistogram::Reset() {
+		for (auto& bucket : _buckets) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		_count.store(0, std::memory_order_relaxed);
+		_total.store(0, std::memory_order_relaxed);
+		_max.store(0, std::memory_order_relaxed);
+	}
+
+	std::uint64_t LatencyHistogram::Percentile(double a_percentile) const {
+		const auto count = Count();
+		if (!count) return 0;
+
+		const auto    target     = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(a_percentile * static_cast<double>(count))));
+		std::uint64_t cumulative = 0;
+
+		for (std::size_t i = 0; i < bucketCount; ++i) {
+			cumulative += _buckets[i].load(std::memory_order_relaxed);
+			if (cumulative >= target) {
+				return std::min(UpperBound(i), Max());
+			}
+		}
+		return Max();
+	}
+
+	// ============================================================
+	// Counters
+	// ============================================================
+
+	void Increment(Counter a_counter, std::uint64_t a_amount) {
+		counters[static_cast<std::size_t>(a_counter)].fetch_add(a_amount, std::memory_order_relaxed);
+	}
+
+	std::uint64_t Get(Counter a_counter) {
+		return counters[static_cast<std::size_t>(a_counter)].load(std::memory_order_relaxed);
+	}
+
+	LatencyHistogram& UpdateLatency() {
+		return updateLatency;
+	}
+
+	void Reset() {
+		for (auto& counter : counters) {
+			counter.store(0, std::memory_order_relaxed);
+		}
+		updateLatency.Reset();
+		Logger::info("Metrics: Counters reset.");
+	}
+
+	void DumpToLog() {
+		const auto& latency = UpdateLatency();
+		const auto  count   = latency.Count();
+
+		Logger::info("Metrics: ---- Diagnostics Dump ----");
+		Logger::info("Metrics: OnPlayerUpdate latency over {} samples: avg {} ns, p50 {} ns, p99 {} ns, max {} ns",
+			count,
+			count ? latency.Total() / count : 0,
+			latency.Percentile(0.50),
+			latency.Percentile(0.99),
+			latency.Max());
+
+		for (std::size_t i = 0; i < static_cast<std::size_t>(Counter::kCount); ++i) {
+			Logger::info("Metrics: {}: {}", counterNames[i], Get(static_cast<Counter>(i)));
+		}
+		Logger::info("Metrics: ---------------------------");
+		spdlog::default_logger()->flush();
+	}
+}
@@ -1,190 +1,930 @@
-#include "PCH.h"
-#include "Settings.h"
-#include "Utils.h"
-
-#include <rapidjson/document.h>
-#include <rapidjson/writer.h>
-#include <rapidjson/stringbuffer.h>
-
-
-namespace Settings {
-
-    // ============================================================
-    // Core Control
-    // ============================================================
-
-    void LoadAll() {
-        Logger::info("Settings: Loading INI and JSON...");
-        INI::Load();
-        Json::Load();
-		Logger::info("Settings: All settings loaded.");
-    }
-
-    void SaveAll() {
-        Logger::info("Settings: Saving INI and JSON...");
-        INI::Save();
-        Json::Save();
-		Logger::info("Settings: All settings saved.");
-    }
-
-    void ResetAll() {
-        Logger::info("Settings: Resetting all settings to defaults...");
-        INI::Reset();
-        Json::Clear();
-        Json::Save();
-		Logger::info("Settings: All settings reset to defaults.");
-    }
-
-    // ============================================================
-    // INI Handling
-    // ============================================================
-
-    namespace INI {
-
-        bool Load() {
-            CSimpleIniW ini;
-            ini.SetUnicode();
-
-            if (!std::filesystem::exists(settingsPath)) {
-                Logger::warn("Settings: No INI found, creating new defaults at {}", settingsPath);
-                Reset();
-                Save();
-                return false;
-            }
-
-            ini.LoadFile(settingsPath);
-
-            general.BlurType                = static_cast<int>(ini.GetLongValue(L"General", L"BlurType", general.BlurType)); // Change to BlurMode
-			general.ExtraChecks             = ini.GetBoolValue(L"General", L"ExtraChecks", general.ExtraChecks);
-			general.VerboseLogging          = ini.GetBoolValue(L"General", L"VerboseLogging", general.VerboseLogging);
-
-            Logger::info("Settings: INI loaded successfully.");
-			return true;
-        }
-
-        bool Save() {
-            CSimpleIniW ini;
-            ini.SetUnicode();
-
-            ini.SetLongValue(L"General", L"BlurType", general.BlurType, L"; Blur Type (0 = None, 1 = Advanced)");
-			ini.SetBoolValue(L"General", L"ExtraChecks", general.ExtraChecks, L"; Enable Extra Safety Checks");
-			ini.SetBoolValue(L"General", L"VerboseLogging", general.VerboseLogging, L"; Enable Verbose Logging");
-
-            ini.SaveFile(settingsPath);
-
-            Logger::info("Settings: INI saved successfully.");
-			return true;
-        }
-
-        void Reset() {
-            general = GeneralSettings{};
-            Save();
-            Logger::info("Settings: INI reset to defaults.");
-        }
-    }
-
-    // ============================================================
-    // JSON Weather Handling
-    // ============================================================
-
-    namespace Json {
-        using namespace rapidjson;
-
-        void Clear() {
-            MCP::Advanced::g_advancedWeatherData.settings.clear();
-        }
-
-        bool Load() {
-            Clear(); // Ensure list is empty before loading
-            Logger::info("Settings::Weather: Loading JSON from '{}'", weatherListPath);
-
-            if (!std::filesystem::exists(weatherListPath)) {
-                Logger::warn("Settings::Weather: File '{}' does not exist. A new one will be created on save.", weatherListPath);
-                return false;
-            }
-
-            std::ifstream file(weatherListPath);
-            if (!file.is_open()) {
-                Logger::error("Settings::Weather: Could not open '{}'", weatherListPath);
-                return false;
-            }
-
-            std::string jsonContent((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-            file.close();
-
-            Document doc;
-            doc.Parse(jsonContent.c_str());
-
-            if (doc.HasParseError() || !doc.HasMember("MCP")) {
-                Logger::error("Settings::Weather: Invalid JSON format.");
-                return false;
-            }
-
-            const auto& mcp           = doc["MCP"];
-            if (!mcp.HasMember("Advanced")) return true; // Valid JSON, just no settings yet
-
-            const auto& advancedBlock = mcp["Advanced"];
-            if (!advancedBlock.HasMember("WeatherSettings")) return true;
-
-            const auto& settingsArray = advancedBlock["WeatherSettings"];
-            if (!settingsArray.IsArray()) return true;
-
-            for (const auto& row : settingsArray.GetArray()) {
-                MCP::Advanced::WeatherSettingRow entryRow;
-                entryRow.rowToggle       = row.HasMember("rowToggle")    ? row["rowToggle"].GetBool()     : true;
-                entryRow.rowWeatherType  = row.HasMember("rowWeather")   ? row["rowWeather"].GetString()  : "None";
-                entryRow.rowBlurStrength = row.HasMember("blurStrength") ? row["blurStrength"].GetFloat() : 1.0f;
-                entryRow.rowBlurRange    = row.HasMember("blurRange")    ? row["blurRange"].GetFloat()    : 100.0f;
-                entryRow.rowStaticToggle = row.HasMember("staticToggle") ? row["staticToggle"].GetBool()  : false;
-
-                MCP::Advanced::g_advancedWeatherData.settings.push_back(entryRow);
-            }
-
-            Logger::info("Settings::Weather: Loaded {} weather rows.", MCP::Advanced::g_advancedWeatherData.settings.size());
-            return true;
-        }
-
-        bool Save() {
-
-            Logger::info("Settings::Weather: Saving to '{}'", weatherListPath);
-
-            Document doc;
-            doc.SetObject();
-            auto& alloc = doc.GetAllocator();
-
-            Value mcp(kObjectType);
-            Value advanced(kObjectType);
-            Value settingsArray(kArrayType);
-
-            for (const auto& row : MCP::Advanced::g_advancedWeatherData.settings) {
-                Value rowObj(kObjectType);
-                rowObj.AddMember("rowToggle", row.rowToggle, alloc);
-                rowObj.AddMember("rowWeather", Value(row.rowWeatherType.c_str(), alloc), alloc);
-                rowObj.AddMember("blurStrength", row.rowBlurStrength, alloc);
-                rowObj.AddMember("blurRange", row.rowBlurRange, alloc);
-                rowObj.AddMember("staticToggle", row.rowStaticToggle, alloc);
-                settingsArray.PushBack(rowObj, alloc);
-            }
-
-            advanced.AddMember("WeatherSettings", settingsArray, alloc);
-            mcp.AddMember("Advanced", advanced, alloc);
-            doc.AddMember("MCP", mcp, alloc);
-
-            StringBuffer         buffer;
-            Writer<StringBuffer> writer(buffer);
-
-            doc.Accept(writer);
-
-            std::ofstream file(weatherListPath);
-            if (!file.is_open()) {
-                Logger::error("Settings::Weather: Failed to write file.");
-                return false;
-            }
-
-            file << buffer.GetString();
-            file.close();
-            Logger::info("Settings::Weather: Saved successfully.");
-            return true;
-        }
-    }
-}
\ No newline at end of file
+#include "PCH.h"
+#include "Settings.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "Persistence.h"
+#include "SettingsSnapshot.h"
+#include "Utils.h"
+
+#include <rapidjson/document.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace Settings {
+
+    // ============================================================
+    // File Persistence
+    // ============================================================
+
+    namespace {
+        std::mutex    writeLock;
+        std::uint64_t iniHash  = 0;
+        std::uint64_t jsonHash = 0;
+
+        /**
+         * @brief Writes a file unless its content hash matches the last persisted content.
+         * @return true if the file was written.
+         */
+        bool Persist(const std::filesystem::path& a_path, std::string_view a_content, std::uint64_t& a_lastHash, bool a_force) {
+            const auto hash = Utils::HashBytes(a_content);
+
+            std::scoped_lock lock(writeLock);
+            if (!a_force && hash == a_lastHash) {
+                return false;
+            }
+            if (!Utils::WriteFileAtomic(a_path, a_content)) {
+                return false;
+            }
+            a_lastHash = hash;
+            Metrics::Increment(Metrics::Counter::kSettingsSaves);
+            return true;
+        }
+
+        struct Snapshot {
+            GeneralSettings                                general;
+            LoggingSettings                                logging;
+            std::vector<MCP::Advanced::WeatherSettingRow> rows;
+            std::vector<MCP::Advanced::ContextRuleRow>    rules;
+            std::vector<MCP::Advanced::BlurZoneRow>       zones;
+        };
+
+        void Write(const Snapshot& a_snapshot) {
+            const auto json        = Json::Serialize(a_snapshot.rows, a_snapshot.rules, a_snapshot.zones);
+            const bool iniWritten  = Persist(settingsPath, INI::Serialize(a_snapshot.general, a_snapshot.logging), iniHash, false);
+            const bool jsonWritten = Persist(weatherListPath, json, jsonHash, false);
+
+            if (jsonWritten) {
+                Binary::Save(a_snapshot.rows, a_snapshot.rules, a_snapshot.zones, json);
+            }
+
+            if (iniWritten || jsonWritten) {
+                Logger::info("Settings: Persisted changes (INI: {}, JSON: {}).", iniWritten, jsonWritten);
+            } else {
+                LOG_DEBUG(Log::kSettings, "Settings: Skipped save, content unchanged.");
+            }
+        }
+
+        // UI edits are snapshotted and written by a background thread once they stop coming
+        Persistence::Debouncer<Snapshot>& Saver() {
+            static Persistence::Debouncer<Snapshot> instance(saveDebounce, Write);
+            return instance;
+        }
+    }
+
+    void RequestSave() {
+        auto& advanced = MCP::Advanced::g_advancedWeatherData;
+
+        std::unique_lock lock(advanced.lock);
+        Snapshot         snapshot{ general, logging, advanced.settings, advanced.rules, advanced.zones };
+        lock.unlock();
+
+        Saver().Request(std::move(snapshot));
+    }
+
+    void FlushSave() {
+        Saver().Flush();
+    }
+
+    // ============================================================
+    // Core Control
+    // ============================================================
+
+    void LoadAll() {
+        Logger::info("Settings: Loading INI and JSON...");
+        INI::Load();
+        Json::Load();
+
+        // Seed the content hashes so edits that end up back at the loaded values are never written
+        {
+            std::scoped_lock lock(writeLock);
+            iniHash  = Utils::HashBytes(INI::Serialize(general, logging));
+            jsonHash = Utils::HashBytes(Json::Serialize(MCP::Advanced::g_advancedWeatherData.settings, MCP::Advanced::g_advancedWeatherData.rules,
+                MCP::Advanced::g_advancedWeatherData.zones));
+        }
+		Logger::info("Settings: All settings loaded.");
+    }
+
+    void SaveAll() {
+        Logger::info("Settings: Saving INI and JSON...");
+        INI::Save();
+        Json::Save();
+		Logger::info("Settings: All settings saved.");
+    }
+
+    void ResetAll() {
+        Logger::info("Settings: Resetting all settings to defaults...");
+        INI::Reset();
+        Json::Clear();
+        Json::Save();
+		Logger::info("Settings: All settings reset to defaults.");
+    }
+
+    // ============================================================
+    // INI Handling
+    // ============================================================
+
+    namespace INI {
+
+        namespace {
+            struct TuningKey {
+                const wchar_t*          key;
+                float AutoBlur::Tuning::*member;
+                const wchar_t*          comment;
+            };
+
+            // [Automatic], in file order
+            constexpr TuningKey tuningKeys[] = {
+                { L"ClearFogFar", &AutoBlur::Tuning::clearFogFar, L"; Automatic mode: fog far distance at or beyond which a weather counts as clear, and at or below which it counts as dense" },
+                { L"DenseFogFar", &AutoBlur::Tuning::denseFogFar, nullptr },
+                { L"FogCurve", &AutoBlur::Tuning::fogCurve, L"; Exponent on the fog density between the two, above 1 keeps light haze sharper" },
+                { L"ClearStrength", &AutoBlur::Tuning::clearStrength, L"; Blur strength and range (same units as the weather table) at the clear and dense ends" },
+                { L"DenseStrength", &AutoBlur::Tuning::denseStrength, nullptr },
+                { L"ClearRange", &AutoBlur::Tuning::clearRange, nullptr },
+                { L"DenseRange", &AutoBlur::Tuning::denseRange, nullptr },
+                { L"PleasantScale", &AutoBlur::Tuning::pleasantScale, L"; Strength multiplier by weather classification" },
+                { L"CloudyScale", &AutoBlur::Tuning::cloudyScale, nullptr },
+                { L"RainyScale", &AutoBlur::Tuning::rainyScale, nullptr },
+                { L"SnowScale", &AutoBlur::Tuning::snowScale, nullptr },
+                { L"PrecipitationStrength", &AutoBlur::Tuning::precipitationStrength, L"; Strength added for weathers with rain or snow particles" },
+                { L"MinStrength", &AutoBlur::Tuning::minStrength, L"; Weathers that come out weaker than this get no blur" },
+                { L"TransitionDuration", &AutoBlur::Tuning::transitionDuration, L"; Seconds to fade into a derived weather" },
+            };
+
+            void Read(const CSimpleIniW& a_ini, GeneralSettings& a_general, LoggingSettings& a_logging) {
+                a_general.BlurType              = static_cast<int>(a_ini.GetLongValue(L"General", L"BlurType", a_general.BlurType)); // Change to BlurMode
+                a_general.ExtraChecks           = a_ini.GetBoolValue(L"General", L"ExtraChecks", a_general.ExtraChecks);
+                a_general.VerboseLogging        = a_ini.GetBoolValue(L"General", L"VerboseLogging", a_general.VerboseLogging);
+                a_general.FrameRecorder         = a_ini.GetBoolValue(L"General", L"FrameRecorder", a_general.FrameRecorder);
+                a_general.Telemetry             = a_ini.GetBoolValue(L"General", L"Telemetry", a_general.Telemetry);
+
+                for (const auto& tuning : tuningKeys) {
+                    auto& value = a_general.Automatic.*tuning.member;
+                    value       = static_cast<float>(a_ini.GetDoubleValue(L"Automatic", tuning.key, value));
+                }
+
+                a_logging.UI                    = static_cast<int>(a_ini.GetLongValue(L"Logging", L"UILevel", a_logging.UI));
+                a_logging.Hooks                 = static_cast<int>(a_ini.GetLongValue(L"Logging", L"HooksLevel", a_logging.Hooks));
+                a_logging.Settings              = static_cast<int>(a_ini.GetLongValue(L"Logging", L"SettingsLevel", a_logging.Settings));
+                a_logging.Cache                 = static_cast<int>(a_ini.GetLongValue(L"Logging", L"CacheLevel", a_logging.Cache));
+            }
+        }
+
+        bool Parse(std::string_view a_content, GeneralSettings& a_general, LoggingSettings& a_logging) {
+            CSimpleIniW ini;
+            ini.SetUnicode();
+            if (ini.LoadData(a_content.data(), a_content.size()) < 0) {
+                return false;
+            }
+            Read(ini, a_general, a_logging);
+            return true;
+        }
+
+        bool Load() {
+            CSimpleIniW ini;
+            ini.SetUnicode();
+
+            if (!std::filesystem::exists(settingsPath)) {
+                Logger::warn("Settings: No INI found, creating new defaults at {}", settingsPath);
+                Reset();
+                Save();
+                return false;
+            }
+
+            ini.LoadFile(settingsPath);
+            Read(ini, general, logging);
+            ApplyLogLevels();
+
+            Logger::info("Settings: INI loaded successfully.");
+			return true;
+        }
+
+        std::string Serialize(const GeneralSettings& a_general, const LoggingSettings& a_logging) {
+            CSimpleIniW ini;
+            ini.SetUnicode();
+
+            ini.SetLongValue(L"General", L"BlurType", a_general.BlurType, L"; Blur Type (0 = None, 1 = Advanced, 2 = Automatic)");
+			ini.SetBoolValue(L"General", L"ExtraChecks", a_general.ExtraChecks, L"; Validate weather and IMAD forms in the background after load, and log a summary");
+			ini.SetBoolValue(L"General", L"VerboseLogging", a_general.VerboseLogging, L"; Enable Verbose Logging");
+			ini.SetBoolValue(L"General", L"FrameRecorder", a_general.FrameRecorder, L"; Keep the last frames of blur updates for a trace dump (Diagnostics page, or on a crash)");
+			ini.SetBoolValue(L"General", L"Telemetry", a_general.Telemetry, L"; Publish the live blur state to shared memory for external overlays and profilers");
+
+            for (const auto& tuning : tuningKeys) {
+                ini.SetDoubleValue(L"Automatic", tuning.key, a_general.Automatic.*tuning.member, tuning.comment);
+            }
+
+            ini.SetLongValue(L"Logging", L"UILevel", a_logging.UI, L"; Log levels per subsystem (0 = Trace, 1 = Debug, 2 = Info, 3 = Warn, 4 = Error, 5 = Critical, 6 = Off)");
+            ini.SetLongValue(L"Logging", L"HooksLevel", a_logging.Hooks);
+            ini.SetLongValue(L"Logging", L"SettingsLevel", a_logging.Settings);
+            ini.SetLongValue(L"Logging", L"CacheLevel", a_logging.Cache);
+
+            std::string content;
+            ini.Save(content, true);
+            return content;
+        }
+
+        bool Save() {
+            if (!Persist(settingsPath, Serialize(general, logging), iniHash, true)) {
+                Logger::error("Settings: Failed to save INI.");
+                return false;
+            }
+
+            Logger::info("Settings: INI saved successfully.");
+			return true;
+        }
+
+        void ApplyLogLevels() {
+            Log::SetLevel(Log::kUI, logging.UI);
+            Log::SetLevel(Log::kHooks, logging.Hooks);
+            Log::SetLevel(Log::kSettings, logging.Settings);
+            Log::SetLevel(Log::kCache, logging.Cache);
+        }
+
+        void Reset() {
+            general = GeneralSettings{};
+            logging = LoggingSettings{};
+            ApplyLogLevels();
+            Save();
+            Logger::info("Settings: INI reset to defaults.");
+        }
+    }
+
+    // ============================================================
+    // JSON Weather Handling
+    // ============================================================
+
+    namespace Json {
+        using namespace rapidjson;
+
+        // Every document and write buffer is booked under Memory::kJson
+        using Document     = GenericDocument<UTF8<>, MemoryPoolAllocator<Memory::JsonAllocator>, Memory::JsonAllocator>;
+        using Value        = Document::ValueType;
+        using StringBuffer = GenericStringBuffer<UTF8<>, Memory::JsonAllocator>;
+        using JsonWriter   = Writer<StringBuffer, UTF8<>, UTF8<>, Memory::JsonAllocator>;
+
+        namespace {
+            // Typed reads for hand-edited files: a missing key or a value of the wrong type gives the default
+            // instead of tripping RapidJSON's type assertions
+            bool ReadBool(const Value& a_object, const char* a_key, bool a_default) {
+                const auto member = a_object.FindMember(a_key);
+                return member != a_object.MemberEnd() && member->value.IsBool() ? member->value.GetBool() : a_default;
+            }
+
+            int ReadInt(const Value& a_object, const char* a_key, int a_default) {
+                const auto member = a_object.FindMember(a_key);
+                return member != a_object.MemberEnd() && member->value.IsInt() ? member->value.GetInt() : a_default;
+            }
+
+            float ReadFloat(const Value& a_object, const char* a_key, float a_default) {
+                const auto member = a_object.FindMember(a_key);
+                return member != a_object.MemberEnd() && member->value.IsNumber() ? member->value.GetFloat() : a_default;
+            }
+
+            std::string ReadString(const Value& a_object, const char* a_key, const char* a_default) {
+                const auto member = a_object.FindMember(a_key);
+                if (member == a_object.MemberEnd() || !member->value.IsString()) return a_default;
+                return { member->value.GetString(), member->value.GetStringLength() };
+            }
+        }
+
+        void Clear() {
+            MCP::Advanced::g_advancedWeatherData.settings.clear();
+            MCP::Advanced::g_advancedWeatherData.rules.clear();
+            MCP::Advanced::g_advancedWeatherData.zones.clear();
+            MCP::Advanced::g_advancedWeatherData.RebuildUsedWeathers();
+        }
+
+        bool Parse(std::string_view a_content, std::vector<MCP::Advanced::WeatherSettingRow>& a_rows, std::vector<MCP::Advanced::ContextRuleRow>& a_rules,
+            std::vector<MCP::Advanced::BlurZoneRow>& a_zones) {
+            Document doc;
+            doc.Parse(a_content.data(), a_content.size());
+
+            if (doc.HasParseError() || !doc.IsObject() || !doc.HasMember("MCP")) {
+                return false;
+            }
+
+            const auto& mcp           = doc["MCP"];
+            if (!mcp.IsObject()) return false;
+            if (!mcp.HasMember("Advanced")) return true; // Valid JSON, just no settings yet
+
+            const auto& advancedBlock = mcp["Advanced"];
+            if (!advancedBlock.IsObject()) return false;
+
+            if (advancedBlock.HasMember("ContextRules") && advancedBlock["ContextRules"].IsArray()) {
+                for (const auto& rule : advancedBlock["ContextRules"].GetArray()) {
+                    if (!rule.IsObject()) continue;
+                    MCP::Advanced::ContextRuleRow entryRule;
+                    entryRule.ruleToggle       = ReadBool(rule, "ruleToggle", true);
+                    entryRule.ruleWeatherType  = ReadString(rule, "weather", "Any");
+                    entryRule.ruleCell         = ReadInt(rule, "cell", 0);
+                    entryRule.ruleWorldspace   = ReadString(rule, "worldspace", "Any");
+                    entryRule.ruleHourStart    = ReadInt(rule, "hourStart", 0);
+                    entryRule.ruleHourEnd      = ReadInt(rule, "hourEnd", 0);
+                    entryRule.ruleBlurStrength = ReadFloat(rule, "blurStrength", 1.0f);
+                    entryRule.ruleBlurRange    = ReadFloat(rule, "blurRange", 100.0f);
+                    entryRule.ruleStaticToggle = ReadBool(rule, "staticToggle", false);
+
+                    if (rule.HasMember("keywords") && rule["keywords"].IsArray()) {
+                        for (const auto& keyword : rule["keywords"].GetArray()) {
+                            if (keyword.IsString()) entryRule.ruleKeywords.emplace_back(keyword.GetString());
+                        }
+                    }
+                    a_rules.push_back(std::move(entryRule));
+                }
+            }
+
+            if (advancedBlock.HasMember("BlurZones") && advancedBlock["BlurZones"].IsArray()) {
+                // [x, y, z] in game units, missing components are 0
+                const auto point = [](const auto& a_zone, const char* a_key) {
+                    std::array<float, 3> value{};
+                    if (a_zone.HasMember(a_key) && a_zone[a_key].IsArray()) {
+                        const auto& components = a_zone[a_key];
+                        for (rapidjson::SizeType i = 0; i < std::min<rapidjson::SizeType>(components.Size(), 3); i++) {
+                            if (components[i].IsNumber()) value[i] = components[i].GetFloat();
+                        }
+                    }
+                    return value;
+                };
+
+                for (const auto& zone : advancedBlock["BlurZones"].GetArray()) {
+                    if (!zone.IsObject()) continue;
+                    MCP::Advanced::BlurZoneRow entryZone;
+                    entryZone.zoneToggle       = ReadBool(zone, "zoneToggle", true);
+                    entryZone.zoneWorldspace   = ReadString(zone, "worldspace", "Tamriel");
+                    entryZone.zoneShape        = ReadString(zone, "shape", "sphere") == "box" ? 1 : 0;
+                    entryZone.zoneCenter       = point(zone, "center");
+                    entryZone.zoneRadius       = ReadFloat(zone, "radius", 0.0f);
+                    entryZone.zoneMin          = point(zone, "min");
+                    entryZone.zoneMax          = point(zone, "max");
+                    entryZone.zoneBlurStrength = ReadFloat(zone, "blurStrength", 1.0f);
+                    entryZone.zoneBlurRange    = ReadFloat(zone, "blurRange", 100.0f);
+                    entryZone.zoneFalloff      = std::max(ReadFloat(zone, "falloff", 0.0f), 0.0f);
+                    a_zones.push_back(std::move(entryZone));
+                }
+            }
+
+            if (!advancedBlock.HasMember("WeatherSettings")) return true;
+
+            const auto& settingsArray = advancedBlock["WeatherSettings"];
+            if (!settingsArray.IsArray()) return true;
+
+            for (const auto& row : settingsArray.GetArray()) {
+                if (!row.IsObject()) continue;
+                MCP::Advanced::WeatherSettingRow entryRow;
+                entryRow.rowToggle       = ReadBool(row, "rowToggle", true);
+                entryRow.rowWeatherType  = ReadString(row, "rowWeather", "None");
+                entryRow.rowBlurStrength = ReadFloat(row, "blurStrength", 1.0f);
+                entryRow.rowBlurRange    = ReadFloat(row, "blurRange", 100.0f);
+                entryRow.rowStaticToggle = ReadBool(row, "staticToggle", false);
+                entryRow.rowDuration     = std::max(ReadFloat(row, "transitionDuration", Easing::defaultDuration), 0.0f);
+
+                if (row.HasMember("easing") && row["easing"].IsString()) {
+                    if (const auto easing = Easing::CurveFromName({ row["easing"].GetString(), row["easing"].GetStringLength() })) {
+                        entryRow.rowEasing = *easing;
+                    } else {
+                        Logger::warn("Settings::Weather: Unknown easing '{}' on row '{}', using '{}'.", row["easing"].GetString(), entryRow.rowWeatherType,
+                            Easing::curveNames[Easing::defaultCurve]);
+                    }
+                }
+
+                if (row.HasMember("curve") && row["curve"].IsArray()) {
+                    for (const auto& key : row["curve"].GetArray()) {
+                        if (!key.IsObject()) continue;
+                        TimeCurve::Keyframe keyframe;
+                        keyframe.hour     = ReadFloat(key, "hour", 0.0f);
+                        keyframe.strength = ReadFloat(key, "blurStrength", entryRow.rowBlurStrength);
+                        keyframe.range    = ReadFloat(key, "blurRange", entryRow.rowBlurRange);
+                        entryRow.rowCurve.push_back(keyframe);
+                    }
+                }
+
+                // { "tintAlpha": 0.4, ... }, DOF is the row's own strength and range so those keys are not accepted here
+                if (row.HasMember("channels") && row["channels"].IsObject()) {
+                    for (const auto& member : row["channels"].GetObject()) {
+                        const auto channel = Imod::ChannelFromName({ member.name.GetString(), member.name.GetStringLength() });
+                        if (!channel || ((1u << *channel) & Imod::dofMask) || !member.value.IsNumber()) {
+                            Logger::warn("Settings::Weather: Ignoring IMOD channel '{}' on row '{}'.", member.name.GetString(), entryRow.rowWeatherType);
+                            continue;
+                        }
+                        entryRow.rowChannels.push_back({ *channel, member.value.GetFloat() });
+                    }
+                }
+
+                a_rows.push_back(std::move(entryRow));
+            }
+            return true;
+        }
+
+        bool Load() {
+            Clear(); // Ensure list is empty before loading
+
+            if (Binary::Load()) {
+                MCP::Advanced::g_advancedWeatherData.RebuildUsedWeathers();
+                Logger::info("Settings::Weather: Loaded {} weather rows from snapshot '{}'.", MCP::Advanced::g_advancedWeatherData.settings.size(), weatherSnapshotPath);
+                return true;
+            }
+
+            Logger::info("Settings::Weather: Loading JSON from '{}'", weatherListPath);
+
+            if (!std::filesystem::exists(weatherListPath)) {
+                Logger::warn("Settings::Weather: File '{}' does not exist. A new one will be created on save.", weatherListPath);
+                return false;
+            }
+
+            std::ifstream file(weatherListPath, std::ios::binary); // Byte-exact, so the snapshot hash matches the file
+            if (!file.is_open()) {
+                Logger::error("Settings::Weather: Could not open '{}'", weatherListPath);
+                return false;
+            }
+
+            std::string jsonContent((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            file.close();
+
+            auto& state = MCP::Advanced::g_advancedWeatherData;
+            if (!Parse(jsonContent, state.settings, state.rules, state.zones)) {
+                Logger::error("Settings::Weather: Invalid JSON format.");
+                return false;
+            }
+
+            state.RebuildUsedWeathers();
+            Binary::Save(state.settings, state.rules, state.zones, jsonContent);
+
+            Logger::info("Settings::Weather: Loaded {} weather rows, {} context rules and {} blur zones.", state.settings.size(), state.rules.size(), state.zones.size());
+            return true;
+        }
+
+        std::string Serialize(const std::vector<MCP::Advanced::WeatherSettingRow>& a_rows, const std::vector<MCP::Advanced::ContextRuleRow>& a_rules,
+            const std::vector<MCP::Advanced::BlurZoneRow>& a_zones) {
+            Document doc;
+            doc.SetObject();
+            auto& alloc = doc.GetAllocator();
+
+            Value mcp(kObjectType);
+            Value advanced(kObjectType);
+            Value settingsArray(kArrayType);
+
+            for (const auto& row : a_rows) {
+                Value rowObj(kObjectType);
+                rowObj.AddMember("rowToggle", row.rowToggle, alloc);
+                rowObj.AddMember("rowWeather", Value(row.rowWeatherType.c_str(), alloc), alloc);
+                rowObj.AddMember("blurStrength", row.rowBlurStrength, alloc);
+                rowObj.AddMember("blurRange", row.rowBlurRange, alloc);
+                rowObj.AddMember("staticToggle", row.rowStaticToggle, alloc);
+                rowObj.AddMember("transitionDuration", row.rowDuration, alloc);
+
+                const auto easing = Easing::curveNames[row.rowEasing];
+                rowObj.AddMember("easing", Value(easing.data(), static_cast<SizeType>(easing.size())), alloc);
+
+                // Flat rows keep their old shape, so older versions still read the file
+                if (!row.rowCurve.empty()) {
+                    Value curve(kArrayType);
+                    for (const auto& keyframe : row.rowCurve) {
+                        Value key(kObjectType);
+                        key.AddMember("hour", keyframe.hour, alloc);
+                        key.AddMember("blurStrength", keyframe.strength, alloc);
+                        key.AddMember("blurRange", keyframe.range, alloc);
+                        curve.PushBack(key, alloc);
+                    }
+                    rowObj.AddMember("curve", curve, alloc);
+                }
+                if (!row.rowChannels.empty()) {
+                    Value channels(kObjectType);
+                    for (const auto& target : row.rowChannels) {
+                        const auto name = Imod::channelNames[target.channel];
+                        channels.AddMember(Value(name.data(), static_cast<SizeType>(name.size())), target.value, alloc);
+                    }
+                    rowObj.AddMember("channels", channels, alloc);
+                }
+                settingsArray.PushBack(rowObj, alloc);
+            }
+
+            advanced.AddMember("WeatherSettings", settingsArray, alloc);
+
+            // Only written when used, so tables without rules serialize exactly as before
+            if (!a_rules.empty()) {
+                Value rulesArray(kArrayType);
+                for (const auto& rule : a_rules) {
+                    Value ruleObj(kObjectType);
+                    ruleObj.AddMember("ruleToggle", rule.ruleToggle, alloc);
+                    ruleObj.AddMember("weather", Value(rule.ruleWeatherType.c_str(), alloc), alloc);
+                    ruleObj.AddMember("cell", rule.ruleCell, alloc);
+                    ruleObj.AddMember("worldspace", Value(rule.ruleWorldspace.c_str(), alloc), alloc);
+
+                    Value keywords(kArrayType);
+                    for (const auto& keyword : rule.ruleKeywords) {
+                        keywords.PushBack(Value(keyword.c_str(), alloc), alloc);
+                    }
+                    ruleObj.AddMember("keywords", keywords, alloc);
+
+                    ruleObj.AddMember("hourStart", rule.ruleHourStart, alloc);
+                    ruleObj.AddMember("hourEnd", rule.ruleHourEnd, alloc);
+                    ruleObj.AddMember("blurStrength", rule.ruleBlurStrength, alloc);
+                    ruleObj.AddMember("blurRange", rule.ruleBlurRange, alloc);
+                    ruleObj.AddMember("staticToggle", rule.ruleStaticToggle, alloc);
+                    rulesArray.PushBack(ruleObj, alloc);
+                }
+                advanced.AddMember("ContextRules", rulesArray, alloc);
+            }
+
+            // Same for zones
+            if (!a_zones.empty()) {
+                const auto point = [&](const std::array<float, 3>& a_point) {
+                    Value components(kArrayType);
+                    for (const float component : a_point) components.PushBack(component, alloc);
+                    return components;
+                };
+
+                Value zonesArray(kArrayType);
+                for (const auto& zone : a_zones) {
+                    Value zoneObj(kObjectType);
+                    zoneObj.AddMember("zoneToggle", zone.zoneToggle, alloc);
+                    zoneObj.AddMember("worldspace", Value(zone.zoneWorldspace.c_str(), alloc), alloc);
+                    if (zone.zoneShape == 1) {
+                        zoneObj.AddMember("shape", "box", alloc);
+                        zoneObj.AddMember("min", point(zone.zoneMin), alloc);
+                        zoneObj.AddMember("max", point(zone.zoneMax), alloc);
+                    } else {
+                        zoneObj.AddMember("shape", "sphere", alloc);
+                        zoneObj.AddMember("center", point(zone.zoneCenter), alloc);
+                        zoneObj.AddMember("radius", zone.zoneRadius, alloc);
+                    }
+                    zoneObj.AddMember("blurStrength", zone.zoneBlurStrength, alloc);
+                    zoneObj.AddMember("blurRange", zone.zoneBlurRange, alloc);
+                    zoneObj.AddMember("falloff", zone.zoneFalloff, alloc);
+                    zonesArray.PushBack(zoneObj, alloc);
+                }
+                advanced.AddMember("BlurZones", zonesArray, alloc);
+            }
+            mcp.AddMember("Advanced", advanced, alloc);
+            doc.AddMember("MCP", mcp, alloc);
+
+            StringBuffer buffer;
+            JsonWriter   writer(buffer);
+
+            doc.Accept(writer);
+            return { buffer.GetString(), buffer.GetSize() };
+        }
+
+        bool Save() {
+
+            Logger::info("Settings::Weather: Saving to '{}'", weatherListPath);
+
+            auto&            advanced = MCP::Advanced::g_advancedWeatherData;
+            std::scoped_lock lock(advanced.lock);
+            const auto       json     = Serialize(advanced.settings, advanced.rules, advanced.zones);
+            if (!Persist(weatherListPath, json, jsonHash, true)) {
+                Logger::error("Settings::Weather: Failed to write file.");
+                return false;
+            }
+            Binary::Save(advanced.settings, advanced.rules, advanced.zones, json);
+
+            Logger::info("Settings::Weather: Saved successfully.");
+            return true;
+        }
+    }
+
+    // ============================================================
+    // Binary Snapshot
+    // ============================================================
+
+    namespace Binary {
+        namespace {
+            std::optional<SettingsSnapshot::Source> StatJson() {
+                std::error_code ec;
+                const auto      fileTime = std::filesystem::last_write_time(weatherListPath, ec);
+                if (ec) return std::nullopt;
+                const auto      fileSize = std::filesystem::file_size(weatherListPath, ec);
+                if (ec) return std::nullopt;
+
+                return SettingsSnapshot::Source{ 0, static_cast<std::int64_t>(fileTime.time_since_epoch().count()), static_cast<std::uint64_t>(fileSize) };
+            }
+
+            bool Reject(const char* a_reason) {
+                LOG_DEBUG(Log::kSettings, "Settings::Snapshot: '{}' {}, falling back to JSON.", weatherSnapshotPath, a_reason);
+                return false;
+            }
+        }
+
+        bool Load() {
+            const auto start = std::chrono::steady_clock::now();
+
+            Utils::MappedFile snapshot(weatherSnapshotPath);
+            if (!snapshot.IsOpen()) return Reject("does not exist");
+
+            const auto stored = SettingsSnapshot::ReadSource(snapshot.Data());
+            if (!stored) return Reject("has an unknown format");
+
+            // Cheap checks first, the content hash only runs when size and mtime already match
+            const auto current = StatJson();
+            if (!current) return Reject("has no JSON next to it");
+            if (current->mtime != stored->mtime || current->size != stored->size) return Reject("is older than the JSON");
+
+            {
+                Utils::MappedFile json(weatherListPath);
+                if (!json.IsOpen()) return Reject("could not map the JSON");
+
+                const auto data = json.Data();
+                if (SettingsSnapshot::HashContent({ reinterpret_cast<const char*>(data.data()), data.size() }) != stored->hash) return Reject("does not match the JSON content");
+            }
+
+            if (!SettingsSnapshot::Decode(snapshot.Data(), MCP::Advanced::g_advancedWeatherData.settings)) return Reject("is corrupt");
+
+            LOG_DEBUG(Log::kSettings, "Settings::Snapshot: Loaded in {:.3f} ms.", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            return true;
+        }
+
+        void Save(const std::vector<MCP::Advanced::WeatherSettingRow>& a_rows, const std::vector<MCP::Advanced::ContextRuleRow>& a_rules,
+            const std::vector<MCP::Advanced::BlurZoneRow>& a_zones, std::string_view a_json) {
+            // The snapshot only holds weather rows, a JSON with context rules or blur zones always takes the DOM path.
+            // Its hash no longer matches any snapshot written before those were added, so nothing stale can load.
+            if (!a_rules.empty() || !a_zones.empty()) {
+                LOG_DEBUG(Log::kSettings, "Settings::Snapshot: JSON has {} context rules and {} blur zones, snapshot skipped.", a_rules.size(), a_zones.size());
+                return;
+            }
+
+            auto source = StatJson();
+            if (!source || source->size != a_json.size()) {
+                LOG_DEBUG(Log::kSettings, "Settings::Snapshot: JSON on disk does not match the saved content, snapshot skipped.");
+                return;
+            }
+            source->hash = SettingsSnapshot::HashContent(a_json);
+
+            // A stale snapshot is harmless since Load() re-checks the content hash, the lock only keeps writers off the same temp file
+            std::scoped_lock lock(writeLock);
+            if (!Utils::WriteFileAtomic(weatherSnapshotPath, SettingsSnapshot::Encode(std::span{ a_rows }, *source))) {
+                Logger::error("Settings::Snapshot: Failed to write '{}'.", weatherSnapshotPath);
+                return;
+            }
+            LOG_DEBUG(Log::kSettings, "Settings::Snapshot: Wrote {} rows to '{}'.", a_rows.size(), weatherSnapshotPath);
+        }
+    }
+
+    // ============================================================
+    // Hot Reload
+    // ============================================================
+
+    namespace {
+        struct FileStamp {
+            std::int64_t  mtime = -1;
+            std::uint64_t size  = 0;
+
+            bool operator==(const FileStamp&) const = default;
+        };
+
+        FileStamp Stamp(const std::filesystem::path& a_path) {
+            std::error_code ec;
+            const auto      fileTime = std::filesystem::last_write_time(a_path, ec);
+            if (ec) return {};
+            const auto      fileSize = std::filesystem::file_size(a_path, ec);
+            if (ec) return {};
+            return { static_cast<std::int64_t>(fileTime.time_since_epoch().count()), static_cast<std::uint64_t>(fileSize) };
+        }
+
+        std::optional<std::string> ReadFile(const std::filesystem::path& a_path) {
+            std::ifstream file(a_path, std::ios::binary);
+            if (!file.is_open()) return std::nullopt;
+            return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        }
+
+        /**
+         * @brief INI settings parsed from an external edit, waiting for the game thread to swap them in.
+         */
+        struct Reload {
+            std::pair<GeneralSettings, LoggingSettings> ini;
+            std::uint64_t                               iniHash = 0;
+        };
+
+        RowDiff ApplyRows(std::vector<MCP::Advanced::WeatherSettingRow>&& a_rows);
+
+        /**
+         * @brief Polls both settings files and parses external edits off the game thread.
+         *
+         * Our own saves also bump the mtime, so a change only counts when the content hash differs
+         * from what was last persisted or loaded. Rows are applied to the working copy right here
+         * and handed to the game thread through RowsReloaded, only the INI waits for the game thread.
+         */
+        class ReloadWatcher {
+            public:
+                static ReloadWatcher& GetSingleton() {
+                    static ReloadWatcher instance;
+                    return instance;
+                }
+
+                void Start(RowsReloaded a_onRows) {
+                    if (_thread.joinable()) return;
+
+                    _onRows    = std::move(a_onRows);
+                    _iniStamp  = Stamp(settingsPath);
+                    _jsonStamp = Stamp(weatherListPath);
+                    _thread    = std::jthread([this](std::stop_token a_token) { Run(a_token); });
+                    Logger::info("Settings: Watching '{}' and '{}' for external edits.", settingsPath, weatherListPath);
+                }
+
+                std::optional<Reload> Take() {
+                    if (!_ready.load(std::memory_order_acquire)) return std::nullopt;
+
+                    std::scoped_lock lock(_lock);
+                    _ready.store(false, std::memory_order_relaxed);
+                    return std::exchange(_pending, std::nullopt);
+                }
+
+            private:
+                ReloadWatcher()                                = default;
+                ReloadWatcher(const ReloadWatcher&)            = delete;
+                ReloadWatcher(ReloadWatcher&&)                 = delete;
+                ReloadWatcher& operator=(const ReloadWatcher&) = delete;
+                ReloadWatcher& operator=(ReloadWatcher&&)      = delete;
+
+                ~ReloadWatcher() {
+                    if (_thread.joinable()) {
+                        _thread.request_stop();
+                        _thread.join();
+                    }
+                }
+
+                void Run(std::stop_token a_token) {
+                    std::mutex                  sleepLock;
+                    std::condition_variable_any sleep;
+
+                    while (!a_token.stop_requested()) {
+                        {
+                            std::unique_lock lock(sleepLock);
+                            sleep.wait_for(lock, a_token, reloadPollInterval, [] { return false; });
+                        }
+                        if (a_token.stop_requested()) break;
+
+                        PollIni();
+                        PollJson();
+                    }
+                }
+
+                bool Changed(const std::filesystem::path& a_path, FileStamp& a_stamp, const std::uint64_t& a_lastHash, std::string& a_content, std::uint64_t& a_hash) {
+                    const auto stamp = Stamp(a_path);
+                    if (stamp == a_stamp || stamp.mtime < 0) return false;
+
+                    auto content = ReadFile(a_path);
+                    if (!content) return false;
+                    a_stamp = stamp;
+
+                    a_hash = Utils::HashBytes(*content);
+                    {
+                        std::scoped_lock lock(writeLock);
+                        if (a_hash == a_lastHash) return false;  // Our own save, or a touch without edits
+                    }
+                    a_content = std::move(*content);
+                    return true;
+                }
+
+                void PollIni() {
+                    std::string content;
+                    Reload      reload;
+                    if (!Changed(settingsPath, _iniStamp, iniHash, content, reload.iniHash)) return;
+
+                    if (!INI::Parse(content, reload.ini.first, reload.ini.second)) {
+                        Logger::warn("Settings: External edit to '{}' could not be parsed, keeping the current settings.", settingsPath);
+                        return;
+                    }
+
+                    // The game thread has not picked up the last reload yet if one is pending, the newer file wins.
+                    std::scoped_lock lock(_lock);
+                    _pending = std::move(reload);
+                    _ready.store(true, std::memory_order_release);
+                }
+
+                void PollJson() {
+                    std::string   content;
+                    std::uint64_t hash = 0;
+                    if (!Changed(weatherListPath, _jsonStamp, jsonHash, content, hash)) return;
+
+                    std::vector<MCP::Advanced::WeatherSettingRow> rows;
+                    std::vector<MCP::Advanced::ContextRuleRow>    rules;
+                    std::vector<MCP::Advanced::BlurZoneRow>       zones;
+                    if (!Json::Parse(content, rows, rules, zones)) {
+                        Logger::warn("Settings::Weather: External edit to '{}' could not be parsed, keeping the current rows.", weatherListPath);
+                        return;
+                    }
+                    Binary::Save(rows, rules, zones, content);
+
+                    // The UI edits the same working copy, the game thread only sees what _onRows publishes
+                    auto&            state = MCP::Advanced::g_advancedWeatherData;
+                    std::unique_lock editLock(state.lock);
+
+                    auto diff = ApplyRows(std::move(rows));
+                    if (state.rules != rules) {
+                        state.rules       = std::move(rules);
+                        diff.rulesChanged = true;
+                    }
+                    if (state.zones != zones) {
+                        state.zones       = std::move(zones);
+                        diff.zonesChanged = true;
+                    }
+                    {
+                        std::scoped_lock lock(writeLock);
+                        jsonHash = hash;
+                    }
+
+                    // A UI save still waiting for its debounce predates this edit and would write the old rows over it,
+                    // so it is dropped and taken again from the reloaded rows once the edit lock is released
+                    const bool resave = Saver().Discard();
+
+                    Logger::info("Settings::Weather: Reloaded '{}' after an external edit, {} rows changed, {} weathers affected, context rules {}, blur zones {}.",
+                        weatherListPath, diff.changedRows, diff.changedWeathers.size(), diff.rulesChanged ? "changed" : "unchanged",
+                        diff.zonesChanged ? "changed" : "unchanged");
+
+                    if (_onRows && (!diff.changedWeathers.empty() || diff.rulesChanged || diff.zonesChanged)) {
+                        _onRows(diff);
+                    }
+
+                    editLock.unlock();
+                    if (resave) RequestSave();
+                }
+
+                std::mutex            _lock;
+                std::optional<Reload> _pending;
+                std::atomic<bool>     _ready{ false };
+                RowsReloaded          _onRows;
+                FileStamp             _iniStamp;
+                FileStamp             _jsonStamp;
+                std::jthread          _thread;
+        };
+
+        /**
+         * @brief Diffs the effective table (first enabled row per weather) and copies over only the rows that differ.
+         *        The caller holds g_advancedWeatherData.lock.
+         */
+        RowDiff ApplyRows(std::vector<MCP::Advanced::WeatherSettingRow>&& a_rows) {
+            auto& state = MCP::Advanced::g_advancedWeatherData;
+            auto& live  = state.settings;
+
+            using Effective = std::unordered_map<std::string_view, const MCP::Advanced::WeatherSettingRow*>;
+            const auto effective = [](const std::vector<MCP::Advanced::WeatherSettingRow>& a_table) {
+                Effective map;
+                map.reserve(a_table.size());
+                for (const auto& row : a_table) {
+                    if (row.rowToggle) map.try_emplace(row.rowWeatherType, &row);
+                }
+                return map;
+            };
+
+            RowDiff diff;
+            {
+                const auto before = effective(live);
+                const auto after  = effective(a_rows);
+
+                const auto sameEntry = [](const MCP::Advanced::WeatherSettingRow* a, const MCP::Advanced::WeatherSettingRow* b) {
+                    return a->rowBlurStrength == b->rowBlurStrength && a->rowBlurRange == b->rowBlurRange && a->rowStaticToggle == b->rowStaticToggle &&
+                           a->rowDuration == b->rowDuration && a->rowEasing == b->rowEasing && a->rowCurve == b->rowCurve && a->rowChannels == b->rowChannels;
+                };
+                for (const auto& [weather, row] : before) {
+                    const auto it = after.find(weather);
+                    if (it == after.end() || !sameEntry(row, it->second)) diff.changedWeathers.emplace_back(weather);
+                }
+                for (const auto& [weather, row] : after) {
+                    if (!before.contains(weather)) diff.changedWeathers.emplace_back(weather);
+                }
+            }
+
+            bool namesChanged = live.size() != a_rows.size();
+            diff.changedRows  = live.size() > a_rows.size() ? live.size() - a_rows.size() : a_rows.size() - live.size();
+
+            live.resize(a_rows.size());
+            for (std::size_t i = 0; i < a_rows.size(); i++) {
+                if (live[i] == a_rows[i]) continue;
+
+                namesChanged |= live[i].rowWeatherType != a_rows[i].rowWeatherType;
+                live[i]       = std::move(a_rows[i]);
+                diff.changedRows++;
+            }
+
+            if (namesChanged) {
+                state.RebuildUsedWeathers();
+            }
+            return diff;
+        }
+    }
+
+    void StartWatcher(RowsReloaded a_onRows) {
+        ReloadWatcher::GetSingleton().Start(std::move(a_onRows));
+    }
+
+    bool ApplyPendingReload() {
+        auto reload = ReloadWatcher::GetSingleton().Take();
+        if (!reload) return false;
+
+        general = reload->ini.first;
+        logging = reload->ini.second;
+        INI::ApplyLogLevels();
+        Logger::info("Settings: Reloaded '{}' after an external edit.", settingsPath);
+
+        // Same as for the rows, a pending UI save is taken again so it carries the reloaded settings
+        if (Saver().Discard()) RequestSave();
+
+        std::scoped_lock lock(writeLock);
+        iniHash = reload->iniHash;
+        return true;
+    }
+}
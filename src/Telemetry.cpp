@@ -0,0 +1,64 @@
+#include "PCH.h"
+#include "Telemetry.h"
+#include "Logger.h"
+
+namespace Telemetry {
+
+	namespace {
+		HANDLE mapping    = nullptr;
+		Block* block      = nullptr;  // Mapped for the rest of the session once opened
+		bool   publishing = false;
+		bool   failed     = false;    // Not retried every frame, only after the toggle goes off and on again
+
+		bool Open() {
+			const auto name = std::string("Local\\") + blockName;
+			mapping         = ::CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(Block), name.c_str());
+			if (!mapping) {
+				Logger::error("Telemetry: Could not create the shared memory block '{}', error {}.", name, ::GetLastError());
+				return false;
+			}
+
+			// A second writer would break the sequence for both, so a block held by another game instance is left alone
+			if (::GetLastError() == ERROR_ALREADY_EXISTS) {
+				Logger::warn("Telemetry: The shared memory block '{}' is already open, telemetry stays off.", name);
+				::CloseHandle(mapping);
+				mapping = nullptr;
+				return false;
+			}
+
+			const auto view = ::MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Block));
+			if (!view) {
+				Logger::error("Telemetry: Could not map the shared memory block '{}', error {}.", name, ::GetLastError());
+				::CloseHandle(mapping);
+				mapping = nullptr;
+				return false;
+			}
+
+			block = Create(view, ::GetCurrentProcessId());
+			Logger::info("Telemetry: Publishing to '{}', layout version {}.", name, layoutVersion);
+			return true;
+		}
+	}
+
+	// Turning telemetry off keeps the block mapped. Unmapping it would leave it alive in any reader that still has it
+	// open, and the next Open() would then see it as another writer's block and refuse its own.
+	void SetEnabled(bool a_enabled) {
+		if (a_enabled == publishing) return;
+
+		if (!a_enabled) {
+			Logger::info("Telemetry: Stopped publishing.");
+			publishing = false;
+			failed     = false;
+		} else if (block) {
+			Logger::info("Telemetry: Resumed publishing.");
+			publishing = true;
+		} else if (!failed) {
+			failed     = !Open();
+			publishing = !failed;
+		}
+	}
+
+	Block* Get() {
+		return publishing ? block : nullptr;
+	}
+}
@@ -1,120 +1,419 @@
-#include "PCH.h"
-#include "Utils.h"
-#include "MCP.h"
-
-namespace Utils {
-	std::map<std::type_index, std::vector<std::string>> g_formCache;
-	std::map<std::type_index, bool>                     g_cachePopulated;
-
-    bool ValidateForm(RE::TESForm* form, RE::FormType expectedType) {
-        if (!form) {
-            Logger::error("ValidateForm: form is null or does not exist, cannot proceed.");
-            return false;
-        }
-
-        const auto formType = form->GetFormType();
-        const auto formID   = form->GetFormID();
-
-        if (form->IsDeleted()) {
-            Logger::error("ValidateForm: form is deleted.");
-            return false;
-        }
-
-        if (form->IsIgnored()) {
-            Logger::error("ValidateForm: form is marked as Ignored, cannot proceed.");
-            return false;
-        }
-
-        if (!form->IsInitialized()) {
-            Logger::error("ValidateForm: form is not initialized.");
-            return false;
-        }
-
-        if (form->GetFormFlags() & RE::TESForm::RecordFlags::kDisabled) {
-            Logger::error("ValidateForm: form is marked as Disabled, cannot proceed.");
-            return false;
-        }
-
-        if (formType == RE::FormType::None || formType != expectedType) {
-            Logger::error("ValidateForm: form has incorrect FormType: {}, cannot proceed.", formType);
-            return false;
-        }
-
-        if (!formID) {
-            Logger::error("ValidateForm: form has invalid FormID, cannot proceed.");
-            return false;
-        }
-
-        const char* editorID = (clib_util::editorID::get_editorID(form)).c_str();
-        if (!editorID || editorID[0] == '\0') {
-            Logger::warn("ValidateForm: form has empty EditorID.");
-        }
-
-        if (Settings::general.VerboseLogging) {
-            Logger::info("ValidateForm: form is not null, proceeding.");
-
-            auto* file = form->GetFile();
-            if (!file) {
-                Logger::warn("ValidateForm: form has no source file.");
-            }
-            else {
-                Logger::info("ValidateForm: form has source file: {}", file->fileName);
-            }
-
-            auto* descFile = form->GetDescriptionOwnerFile();
-            if (descFile) {
-                Logger::info("ValidateForm: form has a description owner file: {}", descFile->fileName);
-            }
-
-            Logger::info("ValidateForm: form has correct FormType: {}", formType);
-            Logger::info("ValidateForm: form has valid FormID: {:x}", formID);
-            Logger::info("ValidateForm: form has EditorID: {}", editorID);
-
-            const char* name = form->GetName();
-            if (!name || name[0] == '\0') {
-                Logger::warn("ValidateForm: form has no name.");
-            } else {
-                Logger::info("ValidateForm: form has name: {}", name);
-            }
-
-            if (form->IsParentForm())                Logger::info("ValidateForm: form is a Parent Form.");
-            if (form->IsParentFormTree())            Logger::info("ValidateForm: form is a Parent Form Tree.");
-            if (form->IsFormTypeChild(expectedType)) Logger::info("ValidateForm: form is a Child Form.");
-            if (form->IsDynamicForm())               Logger::info("ValidateForm: form was made by Form Factory.");
-
-            auto refCount = form->GetRefCount();
-            if (refCount > 0) {
-                Logger::info("ValidateForm: form has {} references in the current game session.", refCount);
-            }
-        }
-
-        return true;
-    }
-
-    inline std::string GetWeatherName(RE::TESWeather* weather) {
-        if (weather) {
-            return clib_util::editorID::get_editorID(weather);
-        }
-        return "None";
-    }
-
-    std::string GetCurrentWeather() {
-        const auto sky = RE::Sky::GetSingleton();
-
-        if (!sky) {
-            return "None";
-        }
-
-        return GetWeatherName(sky->currentWeather);
-    }
-
-    std::string GetPreviousWeather() {
-        const auto sky = RE::Sky::GetSingleton();
-
-        if (!sky) {
-            return "None";
-        }
-
-        return GetWeatherName(sky->lastWeather);
-    }
+#include "PCH.h"
+#include "Utils.h"
+#include "MCP.h"
+
+#include <optional>
+#include <span>
+
+namespace Utils {
+
+    bool WriteFileAtomic(const std::filesystem::path& a_path, std::string_view a_content) {
+        auto tempPath = a_path;
+        tempPath     += ".tmp";
+
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                Logger::error("WriteFileAtomic: Could not open '{}' for writing.", tempPath.string());
+                return false;
+            }
+            file.write(a_content.data(), static_cast<std::streamsize>(a_content.size()));
+            if (!file) {
+                Logger::error("WriteFileAtomic: Failed to write '{}'.", tempPath.string());
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tempPath, a_path, ec);
+        if (ec) {
+            Logger::error("WriteFileAtomic: Failed to replace '{}': {}", a_path.string(), ec.message());
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+    // ============================================================
+    // FormCacheFile
+    // ============================================================
+
+    namespace FormCacheFile {
+        namespace {
+            constexpr std::array<char, 4> fileMagic   = { 'D', 'B', 'F', 'C' };
+            constexpr std::uint32_t       fileVersion = 1;
+
+            struct FileHeader {
+                std::array<char, 4> magic;
+                std::uint32_t       version;
+                std::uint64_t       fingerprint;
+                std::uint32_t       sectionCount;
+                std::uint32_t       reserved;
+            };
+
+            struct SectionHeader {
+                std::uint32_t formType;
+                std::uint32_t recordCount;
+                std::uint32_t arenaSize;  // Padded to 4 bytes on disk so the next header stays aligned
+                std::uint32_t reserved;
+            };
+
+            static_assert(sizeof(FileHeader) == 24);
+            static_assert(sizeof(SectionHeader) == 16);
+            static_assert(sizeof(Record) == 12);
+
+            struct StagedSection {
+                std::uint32_t       formType;
+                std::vector<Record> records;
+                std::string         arena;
+            };
+
+            MappedFile                   mapping;
+            std::vector<Section>         sections;
+            std::vector<StagedSection>   staged;
+            std::optional<bool>          openResult;
+            std::optional<std::uint64_t> fingerprint;
+
+            std::size_t AlignUp(std::size_t a_size) { return (a_size + 3) & ~std::size_t{ 3 }; }
+
+            template <typename V>
+            std::uint64_t HashValue(const V& a_value, std::uint64_t a_seed) {
+                return HashBytes({ reinterpret_cast<const char*>(&a_value), sizeof(V) }, a_seed);
+            }
+
+            bool Reject(const char* a_reason) {
+                Logger::info("FormCacheFile: '{}' {}, forms will be enumerated.", path, a_reason);
+                sections.clear();
+                mapping.Close();
+                return false;
+            }
+
+            bool Parse() {
+                const auto data = mapping.Data();
+
+                FileHeader header{};
+                if (data.size() < sizeof(header)) return Reject("is truncated");
+                std::memcpy(&header, data.data(), sizeof(header));
+
+                if (header.magic != fileMagic || header.version != fileVersion) return Reject("has an unknown format");
+                if (header.fingerprint != GetLoadOrderFingerprint()) return Reject("was built for a different load order");
+
+                std::size_t offset = sizeof(header);
+                for (std::uint32_t i = 0; i < header.sectionCount; i++) {
+                    SectionHeader sectionHeader{};
+                    if (data.size() - offset < sizeof(sectionHeader)) return Reject("is truncated");
+                    std::memcpy(&sectionHeader, data.data() + offset, sizeof(sectionHeader));
+                    offset += sizeof(sectionHeader);
+
+                    const std::size_t recordBytes = static_cast<std::size_t>(sectionHeader.recordCount) * sizeof(Record);
+                    const std::size_t arenaBytes  = AlignUp(sectionHeader.arenaSize);
+                    if (data.size() - offset < recordBytes + arenaBytes) return Reject("is truncated");
+
+                    Section section;
+                    section.formType = sectionHeader.formType;
+                    section.records  = { reinterpret_cast<const Record*>(data.data() + offset), sectionHeader.recordCount };
+                    section.arena    = { reinterpret_cast<const char*>(data.data() + offset + recordBytes), sectionHeader.arenaSize };
+                    sections.push_back(section);
+
+                    offset += recordBytes + arenaBytes;
+                }
+                return true;
+            }
+        }
+
+        std::uint64_t GetLoadOrderFingerprint() {
+            if (fingerprint) return *fingerprint;
+
+            std::uint64_t hash = HashValue(fileVersion, 0xCBF29CE484222325ull);
+
+            const auto hashFiles = [&](const auto& a_files) {
+                for (const auto file : a_files) {
+                    if (!file) continue;
+
+                    const auto name = file->GetFilename();
+                    hash            = HashBytes(name, hash);
+
+                    std::error_code    ec;
+                    const auto         pluginPath = std::filesystem::path("Data") / name;
+                    const auto         fileSize   = std::filesystem::file_size(pluginPath, ec);
+                    const std::int64_t size       = ec ? -1 : static_cast<std::int64_t>(fileSize);
+                    const auto         fileTime   = std::filesystem::last_write_time(pluginPath, ec);
+                    const std::int64_t time       = ec ? -1 : static_cast<std::int64_t>(fileTime.time_since_epoch().count());
+
+                    hash = HashValue(size, hash);
+                    hash = HashValue(time, hash);
+                }
+            };
+
+            const auto dataHandler = RE::TESDataHandler::GetSingleton();
+            // The accessors rather than compiledFileCollection, which VR lays out differently
+            hashFiles(std::span<RE::TESFile* const>(dataHandler->GetLoadedMods(), dataHandler->GetLoadedModCount()));
+            hashFiles(std::span<RE::TESFile* const>(dataHandler->GetLoadedLightMods(), dataHandler->GetLoadedLightModCount()));
+
+            fingerprint = hash;
+            LOG_DEBUG(Log::kCache, "FormCacheFile: Load order fingerprint is {:016X}.", hash);
+            return hash;
+        }
+
+        bool Open() {
+            if (openResult) return *openResult;
+
+            if (!mapping.Open(path)) {
+                openResult = Reject("does not exist");
+                return false;
+            }
+            openResult = Parse();
+            return *openResult;
+        }
+
+        const Section* Find(RE::FormType a_formType) {
+            const auto it = std::find_if(sections.begin(), sections.end(), [&](const Section& a_section) {
+                return a_section.formType == static_cast<std::uint32_t>(a_formType);
+            });
+            return it != sections.end() ? std::to_address(it) : nullptr;
+        }
+
+        void Stage(RE::FormType a_formType, std::vector<Record>&& a_records, std::string_view a_arena) {
+            staged.push_back({ static_cast<std::uint32_t>(a_formType), std::move(a_records), std::string(a_arena) });
+        }
+
+        void Commit() {
+            if (staged.empty()) {
+                sections.clear();
+                mapping.Close();
+                return;
+            }
+
+            // Sections that did load from disk are carried over, so a partial rebuild keeps the full file.
+            for (const auto& section : sections) {
+                const bool rebuilt = std::any_of(staged.begin(), staged.end(), [&](const StagedSection& a_staged) {
+                    return a_staged.formType == section.formType;
+                });
+                if (!rebuilt) {
+                    staged.push_back({ section.formType, { section.records.begin(), section.records.end() }, std::string(section.arena) });
+                }
+            }
+
+            // The view has to go before the file can be replaced.
+            sections.clear();
+            mapping.Close();
+
+            std::string buffer;
+            const auto  append = [&](const void* a_data, std::size_t a_size) {
+                buffer.append(static_cast<const char*>(a_data), a_size);
+            };
+
+            const FileHeader header{ fileMagic, fileVersion, GetLoadOrderFingerprint(), static_cast<std::uint32_t>(staged.size()), 0 };
+            append(&header, sizeof(header));
+
+            for (const auto& section : staged) {
+                const SectionHeader sectionHeader{ section.formType, static_cast<std::uint32_t>(section.records.size()), static_cast<std::uint32_t>(section.arena.size()), 0 };
+                append(&sectionHeader, sizeof(sectionHeader));
+                append(section.records.data(), section.records.size() * sizeof(Record));
+                append(section.arena.data(), section.arena.size());
+                buffer.resize(AlignUp(buffer.size()), '\0');
+            }
+
+            if (WriteFileAtomic(path, buffer)) {
+                Logger::info("FormCacheFile: Wrote {} sections ({} bytes) to '{}'.", staged.size(), buffer.size(), path);
+            }
+
+            staged.clear();
+            staged.shrink_to_fit();
+        }
+    }
+
+    // ============================================================
+    // MappedFile
+    // ============================================================
+
+    bool MappedFile::Open(const std::filesystem::path& a_path) {
+        Close();
+
+        const auto file = ::CreateFileW(a_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        _file = file;
+
+        LARGE_INTEGER size{};
+        if (!::GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            Close();
+            return false;
+        }
+
+        _mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!_mapping) {
+            Close();
+            return false;
+        }
+
+        _view = ::MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!_view) {
+            Close();
+            return false;
+        }
+
+        _size = static_cast<std::size_t>(size.QuadPart);
+        return true;
+    }
+
+    void MappedFile::Close() {
+        if (_view) ::UnmapViewOfFile(_view);
+        if (_mapping) ::CloseHandle(_mapping);
+        if (_file) ::CloseHandle(_file);
+
+        _view    = nullptr;
+        _mapping = nullptr;
+        _file    = nullptr;
+        _size    = 0;
+    }
+
+    FormIssue CheckForm(RE::TESForm* form, RE::FormType expectedType, bool a_hasEditorID) {
+        if (!form) return FormIssue::kNull;
+        if (form->IsDeleted()) return FormIssue::kDeleted;
+        if (form->IsIgnored()) return FormIssue::kIgnored;
+        if (!form->IsInitialized()) return FormIssue::kUninitialized;
+        if (form->GetFormFlags() & RE::TESForm::RecordFlags::kDisabled) return FormIssue::kDisabled;
+
+        const auto formType = form->GetFormType();
+        if (formType == RE::FormType::None || formType != expectedType) return FormIssue::kWrongType;
+        if (!form->GetFormID()) return FormIssue::kNoFormID;
+        if (!a_hasEditorID) return FormIssue::kNoEditorID;
+        return FormIssue::kNone;
+    }
+
+    bool ValidateForm(RE::TESForm* form, RE::FormType expectedType) {
+        const auto editorIDString = form ? clib_util::editorID::get_editorID(form) : std::string{};
+        const auto issue          = CheckForm(form, expectedType, !editorIDString.empty());
+
+        if (issue == FormIssue::kNoEditorID) {
+            Logger::warn("ValidateForm: form {:x} has no editorID.", form->GetFormID());
+        } else if (issue != FormIssue::kNone) {
+            Logger::error("ValidateForm: form {:x} failed validation ({}), cannot proceed.", form ? form->GetFormID() : 0, formIssueNames[static_cast<std::size_t>(issue)]);
+            return false;
+        }
+
+        const auto  formType = form->GetFormType();
+        const auto  formID   = form->GetFormID();
+        const char* editorID = editorIDString.c_str();
+
+        if (Settings::general.VerboseLogging) {
+            Logger::info("ValidateForm: form is not null, proceeding.");
+
+            auto* file = form->GetFile();
+            if (!file) {
+                Logger::warn("ValidateForm: form has no source file.");
+            }
+            else {
+                Logger::info("ValidateForm: form has source file: {}", file->fileName);
+            }
+
+            auto* descFile = form->GetDescriptionOwnerFile();
+            if (descFile) {
+                Logger::info("ValidateForm: form has a description owner file: {}", descFile->fileName);
+            }
+
+            Logger::info("ValidateForm: form has correct FormType: {}", formType);
+            Logger::info("ValidateForm: form has valid FormID: {:x}", formID);
+            Logger::info("ValidateForm: form has EditorID: {}", editorID);
+
+            const char* name = form->GetName();
+            if (!name || name[0] == '\0') {
+                Logger::warn("ValidateForm: form has no name.");
+            } else {
+                Logger::info("ValidateForm: form has name: {}", name);
+            }
+
+            if (form->IsParentForm())                Logger::info("ValidateForm: form is a Parent Form.");
+            if (form->IsParentFormTree())            Logger::info("ValidateForm: form is a Parent Form Tree.");
+            if (form->IsFormTypeChild(expectedType)) Logger::info("ValidateForm: form is a Child Form.");
+            if (form->IsDynamicForm())               Logger::info("ValidateForm: form was made by Form Factory.");
+
+            auto refCount = form->GetRefCount();
+            if (refCount > 0) {
+                Logger::info("ValidateForm: form has {} references in the current game session.", refCount);
+            }
+        }
+
+        return true;
+    }
+
+    namespace {
+        struct PendingCheck {
+            RE::TESForm* form;
+            RE::FormType type;
+            bool         hasEditorID;
+        };
+
+        template <typename T>
+        void QueueChecks(std::vector<PendingCheck>& a_checks) {
+            for (const auto& entry : g_formCache<T>.Entries()) {
+                if (entry.form) a_checks.push_back({ entry.form, T::FORMTYPE, entry.nameLength != 0 });
+            }
+        }
+
+        std::jthread validationThread;
+    }
+
+    void StartFormValidation() {
+        if (!Settings::general.ExtraChecks) {
+            LOG_DEBUG(Log::kCache, "FormValidation: ExtraChecks is off, skipped.");
+            return;
+        }
+
+        std::vector<PendingCheck> checks;
+        QueueChecks<RE::TESWeather>(checks);
+        QueueChecks<RE::TESImageSpaceModifier>(checks);
+
+        validationThread = std::jthread([checks = std::move(checks)](std::stop_token a_stop) {
+            const auto start = std::chrono::steady_clock::now();
+
+            std::array<std::size_t, static_cast<std::size_t>(FormIssue::kCount)> counts{};
+            for (const auto& check : checks) {
+                if (a_stop.stop_requested()) return;
+
+                const auto issue = CheckForm(check.form, check.type, check.hasEditorID);
+                counts[static_cast<std::size_t>(issue)]++;
+                if (issue != FormIssue::kNone) {
+                    LOG_TRACE(Log::kCache, "FormValidation: {:x} is {}.", check.form->GetFormID(), formIssueNames[static_cast<std::size_t>(issue)]);
+                }
+            }
+
+            // One line for the whole load order, per-form details are trace only
+            std::string issues;
+            for (std::size_t i = 1; i < counts.size(); i++) {
+                if (counts[i]) issues += std::format("{}{} {}", issues.empty() ? "" : ", ", counts[i], formIssueNames[i]);
+            }
+            Logger::info("FormValidation: Checked {} forms in {:.2f} ms, {}.", checks.size(),
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), issues.empty() ? "all valid" : issues);
+        });
+    }
+
+    inline std::string GetWeatherName(RE::TESWeather* weather) {
+        if (weather) {
+            return clib_util::editorID::get_editorID(weather);
+        }
+        return "None";
+    }
+
+    std::string GetCurrentWeather() {
+        const auto sky = RE::Sky::GetSingleton();
+
+        if (!sky) {
+            return "None";
+        }
+
+        return GetWeatherName(sky->currentWeather);
+    }
+
+    std::string GetPreviousWeather() {
+        const auto sky = RE::Sky::GetSingleton();
+
+        if (!sky) {
+            return "None";
+        }
+
+        return GetWeatherName(sky->lastWeather);
+    }
 }
\ No newline at end of file
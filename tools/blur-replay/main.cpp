@@ -0,0 +1,159 @@
+// Offline replay of a frame trace written by the in-game frame recorder (Diagnostics page) or by `blur-sim record`.
+//
+//   blur-replay <trace> [tolerance]
+//
+// Every frame's recorded inputs are fed through Blur::Controller and its outputs are compared with what was
+// recorded. The controller resumes from the first frame's checkpoint, and again after a divergence or a
+// frame recorded against other settings, so one mismatch is reported once instead of cascading.
+// Exits with 0 when the trace replays within tolerance, 2 when it diverges and 1 when it cannot be read.
+
+#include "BlurController.h"
+#include "FrameTrace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+	struct ReplaySky final : Blur::ISky {
+		const Trace::Frame* frame = nullptr;
+
+		std::uint32_t GetCurrentWeather() const override { return frame->currentWeather; }
+		std::uint32_t GetPreviousWeather() const override { return frame->previousWeather; }
+		float         GetGameHour() const override { return frame->gameHour; }
+	};
+
+	struct ReplayImod final : Blur::IImodSink {
+		bool          alive    = false;
+		std::uint64_t triggers = 0;
+		std::uint64_t stops    = 0;
+
+		void SetChannels(std::uint32_t, const Imod::Values&) override {}
+		void Trigger() override { ++triggers; }
+		void Stop() override { ++stops; }
+		bool IsInstanceAlive() const override { return alive; }
+	};
+
+	struct Timing {
+		std::vector<std::uint32_t> samples;
+
+		void Print(const char* a_label) {
+			if (samples.empty()) return;
+			std::ranges::sort(samples);
+
+			double total = 0.0;
+			for (const auto sample : samples) total += sample;
+
+			const auto at = [&](double a_percentile) { return samples[static_cast<std::size_t>(a_percentile * static_cast<double>(samples.size() - 1))]; };
+			std::printf("  %-15s : avg %.0f ns, p50 %u ns, p99 %u ns, max %u ns\n", a_label, total / static_cast<double>(samples.size()), at(0.50), at(0.99),
+				samples.back());
+		}
+	};
+
+	void PrintFrame(const char* a_label, std::size_t a_index, std::uint32_t a_events, const Blur::Controller::Checkpoint& a_state) {
+		std::printf("    %-9s #%-6zu events %04X  target %.6f / %.3f  applied %.6f / %.3f  lifecycle %u\n", a_label, a_index, a_events, a_state.targetStrength,
+			a_state.targetRange, a_state.appliedStrength, a_state.appliedRange, static_cast<unsigned>(a_state.lifecycle));
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::fprintf(stderr, "usage: %s <trace> [tolerance]\n", argv[0]);
+		return 1;
+	}
+	const float tolerance = argc > 2 ? std::strtof(argv[2], nullptr) : 1e-4f;
+
+	std::ifstream     stream(argv[1], std::ios::binary);
+	const std::string content((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+	Trace::File trace;
+	if (!stream.is_open() || !Trace::Decode(std::as_bytes(std::span{ content }), trace)) {
+		std::fprintf(stderr, "'%s' is not a readable frame trace\n", argv[1]);
+		return 1;
+	}
+
+	Blur::Controller controller;
+	controller.Compile(trace.tables.rows);
+	controller.SetAutomatic(trace.automatic);
+
+	ReplaySky  sky;
+	ReplayImod imod;
+	Timing     recorded;
+	Timing     replayed;
+
+	std::size_t replayedFrames = 0;
+	std::size_t skippedFrames  = 0;
+	std::size_t divergences    = 0;
+	std::size_t inexactFrames  = 0;  // Within tolerance but not bit-identical, e.g. a different libm
+	float       maxError       = 0.0f;
+	bool        resume         = true;
+
+	for (std::size_t i = 0; i < trace.frames.size(); i++) {
+		const auto& frame = trace.frames[i];
+
+		if (frame.settingsEpoch != trace.settingsEpoch) {
+			++skippedFrames;
+			resume = true;
+			continue;
+		}
+
+		const auto override = Trace::OverrideOf(frame);
+		controller.SetOverride(frame.flags & Trace::kOverride ? &override : nullptr);
+		controller.SetZone(Trace::ZoneOf(frame));
+
+		const auto expected = Trace::CheckpointOf(frame);
+		if (resume) {
+			controller.Restore(expected);
+			resume = false;
+			continue;
+		}
+
+		sky.frame  = &frame;
+		imod.alive = (frame.flags & Trace::kInstanceAlive) != 0;
+
+		const auto start  = std::chrono::steady_clock::now();
+		const auto events = controller.Update(frame.delta, static_cast<Blur::Mode>(frame.mode), sky, imod);
+		const auto cost   = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+		recorded.samples.push_back(frame.nanoseconds);
+		replayed.samples.push_back(static_cast<std::uint32_t>(std::min<long long>(cost, UINT32_MAX)));
+		++replayedFrames;
+
+		const auto actual = controller.GetCheckpoint();
+		const float error = std::max({ std::abs(actual.targetStrength - expected.targetStrength), std::abs(actual.appliedStrength - expected.appliedStrength),
+			std::abs(actual.targetRange - expected.targetRange) / 1000.0f, std::abs(actual.appliedRange - expected.appliedRange) / 1000.0f,
+			static_cast<float>(std::abs(actual.elapsed - expected.elapsed)), std::abs(actual.parkedTime - expected.parkedTime) });
+		maxError = std::max(maxError, error);
+
+		if (events != frame.events || actual.lifecycle != expected.lifecycle || error > tolerance) {
+			if (++divergences <= 10) {
+				std::printf("Divergence at frame %zu (delta %.5f, weather %08X -> %08X, hour %.2f):\n", i, frame.delta, frame.previousWeather,
+					frame.currentWeather, frame.gameHour);
+				PrintFrame("recorded", i, frame.events, expected);
+				PrintFrame("replayed", i, events, actual);
+			}
+			controller.Restore(expected);
+		} else if (error > 0.0f) {
+			++inexactFrames;
+		}
+	}
+
+	std::printf("Replayed %zu of %zu frames from '%s' (%zu weather rows, %zu automatic entries, settings epoch %u)\n", replayedFrames, trace.frames.size(),
+		argv[1], trace.tables.rows.size(), trace.automatic.size(), trace.settingsEpoch);
+	std::printf("  divergences     : %zu (tolerance %g, max error %g)\n", divergences, tolerance, maxError);
+	std::printf("  inexact frames  : %zu\n", inexactFrames);
+	std::printf("  skipped frames  : %zu (recorded against other settings)\n", skippedFrames);
+	std::printf("  triggers/stops  : %llu / %llu\n", static_cast<unsigned long long>(imod.triggers), static_cast<unsigned long long>(imod.stops));
+	recorded.Print("recorded cost");
+	replayed.Print("replayed cost");
+
+	return divergences ? 2 : 0;
+}
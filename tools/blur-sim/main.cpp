@@ -0,0 +1,1474 @@
+// Headless driver for Blur::Controller.
+//
+//   blur-sim sim   [frames] [seed]   Runs a synthetic weather trace in automatic mode, with the player circling through
+//                                    blur zones, and prints what the controller did.
+//   blur-sim record <file> [frames] [seed]
+//                                    Same run, with the last frames written as a frame trace for blur-replay.
+//   blur-sim auto                    Checks automatic mode against rows and derived values, and times deriving the table.
+//   blur-sim zones                   Checks the blur zone grid against a brute-force evaluation, the blend against known
+//                                    values, and that the grid is only probed on cell changes. Times the lookups.
+//   blur-sim rules                   Checks context rules: first match wins, hour windows wrap past midnight, the cell
+//                                    mask, and that keywords past the 64 that get a bit can never match.
+//   blur-sim fps                     Plays one weather script at 30, 60, 144, variable and skipped frame rates and
+//                                    checks the transitions come out the same.
+//   blur-sim channels [frames]       Plays random transitions into the packed IMOD channel blend and a lane-by-lane scalar
+//                                    one, 900,000 frames over three seeds by default, and checks they hash the same.
+//   blur-sim bench                   Micro-benchmarks the update path for table sizes 10 -> 10,000 rows.
+//   blur-sim snapshot                Benchmarks encoding and loading the settings snapshot for 10, 1,000 and 10,000 rows,
+//                                    against parsing the same rows from JSON when the tools are built with RapidJSON.
+//   blur-sim publish  [seconds]      Two writers publish settings tables while a reader compiles them. Build the tools
+//                                    with -fsanitize=thread to have ThreadSanitizer check the handover.
+//   blur-sim persist                 Checks the debounced settings writer: a burst of requests is one write, a flush
+//                                    during a write lands after it, and writes never overlap or go back in time.
+//
+// With no arguments all of them are run.
+
+#include "AutoBlur.h"
+#include "BlurController.h"
+#include "BlurZones.h"
+#include "ContextRules.h"
+#include "FrameTrace.h"
+#include "Persistence.h"
+#include "Published.h"
+#include "SettingsSnapshot.h"
+
+#ifdef BLUR_SIM_RAPIDJSON
+#	include <rapidjson/document.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	constexpr std::uint32_t kFirstWeather = 0x0000D000;
+	constexpr std::uint32_t kWorldspace   = 0x0000003C;  // Tamriel
+
+	struct SimSky final : Blur::ISky {
+		std::uint32_t current  = 0;
+		std::uint32_t previous = 0;
+		float         hour     = 12.0f;
+
+		void SetWeather(std::uint32_t a_weather) {
+			previous = current;
+			current  = a_weather;
+		}
+
+		std::uint32_t GetCurrentWeather() const override { return current; }
+		std::uint32_t GetPreviousWeather() const override { return previous; }
+		float         GetGameHour() const override { return hour; }
+	};
+
+	struct SimImod final : Blur::IImodSink {
+		float         strength      = 0.0f;
+		float         range         = 0.0f;
+		bool          alive         = false;
+		std::uint64_t dofWrites     = 0;
+		std::uint64_t channelWrites = 0;
+		std::uint64_t triggers      = 0;
+		std::uint64_t stops         = 0;
+
+		void SetChannels(std::uint32_t a_mask, const Imod::Values& a_values) override {
+			if (a_mask & Imod::dofMask) {
+				strength = a_values[Imod::kDOFStrength];
+				range    = a_values[Imod::kDOFRange];
+				++dofWrites;
+			}
+			channelWrites += static_cast<std::uint64_t>(std::popcount(a_mask & ~Imod::dofMask));
+		}
+		void Trigger() override {
+			alive = true;
+			++triggers;
+		}
+		void Stop() override {
+			alive = false;
+			++stops;
+		}
+		bool IsInstanceAlive() const override { return alive; }
+	};
+
+	std::vector<Blur::RowInput> MakeRows(std::size_t a_count, std::uint32_t a_seed) {
+		std::mt19937                          rng(a_seed);
+		std::uniform_real_distribution<float> strength(0.1f, 1.0f);
+		std::uniform_real_distribution<float> range(50.0f, 500.0f);
+
+		std::vector<Blur::RowInput> rows(a_count);
+		for (std::size_t i = 0; i < a_count; ++i) {
+			rows[i] = { kFirstWeather + static_cast<std::uint32_t>(i), true, strength(rng), range(rng), (i % 7) == 0, 1.0f + static_cast<float>(i % 6),
+				static_cast<Easing::Curve>(i % Easing::kCurveCount), {}, {} };
+		}
+		return rows;
+	}
+
+	// Covers the rows' weathers and as many again past them, in every classification and fog density
+	std::vector<AutoBlur::WeatherTraits> MakeTraits(std::size_t a_count, std::uint32_t a_seed) {
+		std::mt19937                          rng(a_seed);
+		std::uniform_real_distribution<float> fogFar(5000.0f, 200000.0f);
+		std::uniform_int_distribution<int>    classification(0, 4);
+
+		std::vector<AutoBlur::WeatherTraits> traits(a_count);
+		for (std::size_t i = 0; i < a_count; ++i) {
+			const int bit = classification(rng);
+			traits[i]     = { kFirstWeather + static_cast<std::uint32_t>(i), 0.0f, fogFar(rng), 0.0f, fogFar(rng),
+				static_cast<std::uint8_t>(bit < 4 ? 1 << bit : 0), (i % 3) == 0 };
+		}
+		return traits;
+	}
+
+	// Spheres and boxes scattered over 64 x 64 grid cells of two worldspaces, two in three with a falloff band
+	std::vector<Zones::ZoneInput> MakeZones(std::size_t a_count, std::uint32_t a_seed) {
+		constexpr float                       extent = 32.0f * Zones::Grid::cellSize;
+		std::mt19937                          rng(a_seed);
+		std::uniform_real_distribution<float> coord(-extent, extent);
+		std::uniform_real_distribution<float> height(-2000.0f, 8000.0f);
+		std::uniform_real_distribution<float> size(1000.0f, 20000.0f);
+		std::uniform_real_distribution<float> strength(0.0f, 1.5f);
+		std::uniform_real_distribution<float> range(20.0f, 600.0f);
+
+		std::vector<Zones::ZoneInput> zones(a_count);
+		for (std::size_t i = 0; i < a_count; ++i) {
+			auto& zone      = zones[i];
+			zone.enabled    = (i % 11) != 10;
+			zone.worldspace = (i % 4) == 3 ? kWorldspace + 1 : kWorldspace;
+			zone.strength   = strength(rng);
+			zone.range      = range(rng);
+
+			const Zones::Point corner{ coord(rng), coord(rng), height(rng) };
+			const float        extentXY = size(rng);
+			if (i % 2) {
+				zone.shape = Zones::Shape::kBox;
+				zone.min   = corner;
+				zone.max   = { corner.x + extentXY, corner.y + extentXY * 0.5f, corner.z + 6000.0f };
+			} else {
+				zone.center = corner;
+				zone.radius = extentXY;
+			}
+			zone.falloff = (i % 3) ? extentXY * 0.25f : 0.0f;
+		}
+		return zones;
+	}
+
+	// ------------------------------------------------------------
+	// Simulation
+	// ------------------------------------------------------------
+
+	int RunSimulation(std::uint64_t a_frames, std::uint32_t a_seed, const char* a_tracePath = nullptr) {
+		constexpr std::size_t rowCount = 64;
+
+		auto             rows      = MakeRows(rowCount, a_seed);
+		const auto       automatic = AutoBlur::Build(MakeTraits(rowCount * 2, a_seed), {});
+		Blur::Controller controller;
+		controller.Compile(rows);
+		controller.SetAutomatic(automatic);
+
+		Zones::Grid    zones;
+		Zones::Tracker tracker;
+		zones.Compile(MakeZones(96, a_seed));
+
+		SimSky  sky;
+		SimImod imod;
+		double  walked = 0.0;  // Seconds, the player circles the zones once every 5 minutes, at a gallop
+
+		std::mt19937                                 rng(a_seed);
+		std::uniform_int_distribution<std::uint32_t> weatherPick(0, rowCount * 2);  // Half of the picks fall back to derived values
+		std::uniform_int_distribution<int>           holdFrames(120, 2400);
+		std::uniform_int_distribution<int>           fpsPick(0, 3);
+		std::uniform_real_distribution<float>        jitter(0.9f, 1.1f);
+		std::uniform_int_distribution<int>           loadScreen(0, 49);  // 1 in 50 weather changes drops the instance
+		constexpr float                              fpsTable[] = { 30.0f, 60.0f, 144.0f, 0.0f };
+
+		std::uint64_t weatherChanges = 0;
+		std::uint64_t parks          = 0;
+		std::uint64_t unparks        = 0;
+		std::uint64_t retriggers     = 0;
+		int           framesLeft     = 0;
+		float         fps            = 60.0f;
+		Trace::Ring   recorder;
+
+		for (std::uint64_t frame = 0; frame < a_frames; ++frame) {
+			if (framesLeft-- <= 0) {
+				sky.SetWeather(kFirstWeather + weatherPick(rng));
+				framesLeft = holdFrames(rng);
+
+				const auto pick = fpsTable[fpsPick(rng)];
+				fps             = pick > 0.0f ? pick : 20.0f + static_cast<float>(frame % 140);  // 0 = variable frame rate
+
+				if (loadScreen(rng) == 0) imod.alive = false;
+			}
+
+			const auto delta  = jitter(rng) / fps;
+			const auto angle  = static_cast<float>((walked += delta) * 2.0 * 3.14159265358979 / 300.0);
+			tracker.Update(zones, kWorldspace, { 40000.0f * std::cos(angle), 40000.0f * std::sin(angle), 1000.0f });
+			controller.SetZone(tracker.Get());
+
+			const bool alive  = imod.alive;
+			const auto start  = std::chrono::steady_clock::now();
+			const auto events = controller.Update(delta, Blur::Mode::kAutomatic, sky, imod);
+			if (a_tracePath) {
+				const auto cost = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+				recorder.Push(Trace::Capture(controller, delta, sky, alive, events, 1, static_cast<std::uint64_t>(cost)));
+			}
+			if (events & Blur::kWeatherChanged) ++weatherChanges;
+			if (events & Blur::kParked) ++parks;
+			if (events & Blur::kUnparked) ++unparks;
+			if (events & Blur::kRetriggered) ++retriggers;
+		}
+
+		std::printf("Simulated %llu frames (seed %u, %zu rows, %zu automatic entries, %zu blur zones)\n", static_cast<unsigned long long>(a_frames), a_seed,
+			rowCount, controller.GetAutomaticSize(), zones.Size());
+		std::printf("  weather changes : %llu\n", static_cast<unsigned long long>(weatherChanges));
+		std::printf("  DOF writes      : %llu\n", static_cast<unsigned long long>(imod.dofWrites));
+		std::printf("  channel writes  : %llu\n", static_cast<unsigned long long>(imod.channelWrites));
+		std::printf("  triggers/stops  : %llu / %llu (%llu re-triggered after a drop)\n", static_cast<unsigned long long>(imod.triggers), static_cast<unsigned long long>(imod.stops),
+			static_cast<unsigned long long>(retriggers));
+		std::printf("  parks/unparks   : %llu / %llu\n", static_cast<unsigned long long>(parks), static_cast<unsigned long long>(unparks));
+		std::printf("  zone lookups    : %llu\n", static_cast<unsigned long long>(tracker.Lookups()));
+		std::printf("  final applied   : strength %.4f, range %.2f (active: %s)\n",
+			controller.GetAppliedStrength(), controller.GetAppliedRange(), controller.IsEffectActive() ? "yes" : "no");
+
+		if (a_tracePath) {
+			Published::Tables tables;
+			tables.rows = rows;
+
+			// Written the way the crash handler writes it, which has to come out the same as encoding it whole
+			Trace::CrashFile crashFile;
+			crashFile.Prepare(tables, automatic, 1);
+
+			const auto frames  = recorder.Frames();
+			const auto encoded = crashFile.Fill(recorder);
+			if (!std::ranges::equal(encoded, Trace::Encode(frames, tables, automatic, 1)) || !crashFile.Fill(recorder).empty()) {
+				std::fprintf(stderr, "the prepared crash trace does not match the encoded one\n");
+				return 1;
+			}
+
+			std::ofstream file(a_tracePath, std::ios::binary);
+			if (!file.write(encoded.data(), static_cast<std::streamsize>(encoded.size()))) {
+				std::fprintf(stderr, "could not write '%s'\n", a_tracePath);
+				return 1;
+			}
+			std::printf("  trace           : last %zu frames written to '%s'\n", frames.size(), a_tracePath);
+		}
+		return 0;
+	}
+
+	// ------------------------------------------------------------
+	// Frame rate independence
+	// ------------------------------------------------------------
+
+	// Applied DOF and tint at every sample point of a fixed weather script. Frames never straddle a script
+	// event or a sample point, so every rate sees the same inputs at the same moments.
+	std::vector<std::array<float, 3>> RunScript(std::span<const Blur::RowInput> a_rows, std::uint32_t a_seed, double a_frameTime) {
+		struct Event {
+			double        time;
+			std::uint32_t weather;
+		};
+		// Mid-transition switches, a fade out with the previous row's transition, a curve, channels, a static row
+		constexpr Event script[] = { { 0.0, 0 }, { 3.0, 1 }, { 10.0, 99 }, { 15.0, 2 }, { 25.0, 3 }, { 27.0, 4 }, { 32.0, 0 } };
+		constexpr double length     = 45.0;
+		constexpr double samplerate = 6.0;
+
+		Blur::Controller controller;
+		controller.Compile(a_rows);
+
+		SimSky  sky;
+		SimImod imod;
+
+		std::mt19937                           rng(a_seed);
+		std::uniform_real_distribution<double> variable(1.0 / 165.0, 1.0 / 20.0);
+
+		std::vector<std::array<float, 3>> samples;
+		std::size_t                       nextEvent  = 0;
+		std::uint64_t                     nextSample = 0;
+		double                            time       = 0.0;
+		float                             delta      = 0.0f;
+
+		while (time <= length) {
+			while (nextEvent < std::size(script) && script[nextEvent].time <= time) {
+				sky.SetWeather(kFirstWeather + script[nextEvent++].weather);
+			}
+			sky.hour = static_cast<float>(6.0 + time * 0.25);  // Fast enough for the curve to move between samples
+
+			controller.Update(delta, Blur::Mode::kAdvanced, sky, imod);
+
+			const double sampleTime = static_cast<double>(nextSample) / samplerate;
+			if (time >= sampleTime) {
+				samples.push_back({ controller.GetAppliedStrength(), controller.GetAppliedRange(), controller.GetAppliedChannels()[Imod::kTintAlpha] });
+				++nextSample;
+			}
+
+			double next = time + (a_frameTime > 0.0 ? a_frameTime : variable(rng));
+			next        = std::min(next, static_cast<double>(nextSample) / samplerate);
+			if (nextEvent < std::size(script)) next = std::min(next, script[nextEvent].time);
+
+			delta = static_cast<float>(next - time);
+			time  = next;
+		}
+		return samples;
+	}
+
+	int RunFrameRateCheck() {
+		const std::vector<TimeCurve::Keyframe> day      = { { 6.0f, 0.1f, 100.0f }, { 12.0f, 0.9f, 600.0f }, { 18.0f, 0.4f, 200.0f } };
+		const std::vector<Imod::ChannelTarget> channels = { { Imod::kTintAlpha, 0.4f }, { Imod::kCinematicSaturation, 0.6f } };
+
+		const std::vector<Blur::RowInput> rows = {
+			{ kFirstWeather + 0, true, 0.8f, 300.0f, false, 5.0f, Easing::kExponential, {}, {} },
+			{ kFirstWeather + 1, true, 0.3f, 120.0f, false, 2.0f, Easing::kLinear, {}, {} },
+			{ kFirstWeather + 2, true, 0.5f, 200.0f, false, 4.0f, Easing::kSmoothStep, day, {} },
+			{ kFirstWeather + 3, true, 0.6f, 250.0f, false, 3.0f, Easing::kEaseInOut, {}, channels },
+			{ kFirstWeather + 4, true, 1.0f, 500.0f, true, 3.0f, Easing::kEaseIn, {}, {} },
+		};
+
+		struct Rate {
+			const char* name;
+			double      frameTime;  // 0 = variable
+		};
+		constexpr Rate rates[] = { { "60 FPS", 1.0 / 60.0 }, { "30 FPS", 1.0 / 30.0 }, { "144 FPS", 1.0 / 144.0 }, { "variable", 0.0 },
+			{ "skipping", 1.0 / 6.0 } };
+
+		const auto reference = RunScript(rows, 7, rates[0].frameTime);
+
+		std::printf("%10s %10s %16s %16s %16s\n", "rate", "samples", "max strength err", "max range err", "max tint err");
+
+		bool failed = false;
+		for (const auto& rate : rates) {
+			const auto samples = RunScript(rows, 7, rate.frameTime);
+
+			std::array<float, 3> error{};
+			for (std::size_t i = 0; i < std::min(samples.size(), reference.size()); i++) {
+				for (std::size_t lane = 0; lane < error.size(); lane++) {
+					error[lane] = std::max(error[lane], std::abs(samples[i][lane] - reference[i][lane]));
+				}
+			}
+			std::printf("%10s %10zu %16.2e %16.2e %16.2e\n", rate.name, samples.size(), error[0], error[1], error[2]);
+
+			// A frame count that does not divide the sample period leaves the clock an ulp or so off, ranges are
+			// in game units (up to ~6000) so their ulp is larger
+			failed |= samples.size() != reference.size() || error[0] > 1e-6f || error[1] > 1e-3f || error[2] > 1e-6f;
+		}
+
+		if (failed) {
+			std::fprintf(stderr, "fps check: transitions differ between frame rates\n");
+			return 1;
+		}
+		return 0;
+	}
+
+	// ------------------------------------------------------------
+	// Packed channel blend
+	// ------------------------------------------------------------
+
+	// Imod::ChannelState::Step written out one lane at a time, without the packed loads or the DOF-only shortcut
+	// being shared with it, so the two can be held against each other bit for bit.
+	struct ScalarChannels {
+		Imod::Values  applied{};
+		Imod::Values  target{};
+		Imod::Values  start{};
+		double        elapsed      = 0.0;
+		double        duration     = 0.0;
+		Easing::Curve easing       = Easing::defaultCurve;
+		bool          extrasMoving = false;
+
+		std::uint32_t Step() {
+			const float weight = duration > 0.0 ? Easing::table.Sample(easing, static_cast<float>(elapsed / duration)) : 1.0f;
+			if (!extrasMoving && applied[Imod::kDOFStrength] == target[Imod::kDOFStrength] && applied[Imod::kDOFRange] == target[Imod::kDOFRange]) return 0;
+
+			std::uint32_t changed = 0;
+			for (std::uint32_t i = 0; i < Imod::kChannelCount; i++) {
+				float next = applied[i];
+				if ((1u << i) & Imod::dofMask) {
+					next = std::lerp(start[i], target[i], weight);
+				} else if (extrasMoving) {
+					next = weight >= 1.0f ? target[i] : start[i] + weight * (target[i] - start[i]);
+				}
+				if (next != applied[i]) changed |= 1u << i;
+				applied[i] = next;
+			}
+			extrasMoving = extrasMoving && weight < 1.0f;
+			return changed;
+		}
+	};
+
+	// Random transitions, target moves and frame times played into the packed and the scalar blend at once.
+	// Returns the hashes of every applied value and changed mask from each.
+	std::pair<std::uint64_t, std::uint64_t> RunChannelTrace(std::uint64_t a_frames, std::uint32_t a_seed) {
+		std::mt19937                          rng(a_seed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		Imod::ChannelState packed;
+		ScalarChannels     scalar;
+		std::uint64_t      packedHash = 0xCBF29CE484222325ull;
+		std::uint64_t      scalarHash = 0xCBF29CE484222325ull;
+
+		const auto mix = [](std::uint64_t& a_hash, std::uint32_t a_value) {
+			a_hash = (a_hash ^ a_value) * 0x100000001B3ull;
+		};
+
+		for (std::uint64_t frame = 0; frame < a_frames; frame++) {
+			const auto roll = rng() % 4000;
+
+			if (roll < 2) {
+				// A weather change: new DOF, and on every other one a few extra channels
+				Imod::Values target = packed.target;
+				target[Imod::kDOFStrength] = unit(rng) < 0.2f ? 0.0f : unit(rng);
+				target[Imod::kDOFRange]    = unit(rng) * 5000.0f;
+				if (roll == 0) {
+					for (std::uint32_t i = 2; i < Imod::kChannelCount; i++) {
+						if (rng() % 3 == 0) target[i] = unit(rng) * 2.0f;
+					}
+				}
+
+				const float duration = rng() % 5 == 0 ? 0.0f : unit(rng) * 8.0f;
+				const auto  easing   = static_cast<Easing::Curve>(rng() % Easing::kCurveCount);
+
+				packed.target       = target;
+				packed.extrasMoving = (Imod::DifferingLanes(packed.applied, target) & ~Imod::dofMask) != 0;
+				packed.Begin(duration, easing);
+
+				scalar.target       = target;
+				scalar.extrasMoving = packed.extrasMoving;
+				scalar.start        = scalar.applied;
+				scalar.elapsed      = 0.0;
+				scalar.duration     = duration > 0.0f ? duration : 0.0;
+				scalar.easing       = easing;
+			} else if (roll < 4) {
+				// A time-of-day curve moving the DOF target on its own, mid-transition or not
+				const float strength = unit(rng);
+				packed.target[Imod::kDOFStrength] = scalar.target[Imod::kDOFStrength] = strength;
+			}
+
+			const float delta = rng() % 500 == 0 ? 0.5f : 1.0f / 240.0f + unit(rng) * (1.0f / 20.0f);
+			packed.Advance(delta);
+			if (scalar.elapsed < scalar.duration) scalar.elapsed = std::min(scalar.elapsed + delta, scalar.duration);
+
+			mix(packedHash, packed.Step());
+			mix(scalarHash, scalar.Step());
+			for (std::uint32_t i = 0; i < Imod::kChannelCount; i++) {
+				mix(packedHash, std::bit_cast<std::uint32_t>(packed.applied[i]));
+				mix(scalarHash, std::bit_cast<std::uint32_t>(scalar.applied[i]));
+			}
+		}
+		return { packedHash, scalarHash };
+	}
+
+	int RunChannelCheck(std::uint64_t a_frames) {
+		constexpr std::uint32_t seeds[] = { 1, 2, 3 };
+		bool                    failed  = false;
+
+#ifdef DB_IMOD_SSE
+		std::printf("Packed (SSE2) against scalar channel blend:\n");
+#else
+		std::printf("Packed (no SSE2, scalar fallback) against scalar channel blend:\n");
+#endif
+		std::printf("%10s %12s %18s %18s\n", "seed", "frames", "packed hash", "scalar hash");
+		for (const auto seed : seeds) {
+			const auto frames          = a_frames / std::size(seeds);
+			const auto [packed, scalar] = RunChannelTrace(frames, seed);
+			std::printf("%10u %12llu    %016llX   %016llX%s\n", seed, static_cast<unsigned long long>(frames), static_cast<unsigned long long>(packed),
+				static_cast<unsigned long long>(scalar), packed == scalar ? "" : "  DIFFERS");
+			failed |= packed != scalar;
+		}
+
+		if (failed) {
+			std::fprintf(stderr, "channels check: the packed blend is not bit-identical to the scalar one\n");
+			return 1;
+		}
+		return 0;
+	}
+
+	// ------------------------------------------------------------
+	// Benchmarks
+	// ------------------------------------------------------------
+
+	template <typename Fn>
+	double NanosecondsPerOp(std::uint64_t a_iterations, Fn&& a_fn) {
+		const auto start = std::chrono::steady_clock::now();
+		for (std::uint64_t i = 0; i < a_iterations; ++i) {
+			a_fn(i);
+		}
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(a_iterations);
+	}
+
+	int RunBenchmarks() {
+		volatile float sink = 0.0f;
+
+		std::printf("%10s %16s %16s %16s %16s %16s %18s\n", "rows", "steady ns/upd", "change ns/upd", "auto ns/upd", "curve ns/upd", "16ch ns/upd", "reload ns/compile");
+
+		// Every row of the curve pass carries the same 4-key day, so the cost measured is the per-frame LUT sample
+		const std::vector<TimeCurve::Keyframe> day = { { 0.0f, 0.8f, 120.0f }, { 6.0f, 0.2f, 400.0f }, { 18.0f, 0.3f, 350.0f }, { 21.0f, 0.7f, 150.0f } };
+
+		// And every row of the channel pass sets all of the non-DOF channels, so each weather change moves 16 lanes
+		std::vector<Imod::ChannelTarget> allChannels;
+		for (std::uint32_t channel = Imod::kBloomBlurRadius; channel < Imod::kChannelCount; ++channel) {
+			allChannels.push_back({ static_cast<Imod::Channel>(channel), 0.1f * static_cast<float>(channel) });
+		}
+
+		for (const std::size_t rowCount : { 10, 100, 1000, 10000 }) {
+			const auto rows = MakeRows(rowCount, 1234);
+
+			Blur::Controller controller;
+			controller.Compile(rows);
+
+			SimSky  sky;
+			SimImod imod;
+			sky.SetWeather(kFirstWeather + static_cast<std::uint32_t>(rowCount / 2));
+
+			// Settle the transition so the steady state is measured, not the fade.
+			for (int i = 0; i < 10000; ++i) {
+				controller.Update(1.0f / 60.0f, Blur::Mode::kAdvanced, sky, imod);
+			}
+
+			const double steady = NanosecondsPerOp(2'000'000, [&](std::uint64_t) {
+				controller.Update(1.0f / 60.0f, Blur::Mode::kAdvanced, sky, imod);
+				sink = controller.GetAppliedStrength();
+			});
+
+			const double change = NanosecondsPerOp(1'000'000, [&](std::uint64_t i) {
+				sky.SetWeather(kFirstWeather + static_cast<std::uint32_t>((i * 2654435761u) % (rowCount * 2)));
+				controller.Update(1.0f / 60.0f, Blur::Mode::kAdvanced, sky, imod);
+				sink = controller.GetAppliedStrength();
+			});
+
+			// Same switches, with the half of the weathers that have no row falling back to derived values
+			controller.SetAutomatic(AutoBlur::Build(MakeTraits(rowCount * 2, 1234), {}));
+			const double automatic = NanosecondsPerOp(1'000'000, [&](std::uint64_t i) {
+				sky.SetWeather(kFirstWeather + static_cast<std::uint32_t>((i * 2654435761u) % (rowCount * 2)));
+				controller.Update(1.0f / 60.0f, Blur::Mode::kAutomatic, sky, imod);
+				sink = controller.GetAppliedStrength();
+			});
+
+			auto curvedRows = rows;
+			for (auto& row : curvedRows) row.curve = day;
+
+			Blur::Controller curved;
+			curved.Compile(curvedRows);
+			const double curve = NanosecondsPerOp(2'000'000, [&](std::uint64_t i) {
+				sky.hour = static_cast<float>(i % 24000) * 0.001f;
+				curved.Update(1.0f / 60.0f, Blur::Mode::kAdvanced, sky, imod);
+				sink = curved.GetAppliedStrength();
+			});
+
+			auto channelRows = rows;
+			for (auto& row : channelRows) row.channels = allChannels;
+
+			Blur::Controller multi;
+			multi.Compile(channelRows);
+			const double channels = NanosecondsPerOp(1'000'000, [&](std::uint64_t i) {
+				sky.SetWeather(kFirstWeather + static_cast<std::uint32_t>((i * 2654435761u) % (rowCount * 2)));
+				multi.Update(1.0f / 60.0f, Blur::Mode::kAdvanced, sky, imod);
+				sink = multi.GetAppliedStrength();
+			});
+
+			const std::uint64_t reloads = rowCount >= 10000 ? 200 : 20000;
+			const double        reload  = NanosecondsPerOp(reloads, [&](std::uint64_t) {
+				controller.Compile(rows);
+				sink = static_cast<float>(controller.GetIndexSize());
+			});
+
+			std::printf("%10zu %16.1f %16.1f %16.1f %16.1f %16.1f %18.1f\n", rowCount, steady, change, automatic, curve, channels, reload);
+		}
+
+		(void)sink;
+		return 0;
+	}
+
+	// Same shape as MCP::Advanced::WeatherSettingRow, which needs CommonLibSSE to include.
+	struct SimSettingRow {
+		bool        rowToggle       = true;
+		std::string rowWeatherType  = "None";
+		float       rowBlurStrength = 1.0f;
+		float       rowBlurRange    = 100.0f;
+		bool        rowStaticToggle = false;
+
+		float         rowDuration = Easing::defaultDuration;
+		Easing::Curve rowEasing   = Easing::defaultCurve;
+
+		std::vector<TimeCurve::Keyframe> rowCurve;
+		std::vector<Imod::ChannelTarget> rowChannels;
+	};
+
+	// The weather list as Settings::Json::Serialize writes it, without needing RapidJSON
+	std::string SerializeRows(std::span<const SimSettingRow> a_rows) {
+		std::string json = R"({"MCP":{"Advanced":{"WeatherSettings":[)";
+		char        buffer[256];
+
+		for (const auto& row : a_rows) {
+			if (&row != a_rows.data()) json += ',';
+
+			const auto easing = Easing::curveNames[row.rowEasing];
+			std::snprintf(buffer, sizeof(buffer),
+				R"({"rowToggle":%s,"rowWeather":"%s","blurStrength":%g,"blurRange":%g,"staticToggle":%s,"transitionDuration":%g,"easing":"%.*s")",
+				row.rowToggle ? "true" : "false", row.rowWeatherType.c_str(), row.rowBlurStrength, row.rowBlurRange, row.rowStaticToggle ? "true" : "false",
+				row.rowDuration, static_cast<int>(easing.size()), easing.data());
+			json += buffer;
+
+			if (!row.rowCurve.empty()) {
+				json += R"(,"curve":[)";
+				for (const auto& key : row.rowCurve) {
+					std::snprintf(buffer, sizeof(buffer), R"(%s{"hour":%g,"blurStrength":%g,"blurRange":%g})", &key != row.rowCurve.data() ? "," : "", key.hour,
+						key.strength, key.range);
+					json += buffer;
+				}
+				json += ']';
+			}
+			if (!row.rowChannels.empty()) {
+				json += R"(,"channels":{)";
+				for (const auto& target : row.rowChannels) {
+					const auto name = Imod::channelNames[target.channel];
+					std::snprintf(buffer, sizeof(buffer), R"(%s"%.*s":%g)", &target != row.rowChannels.data() ? "," : "", static_cast<int>(name.size()), name.data(),
+						target.value);
+					json += buffer;
+				}
+				json += '}';
+			}
+			json += '}';
+		}
+		json += "]}}}";
+		return json;
+	}
+
+#ifdef BLUR_SIM_RAPIDJSON
+	// What Settings::Json::Parse does for weather rows, the path taken whenever the snapshot is missing or stale
+	bool ParseRows(std::string_view a_json, std::vector<SimSettingRow>& a_rows) {
+		rapidjson::Document doc;
+		doc.Parse(a_json.data(), a_json.size());
+		if (doc.HasParseError() || !doc.IsObject() || !doc.HasMember("MCP")) return false;
+
+		const auto& mcp = doc["MCP"];
+		if (!mcp.HasMember("Advanced") || !mcp["Advanced"].HasMember("WeatherSettings") || !mcp["Advanced"]["WeatherSettings"].IsArray()) return false;
+
+		for (const auto& row : mcp["Advanced"]["WeatherSettings"].GetArray()) {
+			SimSettingRow entryRow;
+			entryRow.rowToggle       = row.HasMember("rowToggle")    ? row["rowToggle"].GetBool()     : true;
+			entryRow.rowWeatherType  = row.HasMember("rowWeather")   ? row["rowWeather"].GetString()  : "None";
+			entryRow.rowBlurStrength = row.HasMember("blurStrength") ? row["blurStrength"].GetFloat() : 1.0f;
+			entryRow.rowBlurRange    = row.HasMember("blurRange")    ? row["blurRange"].GetFloat()    : 100.0f;
+			entryRow.rowStaticToggle = row.HasMember("staticToggle") ? row["staticToggle"].GetBool()  : false;
+			entryRow.rowDuration     = row.HasMember("transitionDuration") ? std::max(row["transitionDuration"].GetFloat(), 0.0f) : Easing::defaultDuration;
+
+			if (row.HasMember("easing") && row["easing"].IsString()) {
+				entryRow.rowEasing = Easing::CurveFromName({ row["easing"].GetString(), row["easing"].GetStringLength() }).value_or(Easing::defaultCurve);
+			}
+			if (row.HasMember("curve") && row["curve"].IsArray()) {
+				for (const auto& key : row["curve"].GetArray()) {
+					if (!key.IsObject()) continue;
+					TimeCurve::Keyframe keyframe;
+					keyframe.hour     = key.HasMember("hour")         ? key["hour"].GetFloat()         : 0.0f;
+					keyframe.strength = key.HasMember("blurStrength") ? key["blurStrength"].GetFloat() : entryRow.rowBlurStrength;
+					keyframe.range    = key.HasMember("blurRange")    ? key["blurRange"].GetFloat()    : entryRow.rowBlurRange;
+					entryRow.rowCurve.push_back(keyframe);
+				}
+			}
+			if (row.HasMember("channels") && row["channels"].IsObject()) {
+				for (const auto& member : row["channels"].GetObject()) {
+					const auto channel = Imod::ChannelFromName({ member.name.GetString(), member.name.GetStringLength() });
+					if (channel && member.value.IsNumber()) entryRow.rowChannels.push_back({ *channel, member.value.GetFloat() });
+				}
+			}
+			a_rows.push_back(std::move(entryRow));
+		}
+		return true;
+	}
+#endif
+
+	int RunSnapshotBenchmarks() {
+		volatile std::size_t sink = 0;
+
+		// Loading the snapshot includes hashing the JSON next to it, which Settings::Binary::Load() does every time
+		std::printf("%10s %12s %16s %16s %12s %16s %16s\n", "rows", "bytes", "encode us", "load us", "json bytes", "json hash us", "json parse us");
+
+		for (const std::size_t rowCount : { 10, 1000, 10000 }) {
+			std::vector<SimSettingRow> rows(rowCount);
+			for (std::size_t i = 0; i < rowCount; ++i) {
+				char name[64];
+				std::snprintf(name, sizeof(name), "SkyrimWeatherVariant_%05zu", i);
+				rows[i] = { (i % 5) != 0, name, 0.25f + static_cast<float>(i % 4) * 0.25f, 100.0f + static_cast<float>(i % 50) * 10.0f, (i % 7) == 0, 1.0f + static_cast<float>(i % 6),
+					static_cast<Easing::Curve>(i % Easing::kCurveCount), {}, {} };
+				if (i % 3 == 0) rows[i].rowCurve = { { 6.0f, 0.2f, 150.0f }, { 20.0f, 0.8f, 400.0f } };
+				if (i % 4 == 0) rows[i].rowChannels = { { Imod::kTintAlpha, 0.3f }, { Imod::kCinematicSaturation, 0.8f } };
+			}
+
+			const auto                     json = SerializeRows(rows);
+			const SettingsSnapshot::Source source{ SettingsSnapshot::HashContent(json), 133'000'000'000'000'000ll, json.size() };
+			const auto                     encoded = SettingsSnapshot::Encode(std::span<const SimSettingRow>{ rows }, source);
+			const auto                     bytes   = std::as_bytes(std::span{ encoded });
+
+			const std::uint64_t iterations = rowCount >= 10000 ? 200 : 20000;
+
+			const double encode = NanosecondsPerOp(iterations, [&](std::uint64_t) {
+				sink = SettingsSnapshot::Encode(std::span<const SimSettingRow>{ rows }, source).size();
+			});
+
+			const double load = NanosecondsPerOp(iterations, [&](std::uint64_t) {
+				std::vector<SimSettingRow> loaded;
+				const auto                 stored = SettingsSnapshot::ReadSource(bytes);
+				if (stored && stored->hash == SettingsSnapshot::HashContent(json) && SettingsSnapshot::Decode(bytes, loaded)) {
+					sink = loaded.size();
+				}
+			});
+
+			std::vector<SimSettingRow> check;
+			if (!SettingsSnapshot::Decode(bytes, check) || check.size() != rowCount || check.back().rowWeatherType != rows.back().rowWeatherType ||
+				check.back().rowEasing != rows.back().rowEasing || check.back().rowDuration != rows.back().rowDuration ||
+				check.front().rowCurve != rows.front().rowCurve || check.front().rowChannels != rows.front().rowChannels) {
+				std::fprintf(stderr, "snapshot round trip failed for %zu rows\n", rowCount);
+				return 1;
+			}
+
+			const double hash = NanosecondsPerOp(iterations, [&](std::uint64_t) {
+				sink = static_cast<std::size_t>(SettingsSnapshot::HashContent(json));
+			});
+
+#ifdef BLUR_SIM_RAPIDJSON
+			const double parse = NanosecondsPerOp(rowCount >= 10000 ? 20 : 2000, [&](std::uint64_t) {
+				std::vector<SimSettingRow> parsed;
+				if (ParseRows(json, parsed)) sink = parsed.size();
+			});
+
+			std::vector<SimSettingRow> parsed;
+			if (!ParseRows(json, parsed) || parsed.size() != rowCount || parsed.back().rowWeatherType != rows.back().rowWeatherType ||
+				parsed.front().rowCurve.size() != rows.front().rowCurve.size() || parsed.front().rowChannels.size() != rows.front().rowChannels.size()) {
+				std::fprintf(stderr, "JSON round trip failed for %zu rows\n", rowCount);
+				return 1;
+			}
+
+			std::printf("%10zu %12zu %16.2f %16.2f %12zu %16.2f %16.2f\n", rowCount, encoded.size(), encode / 1000.0, load / 1000.0, json.size(), hash / 1000.0,
+				parse / 1000.0);
+#else
+			std::printf("%10zu %12zu %16.2f %16.2f %12zu %16.2f %16s\n", rowCount, encoded.size(), encode / 1000.0, load / 1000.0, json.size(), hash / 1000.0,
+				"no RapidJSON");
+#endif
+		}
+
+		(void)sink;
+		return 0;
+	}
+
+	// ------------------------------------------------------------
+	// Automatic mode
+	// ------------------------------------------------------------
+
+	// Settled DOF for one weather, from a fresh controller so nothing carries over
+	std::pair<float, float> Settle(std::span<const Blur::RowInput> a_rows, std::span<const AutoBlur::Derived> a_automatic, Blur::Mode a_mode,
+		std::uint32_t a_weather) {
+		Blur::Controller controller;
+		controller.Compile(a_rows);
+		controller.SetAutomatic(a_automatic);
+
+		SimSky  sky;
+		SimImod imod;
+		sky.SetWeather(a_weather);
+		for (int i = 0; i < 60 * 10; ++i) {
+			controller.Update(1.0f / 60.0f, a_mode, sky, imod);
+		}
+		return { controller.GetAppliedStrength(), controller.GetAppliedRange() };
+	}
+
+	int RunAutomaticCheck() {
+		constexpr std::size_t rowCount = 64;
+
+		const auto rows   = MakeRows(rowCount, 7);
+		const auto traits = MakeTraits(rowCount * 2, 7);
+
+		const AutoBlur::Tuning tuning;
+		const auto             automatic = AutoBlur::Build(traits, tuning);
+
+		std::size_t checked = 0;
+		std::size_t failed  = 0;
+		for (const auto& weather : traits) {
+			const auto row     = std::ranges::find(rows, weather.formID, &Blur::RowInput::formID);
+			const auto derived = AutoBlur::Derive(weather, tuning);
+
+			// Rows win in both modes, the derived values only show in automatic mode
+			std::pair<float, float> expected{ 0.0f, 0.0f };
+			if (row != rows.end()) {
+				expected = { row->strength, row->range * 10 };
+			} else if (derived) {
+				expected = { derived->strength, derived->range * 10 };
+			}
+			const std::pair<float, float> advanced = row != rows.end() ? expected : std::pair{ 0.0f, 0.0f };
+
+			failed += Settle(rows, automatic, Blur::Mode::kAutomatic, weather.formID) != expected;
+			failed += Settle(rows, automatic, Blur::Mode::kAdvanced, weather.formID) != advanced;
+			checked += 2;
+		}
+
+		// Deriving the table again is what an INI edit to [Automatic] costs
+		const auto   many  = MakeTraits(10000, 7);
+		std::size_t  sizes = 0;
+		const double build = NanosecondsPerOp(200, [&](std::uint64_t) { sizes += AutoBlur::Build(many, tuning).size(); });
+
+		std::printf("Automatic mode: %zu of %zu weathers derived, %zu settled states checked, %zu wrong\n", automatic.size(), traits.size(), checked, failed);
+		std::printf("  derive 10,000   : %.1f us (%zu entries)\n", build / 1000.0, sizes / 200);
+
+		if (failed) {
+			std::fprintf(stderr, "auto check: settled values do not match the rows and derived table\n");
+			return 1;
+		}
+		return 0;
+	}
+
+	// ------------------------------------------------------------
+	// Context rules
+	// ------------------------------------------------------------
+
+	int RunRulesCheck() {
+		constexpr std::uint32_t kSnow     = kFirstWeather;
+		constexpr std::uint32_t kRain     = kFirstWeather + 1;
+		constexpr std::uint32_t kKeyword  = 0x00013000;
+		int                     failures  = 0;
+
+		const auto report = [&](const char* a_label, bool a_ok) {
+			std::printf("  %-26s : %s\n", a_label, a_ok ? "OK" : "FAILED");
+			if (!a_ok) ++failures;
+		};
+
+		// Settings index of the rule that wins, -1 for none
+		const auto winner = [](const Rules::DecisionTable& a_table, const Rules::Context& a_context) {
+			return a_table.SourceOf(a_table.Evaluate(a_context));
+		};
+
+		std::printf("Context rules:\n");
+
+		// Top to bottom, first match wins even when a later rule is more specific. Disabled rules are skipped
+		// but keep their settings index.
+		{
+			std::vector<Rules::RuleInput> rules(4);
+			rules[0] = { false, kSnow, Rules::Cell::kAny, 0, {}, 0, 0, 0.1f, 100.0f, false, 0 };
+			rules[1] = { true, kSnow, Rules::Cell::kInterior, 0, {}, 0, 0, 0.2f, 100.0f, false, 1 };
+			rules[2] = { true, 0, Rules::Cell::kAny, kWorldspace, {}, 0, 0, 0.3f, 100.0f, false, 2 };
+			rules[3] = { true, kSnow, Rules::Cell::kExterior, kWorldspace, {}, 0, 0, 0.4f, 100.0f, false, 3 };
+
+			Rules::DecisionTable table;
+			table.Compile(rules);
+
+			const bool order = winner(table, { kSnow, true, kWorldspace, {}, 12 }) == 1 && winner(table, { kSnow, false, kWorldspace, {}, 12 }) == 2 &&
+			                   winner(table, { kRain, true, kWorldspace, {}, 12 }) == 2 && winner(table, { kRain, true, kWorldspace + 1, {}, 12 }) == -1;
+			const auto value = table.Evaluate({ kSnow, true, kWorldspace, {}, 12 });
+			report("first match", order && table.Size() == 3 && value && value->strength == 0.2f && value->range == 1000.0f);
+		}
+
+		// [22, 4) wraps past midnight, [4, 22) is the rest of the day and [9, 9) all of it
+		{
+			std::vector<Rules::RuleInput> rules(3);
+			rules[0] = { true, 0, Rules::Cell::kAny, 0, {}, 22, 4, 1.0f, 100.0f, false, 0 };
+			rules[1] = { true, 0, Rules::Cell::kAny, 0, {}, 4, 22, 1.0f, 100.0f, false, 1 };
+			rules[2] = { true, 0, Rules::Cell::kAny, 0, {}, 9, 9, 1.0f, 100.0f, false, 2 };
+
+			Rules::DecisionTable night;
+			night.Compile(std::span{ rules }.first(1));
+			Rules::DecisionTable table;
+			table.Compile(rules);
+
+			bool wraps = night.DependsOnHour() && Rules::DecisionTable::HourMask(9, 9) == Rules::DecisionTable::allHours &&
+			             Rules::DecisionTable::HourMask(22, 4) == (Rules::DecisionTable::HourMask(4, 22) ^ Rules::DecisionTable::allHours);
+			for (std::uint32_t hour = 0; hour < 48; hour++) {
+				const bool atNight = hour % 24 >= 22 || hour % 24 < 4;
+				wraps &= winner(night, { kSnow, false, 0, {}, hour }) == (atNight ? 0 : -1);
+				wraps &= winner(table, { kSnow, false, 0, {}, hour }) == (atNight ? 0 : 1);
+			}
+			report("hour window past midnight", wraps);
+		}
+
+		// Interior and exterior rules only see their own cells, "any" sees both
+		{
+			std::vector<Rules::RuleInput> rules(3);
+			rules[0] = { true, kSnow, Rules::Cell::kInterior, 0, {}, 0, 0, 1.0f, 100.0f, false, 0 };
+			rules[1] = { true, kSnow, Rules::Cell::kExterior, 0, {}, 0, 0, 1.0f, 100.0f, false, 1 };
+			rules[2] = { true, kRain, Rules::Cell::kAny, 0, {}, 0, 0, 1.0f, 100.0f, false, 2 };
+
+			Rules::DecisionTable table;
+			table.Compile(rules);
+			report("cell mask", winner(table, { kSnow, true, 0, {}, 0 }) == 0 && winner(table, { kSnow, false, 0, {}, 0 }) == 1 &&
+			                        winner(table, { kRain, true, 0, {}, 0 }) == 2 && winner(table, { kRain, false, 0, {}, 0 }) == 2);
+		}
+
+		// 70 rules with a keyword each: the first 64 keywords get a bit, the rules past that never match, not even
+		// where their own keyword is, unless they also list one that has a bit.
+		{
+			constexpr std::size_t         kRules = Rules::DecisionTable::maxKeywords + 6;
+			std::vector<Rules::RuleInput> rules(kRules + 1);
+			for (std::size_t i = 0; i < kRules; i++) {
+				rules[i] = { true, kSnow, Rules::Cell::kAny, 0, { kKeyword + static_cast<std::uint32_t>(i) }, 0, 0, 1.0f, 100.0f, false, static_cast<std::uint32_t>(i) };
+			}
+			rules[kRules] = { true, kRain, Rules::Cell::kAny, 0, { kKeyword + kRules, kKeyword + 5 }, 0, 0, 1.0f, 100.0f, false, static_cast<std::uint32_t>(kRules) };
+
+			Rules::DecisionTable table;
+			table.Compile(rules);
+
+			bool limited = table.DependsOnLocation() && table.DroppedKeywords() == kRules + 1 - Rules::DecisionTable::maxKeywords &&
+			               winner(table, { kSnow, false, 0, {}, 0 }) == -1;
+			for (std::size_t i = 0; i < kRules; i++) {
+				const std::uint32_t keyword[] = { 0x00012000, kKeyword + static_cast<std::uint32_t>(i) };
+				limited &= winner(table, { kSnow, false, 0, keyword, 0 }) == (i < Rules::DecisionTable::maxKeywords ? static_cast<std::int32_t>(i) : -1);
+			}
+
+			const std::uint32_t dropped[] = { kKeyword + kRules };
+			const std::uint32_t shared[]  = { kKeyword + 5 };
+			limited &= winner(table, { kRain, false, 0, dropped, 0 }) == -1 && winner(table, { kRain, false, 0, shared, 0 }) == static_cast<std::int32_t>(kRules);
+			report("64 keyword bits", limited);
+		}
+
+		std::printf("rules: %s\n", failures ? "FAILED" : "OK");
+		return failures ? 1 : 0;
+	}
+
+	// ------------------------------------------------------------
+	// Blur zones
+	// ------------------------------------------------------------
+
+	// Straight from the definition: every zone, last to first, no grid
+	Zones::Sample ReferenceSample(std::span<const Zones::ZoneInput> a_zones, std::uint32_t a_worldspace, const Zones::Point& a_position) {
+		Zones::Sample sample;
+		std::uint32_t signature = 2166136261u;
+		bool          any       = false;
+
+		for (std::size_t i = a_zones.size(); i-- > 0;) {
+			const auto& zone = a_zones[i];
+			if (!zone.enabled || zone.worldspace != a_worldspace) continue;
+
+			float inside = 0.0f;
+			if (zone.shape == Zones::Shape::kSphere) {
+				const float dx = a_position.x - zone.center.x;
+				const float dy = a_position.y - zone.center.y;
+				const float dz = a_position.z - zone.center.z;
+				inside         = zone.radius - std::sqrt(dx * dx + dy * dy + dz * dz);
+			} else {
+				inside = std::min({ a_position.x - zone.min.x, zone.max.x - a_position.x, a_position.y - zone.min.y, zone.max.y - a_position.y,
+					a_position.z - zone.min.z, zone.max.z - a_position.z });
+			}
+			if (!(inside >= 0.0f)) continue;
+
+			const float weight = zone.falloff > 0.0f ? std::min(inside / zone.falloff, 1.0f) : 1.0f;
+			sample.keep *= 1.0f - weight;
+			sample.strength = std::lerp(sample.strength, zone.strength, weight);
+			sample.range    = std::lerp(sample.range, zone.range * 10, weight);
+			signature       = (signature ^ static_cast<std::uint32_t>(i)) * 16777619u;
+			any             = true;
+		}
+		if (any) sample.signature = signature ? signature : 1;
+		return sample;
+	}
+
+	// Hash of the applied DOF over a walk through the zones, with the sample from the tracker or from the brute-force reference
+	std::uint64_t WalkZones(std::span<const Zones::ZoneInput> a_zones, bool a_reference, std::uint64_t* a_lookups) {
+		const auto       rows = MakeRows(1, 3);
+		Blur::Controller controller;
+		controller.Compile(rows);
+
+		Zones::Grid    grid;
+		Zones::Tracker tracker;
+		grid.Compile(a_zones);
+
+		SimSky  sky;
+		SimImod imod;
+		sky.SetWeather(kFirstWeather);
+
+		std::mt19937                          rng(11);
+		std::uniform_real_distribution<float> turn(-0.3f, 0.3f);
+		Zones::Point                          position{ 0.0f, 0.0f, 1000.0f };
+		float                                 heading = 0.0f;
+		std::uint64_t                         hash    = 14695981039346656037ull;
+
+		for (int frame = 0; frame < 200'000; ++frame) {
+			// Sprinting speed at 60 FPS, bouncing off the edges of the scattered zones
+			heading += turn(rng);
+			position.x = std::clamp(position.x + 40.0f * std::cos(heading), -140000.0f, 140000.0f);
+			position.y = std::clamp(position.y + 40.0f * std::sin(heading), -140000.0f, 140000.0f);
+			position.z = 1000.0f + 3000.0f * std::sin(static_cast<float>(frame) * 0.001f);
+
+			const auto worldspace = (frame / 50'000) % 2 ? kWorldspace + 1 : kWorldspace;
+			if (a_reference) {
+				controller.SetZone(ReferenceSample(a_zones, worldspace, position));
+			} else {
+				tracker.Update(grid, worldspace, position);
+				controller.SetZone(tracker.Get());
+			}
+			controller.Update(1.0f / 60.0f, Blur::Mode::kAdvanced, sky, imod);
+
+			for (const float value : { controller.GetAppliedStrength(), controller.GetAppliedRange() }) {
+				hash = (hash ^ std::bit_cast<std::uint32_t>(value)) * 1099511628211ull;
+			}
+		}
+		if (a_lookups) *a_lookups = tracker.Lookups();
+		return hash;
+	}
+
+	// Settled DOF at one position, from a fresh controller on a row of strength 0.5 and range 100
+	std::pair<float, float> SettleInZone(const Zones::Grid& a_grid, const Zones::Point& a_position) {
+		Blur::RowInput   row{ kFirstWeather, true, 0.5f, 100.0f, false, 1.0f, Easing::defaultCurve, {}, {} };
+		Blur::Controller controller;
+		controller.Compile({ &row, 1 });
+
+		Zones::Tracker tracker;
+		tracker.Update(a_grid, kWorldspace, a_position);
+		controller.SetZone(tracker.Get());
+
+		SimSky  sky;
+		SimImod imod;
+		sky.SetWeather(kFirstWeather);
+		for (int i = 0; i < 60 * 10; ++i) {
+			controller.Update(1.0f / 60.0f, Blur::Mode::kAdvanced, sky, imod);
+		}
+		return { controller.GetAppliedStrength(), controller.GetAppliedRange() };
+	}
+
+	int RunZoneCheck() {
+		std::size_t failed = 0;
+
+		// 1. The grid finds exactly what evaluating every zone finds, bit for bit
+		const auto  zones = MakeZones(256, 5);
+		Zones::Grid grid;
+		grid.Compile(zones);
+
+		std::mt19937                          rng(5);
+		std::uniform_real_distribution<float> coord(-36.0f * Zones::Grid::cellSize, 36.0f * Zones::Grid::cellSize);
+		std::uniform_real_distribution<float> height(-3000.0f, 15000.0f);
+		std::size_t                           samples = 0;
+		std::size_t                           inside  = 0;
+		std::size_t                           wrong   = 0;
+		for (; samples < 200'000; ++samples) {
+			const Zones::Point position{ coord(rng), coord(rng), height(rng) };
+			const auto         worldspace = (samples % 2) ? kWorldspace + 1 : kWorldspace;
+			const auto         sample     = grid.Evaluate(grid.Candidates(worldspace, Zones::Grid::CellOf(position)), position);
+			wrong += sample != ReferenceSample(zones, worldspace, position);
+			inside += sample.signature != 0;
+		}
+		failed += wrong;
+
+		// 2. Blending over the weather row: the first zone wins where zones overlap, falloff bands lerp
+		const std::vector<Zones::ZoneInput> scene = {
+			{ true, kWorldspace, Zones::Shape::kSphere, { 0.0f, 0.0f, 0.0f }, 10000.0f, {}, {}, 1.0f, 50.0f, 4000.0f },
+			{ true, kWorldspace, Zones::Shape::kBox, {}, 0.0f, { -20000.0f, -20000.0f, -5000.0f }, { 20000.0f, 20000.0f, 5000.0f }, 0.0f, 300.0f, 0.0f }
+		};
+		Zones::Grid sceneGrid;
+		sceneGrid.Compile(scene);
+
+		struct Expectation {
+			Zones::Point            position;
+			std::pair<float, float> settled;
+		};
+		const Expectation expectations[] = {
+			{ { 0.0f, 0.0f, 0.0f }, { 1.0f, 500.0f } },       // Both at full weight, the sphere is listed first
+			{ { 8000.0f, 0.0f, 0.0f }, { 0.5f, 1750.0f } },   // Halfway into the sphere's falloff, over the box
+			{ { 15000.0f, 0.0f, 0.0f }, { 0.0f, 3000.0f } },  // Only the box
+			{ { 30000.0f, 0.0f, 0.0f }, { 0.5f, 1000.0f } },  // Outside, the row alone
+			{ { 0.0f, 0.0f, 9000.0f }, { 0.625f, 875.0f } }   // Above the box, a quarter into the sphere's falloff
+		};
+		std::size_t blendWrong = 0;
+		for (const auto& expectation : expectations) {
+			const auto settled = SettleInZone(sceneGrid, expectation.position);
+			if (settled != expectation.settled) {
+				std::fprintf(stderr, "  at (%.0f, %.0f, %.0f): settled %.6f / %.3f, expected %.6f / %.3f\n", expectation.position.x, expectation.position.y,
+					expectation.position.z, settled.first, settled.second, expectation.settled.first, expectation.settled.second);
+				++blendWrong;
+			}
+		}
+		failed += blendWrong;
+
+		// 3. Crossing a hard edge fades instead of snapping
+		{
+			Blur::RowInput   row{ kFirstWeather, true, 0.5f, 100.0f, false, 1.0f, Easing::defaultCurve, {}, {} };
+			Blur::Controller controller;
+			controller.Compile({ &row, 1 });
+
+			Zones::Tracker tracker;
+			SimSky         sky;
+			SimImod        imod;
+			sky.SetWeather(kFirstWeather);
+			for (int i = 0; i < 600; ++i) {
+				tracker.Update(sceneGrid, kWorldspace, { 30000.0f, 0.0f, 0.0f });
+				controller.SetZone(tracker.Get());
+				controller.Update(1.0f / 60.0f, Blur::Mode::kAdvanced, sky, imod);
+			}
+			for (int i = 0; i < 10; ++i) {
+				tracker.Update(sceneGrid, kWorldspace, { 15000.0f, 0.0f, 0.0f });
+				controller.SetZone(tracker.Get());
+				controller.Update(1.0f / 60.0f, Blur::Mode::kAdvanced, sky, imod);
+			}
+			const float strength = controller.GetAppliedStrength();
+			if (!(strength > 0.0f && strength < 0.5f) || controller.GetTargetStrength() != 0.0f) {
+				std::fprintf(stderr, "  crossing into the box: applied %.6f after ten frames, target %.6f\n", strength, controller.GetTargetStrength());
+				++failed;
+			}
+		}
+
+		// 4. The grid is probed once per cell change, and a walk through the zones comes out the same as with the reference
+		std::uint64_t lookups   = 0;
+		const auto    tracked   = WalkZones(zones, false, &lookups);
+		const auto    reference = WalkZones(zones, true, nullptr);
+		const auto    again     = WalkZones(zones, false, nullptr);
+		failed += tracked != reference;
+		failed += tracked != again;
+
+		std::uint64_t cellChanges = 0;
+		{
+			std::mt19937                          walk(11);
+			std::uniform_real_distribution<float> turn(-0.3f, 0.3f);
+			Zones::Point                          position{ 0.0f, 0.0f, 1000.0f };
+			float                                 heading = 0.0f;
+			Zones::Grid::CellCoord                last{ INT32_MAX, INT32_MAX };
+			std::uint32_t                         lastWorldspace = 0;
+			for (int frame = 0; frame < 200'000; ++frame) {
+				heading += turn(walk);
+				position.x = std::clamp(position.x + 40.0f * std::cos(heading), -140000.0f, 140000.0f);
+				position.y = std::clamp(position.y + 40.0f * std::sin(heading), -140000.0f, 140000.0f);
+
+				const auto cell       = Zones::Grid::CellOf(position);
+				const auto worldspace = (frame / 50'000) % 2 ? kWorldspace + 1 : kWorldspace;
+				cellChanges += cell != last || worldspace != lastWorldspace;
+				last           = cell;
+				lastWorldspace = worldspace;
+			}
+		}
+		failed += lookups != cellChanges;
+
+		// Cost of the update path: the common empty cell, a cell with zones in it, and crossing into another cell
+		Zones::Tracker  tracker;
+		const auto      empty = std::ranges::find_if(std::views::iota(0, 4096), [&](int i) {
+			return grid.Candidates(kWorldspace, { i % 64 - 32, i / 64 - 32 }).empty();
+		});
+		const auto      busy  = std::ranges::max_element(std::views::iota(0, 4096), {}, [&](int i) {
+			return grid.Candidates(kWorldspace, { i % 64 - 32, i / 64 - 32 }).size();
+		});
+		const auto      centerOf = [](int i) {
+			return Zones::Point{ (static_cast<float>(i % 64 - 32) + 0.5f) * Zones::Grid::cellSize, (static_cast<float>(i / 64 - 32) + 0.5f) * Zones::Grid::cellSize, 1000.0f };
+		};
+		const auto   quiet     = centerOf(*empty);
+		const auto   crowded   = centerOf(*busy);
+		std::size_t  sink      = 0;
+		const double sameEmpty = NanosecondsPerOp(5'000'000, [&](std::uint64_t) { sink += tracker.Update(grid, kWorldspace, quiet); });
+		const double sameBusy  = NanosecondsPerOp(2'000'000, [&](std::uint64_t i) {
+			sink += tracker.Update(grid, kWorldspace, { crowded.x + static_cast<float>(i % 64), crowded.y, crowded.z });
+		});
+		const double crossing  = NanosecondsPerOp(2'000'000, [&](std::uint64_t i) { sink += tracker.Update(grid, kWorldspace, (i % 2) ? quiet : crowded); });
+		const double compile   = NanosecondsPerOp(200, [&](std::uint64_t) { grid.Compile(zones); });
+
+		std::printf("Blur zones: %zu of %zu zones in %zu grid cells, %zu samples (%zu inside a zone), %zu differ from the reference\n", grid.Size(), zones.size(),
+			grid.CellCount(), samples, inside, wrong);
+		std::printf("  blend           : %zu of %zu positions wrong\n", blendWrong, std::size(expectations));
+		std::printf("  walk            : %llu lookups for %llu cell changes, %s the reference, %s on a second run\n", static_cast<unsigned long long>(lookups),
+			static_cast<unsigned long long>(cellChanges), tracked == reference ? "matches" : "DIFFERS FROM", tracked == again ? "identical" : "DIFFERENT");
+		std::printf("  ns/update       : %.1f same empty cell, %.1f same cell with %zu zones, %.1f crossing cells\n", sameEmpty, sameBusy,
+			grid.Candidates(kWorldspace, Zones::Grid::CellOf(crowded)).size(), crossing);
+		std::printf("  compile 256     : %.1f us\n", compile / 1000.0);
+		(void)sink;
+
+		if (failed) {
+			std::fprintf(stderr, "zones check: %zu failures\n", failed);
+			return 1;
+		}
+		return 0;
+	}
+
+	// ------------------------------------------------------------
+	// Publish stress
+	// ------------------------------------------------------------
+
+	// Every value in a table is derived from its tag, so a reader that sees a mix of two tables, or a freed one, notices.
+	Published::Tables MakeTables(std::uint32_t a_tag, std::size_t a_rowCount) {
+		Published::Tables tables;
+		const auto        strength = static_cast<float>(a_tag % 1000) / 1000.0f;
+
+		tables.keyframes.reserve(a_rowCount * 2);
+		tables.channels.reserve(a_rowCount);
+		for (std::size_t i = 0; i < a_rowCount; ++i) {
+			tables.keyframes.push_back({ 6.0f, strength, static_cast<float>(a_tag) });
+			tables.keyframes.push_back({ 18.0f, strength, static_cast<float>(a_tag) });
+			tables.channels.push_back({ Imod::kTintAlpha, strength });
+			tables.rows.push_back({ kFirstWeather + static_cast<std::uint32_t>(i), true, strength, static_cast<float>(a_tag), (i % 7) == 0,
+				Easing::defaultDuration, Easing::defaultCurve, std::span(tables.keyframes).last(2), std::span(tables.channels).last(1) });
+		}
+		tables.authoredRows = a_rowCount;
+		tables.rules.push_back({ true, 0, Rules::Cell::kInterior, 0, {}, 0, 0, strength, static_cast<float>(a_tag), false });
+		tables.changedWeathers.push_back(a_tag);
+		return tables;
+	}
+
+	bool Consistent(const Published::Tables& a_tables) {
+		if (a_tables.rows.size() != a_tables.authoredRows || a_tables.changedWeathers.size() != 1 || a_tables.rules.size() != 1) return false;
+
+		const auto tag = a_tables.changedWeathers.front();
+		for (const auto& row : a_tables.rows) {
+			if (row.range != static_cast<float>(tag) || row.curve.size() != 2 || row.channels.size() != 1) return false;
+			if (row.curve.data() < a_tables.keyframes.data() || row.curve.data() >= a_tables.keyframes.data() + a_tables.keyframes.size()) return false;
+			if (row.curve[1].range != static_cast<float>(tag) || row.channels[0].value != row.strength) return false;
+		}
+		return a_tables.rules.front().range == static_cast<float>(tag);
+	}
+
+	int RunPublishStress(double a_seconds) {
+		Published::Slot<Published::Tables, 1> slot;
+		std::atomic<bool>                     done{ false };
+		std::atomic<std::uint32_t>            nextTag{ 1 };
+
+		// Stand-ins for the UI and the reload watcher, both publish whole tables of varying size
+		const auto writer = [&](std::uint32_t a_seed) {
+			std::mt19937 rng(a_seed);
+			while (!done.load(std::memory_order_relaxed)) {
+				slot.Publish(MakeTables(nextTag.fetch_add(1, std::memory_order_relaxed), 8 + rng() % 256));
+			}
+		};
+		std::jthread ui(writer, 1u);
+		std::jthread watcher(writer, 2u);
+
+		Blur::Controller controller;
+		SimSky           sky;
+		SimImod          imod;
+		std::uint64_t    reads   = 0;
+		std::uint64_t    skipped = 0;
+		std::uint64_t    epoch   = 0;
+		std::size_t      retired = 0;
+		bool             failed  = false;
+
+		const auto start = std::chrono::steady_clock::now();
+		while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < a_seconds) {
+			if (slot.Epoch() != epoch) {
+				const auto tables = slot.Read(0);
+				if (!tables || !Consistent(*tables)) {
+					failed = true;
+					break;
+				}
+				if (tables.Epoch() != epoch + 1) ++skipped;
+				epoch = tables.Epoch();
+
+				controller.Compile(tables->rows);
+				sky.SetWeather(kFirstWeather + static_cast<std::uint32_t>(reads % tables->rows.size()));
+				++reads;
+			}
+			controller.Update(1.0f / 60.0f, Blur::Mode::kAdvanced, sky, imod);
+			retired = std::max(retired, slot.Retired());
+		}
+
+		done = true;
+		ui.join();
+		watcher.join();
+
+		if (failed) {
+			std::fprintf(stderr, "publish stress: reader saw an inconsistent table at epoch %llu\n", static_cast<unsigned long long>(epoch));
+			return 1;
+		}
+
+		std::printf("Published %llu tables in %.1f s, the reader compiled %llu of them\n", static_cast<unsigned long long>(slot.Epoch()), a_seconds,
+			static_cast<unsigned long long>(reads));
+		std::printf("  skipped epochs  : %llu\n", static_cast<unsigned long long>(skipped));
+		std::printf("  peak retired    : %zu\n", retired);
+		return 0;
+	}
+
+	// ------------------------------------------------------------
+	// Debounced persistence
+	// ------------------------------------------------------------
+
+	// Stand-in for the settings writer: remembers what landed in which order and whether two writes overlapped
+	struct WriteLog {
+		std::mutex                 lock;
+		std::vector<std::uint64_t> values;
+		std::atomic<int>           inFlight{ 0 };
+		std::atomic<int>           overlaps{ 0 };
+		std::atomic<bool>          started{ false };
+		std::chrono::microseconds  cost{ 0 };
+
+		void operator()(const std::uint64_t& a_value) {
+			if (inFlight.fetch_add(1) != 0) ++overlaps;
+			started = true;
+			std::this_thread::sleep_for(cost);
+			{
+				std::scoped_lock guard(lock);
+				values.push_back(a_value);
+			}
+			inFlight.fetch_sub(1);
+		}
+
+		std::vector<std::uint64_t> Values() {
+			std::scoped_lock guard(lock);
+			return values;
+		}
+	};
+
+	int RunPersistenceCheck() {
+		using namespace std::chrono_literals;
+		using Debouncer = Persistence::Debouncer<std::uint64_t>;
+		int failures    = 0;
+
+		const auto report = [&](const char* a_label, bool a_ok, const std::string& a_detail) {
+			std::printf("  %-26s : %s%s\n", a_label, a_ok ? "OK" : "FAILED", a_detail.c_str());
+			if (!a_ok) ++failures;
+		};
+
+		std::printf("Debounced persistence:\n");
+
+		// A drag: 1,000 edits, each well inside the debounce window of the one before
+		{
+			WriteLog log;
+			log.cost = 1ms;
+			{
+				Debouncer saver(50ms, std::ref(log));
+				for (std::uint64_t i = 1; i <= 1000; i++) {
+					saver.Request(std::uint64_t{ i });
+					std::this_thread::sleep_for(100us);
+				}
+				std::this_thread::sleep_for(200ms);
+			}
+			const auto values = log.Values();
+			report("1,000 rapid requests", values.size() == 1 && values.back() == 1000,
+				", " + std::to_string(values.size()) + " write(s), last " + std::to_string(values.empty() ? 0 : values.back()));
+		}
+
+		// A save game while the worker is still writing an older edit: the newer one has to land last
+		{
+			WriteLog log;
+			log.cost = 30ms;
+			Debouncer saver(1ms, std::ref(log));
+			saver.Request(1);
+			while (!log.started) std::this_thread::sleep_for(100us);
+			saver.Request(2);
+			saver.Flush();
+			std::this_thread::sleep_for(50ms);
+
+			const auto values = log.Values();
+			report("flush behind a write", values == std::vector<std::uint64_t>{ 1, 2 } && !log.overlaps, ", " + std::to_string(log.overlaps) + " overlaps");
+		}
+
+		// An external edit drops what the UI had queued
+		{
+			WriteLog log;
+			{
+				Debouncer saver(20ms, std::ref(log));
+				saver.Request(3);
+				const bool dropped = saver.Discard();
+				std::this_thread::sleep_for(60ms);
+				report("discard", dropped && log.Values().empty(), "");
+			}
+			report("nothing left to flush", log.Values().empty(), "");
+		}
+
+		// Edits at random intervals against random flushes, every write has to be newer than the one before
+		{
+			WriteLog          log;
+			std::uint64_t     requested = 0;
+			std::atomic<bool> done{ false };
+			log.cost = 200us;
+			{
+				Debouncer    saver(1ms, std::ref(log));
+				std::jthread flusher([&] {
+					std::mt19937 rng(7);
+					while (!done) {
+						std::this_thread::sleep_for(std::chrono::microseconds(rng() % 3000));
+						saver.Flush();
+					}
+				});
+
+				std::mt19937 rng(11);
+				const auto   start = std::chrono::steady_clock::now();
+				while (std::chrono::steady_clock::now() - start < 500ms) {
+					saver.Request(std::uint64_t{ ++requested });
+					std::this_thread::sleep_for(std::chrono::microseconds(rng() % 2000));
+				}
+				done = true;
+			}
+
+			const auto values  = log.Values();
+			const bool ordered = std::ranges::adjacent_find(values, std::greater_equal{}) == values.end();
+			report("requests against flushes", ordered && !values.empty() && values.back() == requested && !log.overlaps,
+				", " + std::to_string(requested) + " requests, " + std::to_string(values.size()) + " writes, " + std::to_string(log.overlaps) + " overlaps");
+		}
+
+		std::printf("persistence: %s\n", failures ? "FAILED" : "OK");
+		return failures ? 1 : 0;
+	}
+}
+
+int main(int argc, char** argv) {
+	const std::string_view command = argc > 1 ? argv[1] : "";
+
+	if (command == "sim") {
+		const auto frames = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1'000'000ull;
+		const auto seed   = argc > 3 ? static_cast<std::uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 42u;
+		return RunSimulation(frames, seed);
+	}
+
+	if (command == "record" && argc > 2) {
+		const auto frames = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1'000'000ull;
+		const auto seed   = argc > 4 ? static_cast<std::uint32_t>(std::strtoul(argv[4], nullptr, 10)) : 42u;
+		return RunSimulation(frames, seed, argv[2]);
+	}
+
+	if (command == "auto") {
+		return RunAutomaticCheck();
+	}
+
+	if (command == "zones") {
+		return RunZoneCheck();
+	}
+
+	if (command == "rules") {
+		return RunRulesCheck();
+	}
+
+	if (command == "fps") {
+		return RunFrameRateCheck();
+	}
+
+	if (command == "channels") {
+		return RunChannelCheck(argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 900'000);
+	}
+
+	if (command == "bench") {
+		return RunBenchmarks();
+	}
+
+	if (command == "snapshot") {
+		return RunSnapshotBenchmarks();
+	}
+
+	if (command == "publish") {
+		return RunPublishStress(argc > 2 ? std::strtod(argv[2], nullptr) : 2.0);
+	}
+
+	if (command == "persist") {
+		return RunPersistenceCheck();
+	}
+
+	if (!command.empty()) {
+		std::fprintf(stderr, "usage: %s [sim [frames] [seed] | record <file> [frames] [seed] | auto | rules | zones | fps | channels [frames] | bench | snapshot | publish [seconds] | persist]\n", argv[0]);
+		return 1;
+	}
+
+	RunSimulation(1'000'000, 42);
+	std::printf("\n");
+	RunAutomaticCheck();
+	std::printf("\n");
+	RunRulesCheck();
+	std::printf("\n");
+	RunZoneCheck();
+	std::printf("\n");
+	RunFrameRateCheck();
+	std::printf("\n");
+	RunChannelCheck(900'000);
+	std::printf("\n");
+	RunBenchmarks();
+	std::printf("\n");
+	RunSnapshotBenchmarks();
+	std::printf("\n");
+	RunPersistenceCheck();
+	std::printf("\n");
+	return RunPublishStress(2.0);
+}
@@ -0,0 +1,382 @@
+// Reader for the shared memory block the plugin publishes with `Telemetry=true` under [General]. The layout is
+// documented in include/Telemetry.h.
+//
+//   blur-telemetry read     [interval ms] [count]   Prints the block every interval, count times, or until interrupted
+//                                                   with a count of 0.
+//   blur-telemetry stand-in [seconds]               Creates the block as a POSIX shared memory object and publishes a
+//                                                   simulated weather run into it at 60 updates a second, so readers can
+//                                                   be tried without the game. 0 runs until interrupted.
+//   blur-telemetry check    [seconds]               A writer publishes as fast as it can through one mapping while a
+//                                                   reader copies through a second one, and every copy is checked for
+//                                                   torn or out of order snapshots.
+//
+// With no arguments `check` runs for 2 seconds. On Windows `read` opens the game's block, stand-in and check need
+// POSIX shared memory.
+
+#include "BlurController.h"
+#include "Metrics.h"
+#include "Telemetry.h"
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace {
+
+	volatile std::sig_atomic_t interrupted = 0;
+
+	void OnInterrupt(int) {
+		interrupted = 1;
+	}
+
+	// ------------------------------------------------------------
+	// Mapping
+	// ------------------------------------------------------------
+
+#ifdef _WIN32
+	const std::string blockPath = std::string("Local\\") + Telemetry::blockName;
+
+	const Telemetry::Block* OpenBlock() {
+		const auto mapping = ::OpenFileMappingA(FILE_MAP_READ, FALSE, blockPath.c_str());
+		if (!mapping) return nullptr;
+
+		const auto view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(Telemetry::Block));
+		::CloseHandle(mapping);  // The view keeps the mapping alive
+		return static_cast<const Telemetry::Block*>(view);
+	}
+#else
+	const std::string blockPath = std::string("/") + Telemetry::blockName;
+
+	// Creating truncates, so a stale object from a killed stand-in starts over from zeroes
+	void* Map(const std::string& a_name, bool a_create) {
+		const int fd = a_create ? ::shm_open(a_name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644) : ::shm_open(a_name.c_str(), O_RDONLY, 0);
+		if (fd < 0) return nullptr;
+
+		struct stat info {};
+		const bool  sized = a_create ? ::ftruncate(fd, sizeof(Telemetry::Block)) == 0
+		                             : ::fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) >= sizeof(Telemetry::Block);
+		void* view = sized ? ::mmap(nullptr, sizeof(Telemetry::Block), a_create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+		::close(fd);  // The mapping keeps the object alive
+		return view == MAP_FAILED ? nullptr : view;
+	}
+
+	const Telemetry::Block* OpenBlock() {
+		return static_cast<const Telemetry::Block*>(Map(blockPath, false));
+	}
+#endif
+
+	// ------------------------------------------------------------
+	// Reader
+	// ------------------------------------------------------------
+
+	void PrintSnapshot(const Telemetry::Snapshot& a_snapshot, bool a_stale) {
+		char rule[16] = "-";
+		if (a_snapshot.rule >= 0) std::snprintf(rule, sizeof(rule), "%d", a_snapshot.rule);
+
+		std::printf("#%-8llu weather %08X  rule %-3s  zones %08X  applied %.3f / %7.1f  target %.3f / %7.1f  update %5u ns  events %04X  mode %u  lifecycle %u%s\n",
+			static_cast<unsigned long long>(a_snapshot.frame), a_snapshot.weather, rule, a_snapshot.zoneSignature, a_snapshot.appliedStrength,
+			a_snapshot.appliedRange, a_snapshot.targetStrength, a_snapshot.targetRange, a_snapshot.updateNanoseconds, a_snapshot.events,
+			static_cast<unsigned>(a_snapshot.mode), static_cast<unsigned>(a_snapshot.lifecycle), a_stale ? "  (no update)" : "");
+	}
+
+	// Only the counters that moved since the last line, so a quiet game prints nothing extra
+	void PrintCounters(const Telemetry::Snapshot& a_snapshot, const Telemetry::Snapshot* a_previous) {
+		std::string line;
+		for (std::size_t i = 0; i < Telemetry::counterCount; i++) {
+			if (a_previous && a_snapshot.counters[i] == a_previous->counters[i]) continue;
+			line += line.empty() ? "          " : ", ";
+			line += Metrics::counterNames[i];
+			line += ' ';
+			line += std::to_string(a_snapshot.counters[i]);
+		}
+		if (!line.empty()) std::printf("%s\n", line.c_str());
+	}
+
+	int RunReader(std::uint32_t a_intervalMs, std::uint64_t a_count) {
+		const auto block = OpenBlock();
+		if (!block) {
+			std::fprintf(stderr, "No telemetry block '%s'. Is the game running with Telemetry=true, or blur-telemetry stand-in?\n", blockPath.c_str());
+			return 1;
+		}
+
+		std::signal(SIGINT, OnInterrupt);
+
+		bool                checked  = false;
+		bool                havePrev = false;
+		Telemetry::Snapshot previous{};
+		std::uint64_t       failed   = 0;
+
+		for (std::uint64_t i = 0; (!a_count || i < a_count) && !interrupted; i++) {
+			if (i) std::this_thread::sleep_for(std::chrono::milliseconds(a_intervalMs));
+
+			// The header is written before the first publish, so it is only trusted once something was published
+			if (!checked && Telemetry::Published(*block)) {
+				const auto& header = block->header;
+				if (!Telemetry::Compatible(header)) {
+					std::fprintf(stderr, "'%s' has layout version %u (%u byte snapshot), this reader understands version %u\n", blockPath.c_str(), header.version,
+						header.snapshotSize, Telemetry::layoutVersion);
+					return 1;
+				}
+				std::printf("Reading '%s', layout version %u, written by process %u\n", blockPath.c_str(), header.version, header.processID);
+				checked = true;
+			}
+
+			Telemetry::Snapshot snapshot;
+			if (!checked || !Telemetry::Read(*block, snapshot)) {
+				++failed;
+				continue;
+			}
+
+			PrintSnapshot(snapshot, havePrev && snapshot.frame == previous.frame);
+			PrintCounters(snapshot, havePrev ? &previous : nullptr);
+			previous = snapshot;
+			havePrev = true;
+		}
+
+		if (failed) std::printf("%llu reads found nothing published or no whole copy\n", static_cast<unsigned long long>(failed));
+		return 0;
+	}
+
+#ifndef _WIN32
+	// ------------------------------------------------------------
+	// Stand-in writer
+	// ------------------------------------------------------------
+
+	struct StandInSky final : Blur::ISky {
+		std::uint32_t current  = 0;
+		std::uint32_t previous = 0;
+
+		std::uint32_t GetCurrentWeather() const override { return current; }
+		std::uint32_t GetPreviousWeather() const override { return previous; }
+		float         GetGameHour() const override { return 12.0f; }
+	};
+
+	struct StandInImod final : Blur::IImodSink {
+		bool alive = false;
+
+		void SetChannels(std::uint32_t, const Imod::Values&) override {}
+		void Trigger() override { alive = true; }
+		void Stop() override { alive = false; }
+		bool IsInstanceAlive() const override { return alive; }
+	};
+
+	// Same mapping from events to counters as BlurManager::CountEvents()
+	void CountEvents(std::uint32_t a_events, std::array<std::uint64_t, Telemetry::counterCount>& a_counters) {
+		const auto count = [&](Blur::UpdateEvent a_event, Metrics::Counter a_counter) {
+			if (a_events & a_event) a_counters[static_cast<std::size_t>(a_counter)]++;
+		};
+		count(Blur::kWeatherChanged, Metrics::Counter::kWeatherChanges);
+		count(Blur::kDOFWritten, Metrics::Counter::kDOFWrites);
+		count(Blur::kChannelsWritten, Metrics::Counter::kChannelWrites);
+		count(Blur::kTriggered, Metrics::Counter::kTriggers);
+		count(Blur::kRetriggered, Metrics::Counter::kRetriggers);
+		count(Blur::kStopped, Metrics::Counter::kStops);
+		count(Blur::kParked, Metrics::Counter::kParks);
+		count(Blur::kUnparked, Metrics::Counter::kUnparks);
+	}
+
+	int RunStandIn(double a_seconds) {
+		const auto view = Map(blockPath, true);
+		if (!view) {
+			std::fprintf(stderr, "Could not create '%s': %s\n", blockPath.c_str(), std::strerror(errno));
+			return 1;
+		}
+		const auto block = Telemetry::Create(view, static_cast<std::uint32_t>(::getpid()));
+
+		constexpr std::uint32_t firstWeather = 0x0000D000;
+		std::vector<Blur::RowInput> rows;
+		for (std::uint32_t i = 0; i < 8; i++) {
+			rows.push_back({ firstWeather + i, true, 0.2f + 0.1f * static_cast<float>(i), 100.0f + 50.0f * static_cast<float>(i), false, 3.0f, Easing::defaultCurve, {}, {} });
+		}
+		Blur::Controller controller;
+		controller.Compile(rows);
+
+		// Every 8 seconds a new weather, one pick in nine has no row and fades the blur out
+		std::mt19937                                 rng(42);
+		std::uniform_int_distribution<std::uint32_t> weatherPick(0, static_cast<std::uint32_t>(rows.size()));
+		StandInSky                                   sky;
+		StandInImod                                  imod;
+		std::array<std::uint64_t, Telemetry::counterCount> counters{};
+
+		std::signal(SIGINT, OnInterrupt);
+		std::signal(SIGTERM, OnInterrupt);
+		std::printf("Publishing to '%s' at 60 updates a second%s\n", blockPath.c_str(), a_seconds > 0.0 ? "" : ", until interrupted");
+		std::fflush(stdout);
+
+		constexpr auto frameTime = std::chrono::microseconds(16667);
+		const auto     frames    = static_cast<std::uint64_t>(a_seconds * 60.0);
+		auto           next      = std::chrono::steady_clock::now();
+
+		for (std::uint64_t frame = 1; (!frames || frame <= frames) && !interrupted; frame++) {
+			if (frame % 480 == 1) {
+				sky.previous = sky.current;
+				sky.current  = firstWeather + weatherPick(rng);
+			}
+
+			const auto start  = std::chrono::steady_clock::now();
+			const auto events = controller.Update(1.0f / 60.0f, Blur::Mode::kAdvanced, sky, imod);
+			const auto cost   = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			CountEvents(events, counters);
+
+			// No context rules here, the rule column cycles so readers can see it move
+			auto snapshot  = Telemetry::Capture(controller, events, static_cast<std::int32_t>(frame / 600 % 4) - 1, static_cast<std::uint64_t>(cost));
+			snapshot.frame = frame;
+			std::memcpy(snapshot.counters, counters.data(), sizeof(snapshot.counters));
+			Telemetry::Publish(*block, snapshot);
+
+			std::this_thread::sleep_until(next += frameTime);
+		}
+
+		::munmap(view, sizeof(Telemetry::Block));
+		::shm_unlink(blockPath.c_str());
+		std::printf("Stopped, '%s' removed\n", blockPath.c_str());
+		return 0;
+	}
+
+	// ------------------------------------------------------------
+	// Seqlock check
+	// ------------------------------------------------------------
+
+	// Every field is a function of the frame, so a copy mixing two updates does not match its own frame
+	Telemetry::Snapshot Synthetic(std::uint64_t a_frame) {
+		Telemetry::Snapshot snapshot{};
+		snapshot.frame = a_frame;
+		for (std::size_t i = 0; i < Telemetry::counterCount; i++) {
+			snapshot.counters[i] = a_frame * (i + 1) + i;
+		}
+		snapshot.appliedStrength   = static_cast<float>(a_frame & 0xFFFF);
+		snapshot.appliedRange      = static_cast<float>((a_frame >> 16) & 0xFFFF);
+		snapshot.targetStrength    = -snapshot.appliedStrength;
+		snapshot.targetRange       = -snapshot.appliedRange;
+		snapshot.weather           = static_cast<std::uint32_t>(a_frame * 2654435761u);
+		snapshot.rule              = static_cast<std::int32_t>(a_frame % 1000) - 1;
+		snapshot.zoneSignature     = ~static_cast<std::uint32_t>(a_frame);
+		snapshot.updateNanoseconds = static_cast<std::uint32_t>(a_frame);
+		snapshot.events            = static_cast<std::uint16_t>(a_frame);
+		snapshot.mode              = static_cast<std::uint8_t>(a_frame);
+		snapshot.lifecycle         = static_cast<std::uint8_t>(a_frame >> 8);
+		return snapshot;
+	}
+
+	int RunCheck(double a_seconds) {
+		// Its own object, so a running stand-in is left alone
+		const auto name   = blockPath + "-check-" + std::to_string(::getpid());
+		const auto view   = Map(name, true);
+		const auto reader = view ? static_cast<const Telemetry::Block*>(Map(name, false)) : nullptr;
+		if (!view || !reader) {
+			std::fprintf(stderr, "Could not map '%s': %s\n", name.c_str(), std::strerror(errno));
+			if (view) ::shm_unlink(name.c_str());
+			return 1;
+		}
+		const auto writer = Telemetry::Create(view, static_cast<std::uint32_t>(::getpid()));
+
+		std::atomic<bool> done{ false };
+		std::uint64_t     published = 0;
+		double            writeNs   = 0.0;
+
+		std::thread writerThread([&] {
+			const auto start = std::chrono::steady_clock::now();
+			while (!done.load(std::memory_order_relaxed)) {
+				Telemetry::Publish(*writer, Synthetic(++published));
+			}
+			const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			writeNs            = elapsed / static_cast<double>(published);
+		});
+
+		std::uint64_t reads     = 0;
+		std::uint64_t retries   = 0;
+		std::uint64_t missed    = 0;  // Nothing published yet, or no whole copy within the attempts
+		std::uint64_t torn      = 0;
+		std::uint64_t backwards = 0;
+		std::uint64_t last      = 0;
+
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(a_seconds);
+		while (std::chrono::steady_clock::now() < deadline) {
+			Telemetry::Snapshot snapshot;
+			if (!Telemetry::Read(*reader, snapshot, 64, &retries)) {
+				++missed;
+				continue;
+			}
+
+			++reads;
+			const auto expected = Synthetic(snapshot.frame);
+			if (std::memcmp(&snapshot, &expected, sizeof(snapshot)) != 0) ++torn;
+			if (snapshot.frame < last) ++backwards;
+			last = snapshot.frame;
+		}
+
+		done.store(true, std::memory_order_relaxed);
+		writerThread.join();
+
+		const bool compatible = Telemetry::Compatible(reader->header);
+		::munmap(view, sizeof(Telemetry::Block));
+		::munmap(const_cast<Telemetry::Block*>(reader), sizeof(Telemetry::Block));
+		::shm_unlink(name.c_str());
+
+		std::printf("Seqlock check, %.1f s through two mappings of one object:\n", a_seconds);
+		std::printf("  published      : %llu (%.1f ns each)\n", static_cast<unsigned long long>(published), writeNs);
+		std::printf("  reads          : %llu whole, %llu retries, %llu gave up\n", static_cast<unsigned long long>(reads), static_cast<unsigned long long>(retries),
+			static_cast<unsigned long long>(missed));
+		std::printf("  torn copies    : %llu\n", static_cast<unsigned long long>(torn));
+		std::printf("  out of order   : %llu\n", static_cast<unsigned long long>(backwards));
+		std::printf("  header         : %s\n", compatible ? "OK" : "INCOMPATIBLE");
+
+		const bool ok = reads && !torn && !backwards && compatible;
+		std::printf("check: %s\n", ok ? "OK" : "FAILED");
+		return ok ? 0 : 2;
+	}
+#else
+	int RunStandIn(double) {
+		std::fprintf(stderr, "stand-in needs POSIX shared memory, read the game's block with 'read' instead\n");
+		return 1;
+	}
+
+	int RunCheck(double) {
+		std::fprintf(stderr, "check needs POSIX shared memory\n");
+		return 1;
+	}
+#endif
+}
+
+int main(int argc, char** argv) {
+	const std::string_view command = argc > 1 ? argv[1] : "";
+
+	if (command == "read") {
+		const auto interval = argc > 2 ? static_cast<std::uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 500u;
+		const auto count    = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 0ull;
+		return RunReader(interval, count);
+	}
+
+	if (command == "stand-in") {
+		return RunStandIn(argc > 2 ? std::strtod(argv[2], nullptr) : 60.0);
+	}
+
+	if (command == "check" || command.empty()) {
+		return RunCheck(argc > 2 ? std::strtod(argv[2], nullptr) : 2.0);
+	}
+
+	std::fprintf(stderr, "usage: %s [read [interval ms] [count] | stand-in [seconds] | check [seconds]]\n", argv[0]);
+	return 1;
+}